@@ -0,0 +1,179 @@
+/*
+ *  openaltium is a set of tools for opening Altium (TM) library files
+ *  Copyright (C) 2016  Peter Clifton <Peter.Clifton@clifton-electronics.co.uk>
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 2.1 of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this library; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include <stdint.h>
+#include <stdarg.h>
+#include <stdbool.h>
+#include <string.h>
+#include <glib.h>
+
+#include "arena.h"
+
+
+#define ARENA_BLOCK_SIZE (64 * 1024)
+#define ARENA_ALIGNMENT  16
+#define ARENA_ALIGN(size) (((size) + ARENA_ALIGNMENT - 1) & ~(gsize)(ARENA_ALIGNMENT - 1))
+
+/* Requests bigger than this get a block to themselves, rather than
+ * wasting what is left of the current one.
+ */
+#define ARENA_LARGE_SIZE (ARENA_BLOCK_SIZE / 4)
+
+typedef struct arena_block arena_block;
+struct arena_block {
+  arena_block *next;
+};
+
+#define ARENA_BLOCK_HEADER ARENA_ALIGN (sizeof (arena_block))
+
+struct arena {
+  arena_block *blocks;          /* The current block first */
+  char *next;                   /* Free space in the current block */
+  char *end;
+};
+
+
+arena *
+arena_new (void)
+{
+  return g_slice_new0 (arena);
+}
+
+void
+arena_clear (arena *arena)
+{
+  arena_block *block;
+  arena_block *next;
+
+  for (block = arena->blocks; block != NULL; block = next) {
+    next = block->next;
+    g_free (block);
+  }
+
+  arena->blocks = NULL;
+  arena->next = NULL;
+  arena->end = NULL;
+}
+
+void
+arena_free (arena *arena)
+{
+  if (arena == NULL)
+    return;
+
+  arena_clear (arena);
+  g_slice_free (arena, arena);
+}
+
+static gpointer
+arena_alloc_block (arena *arena, gsize size)
+{
+  arena_block *block;
+  char *data;
+
+  if (size > ARENA_LARGE_SIZE) {
+    block = g_malloc (ARENA_BLOCK_HEADER + size);
+
+    /* Keep allocating from the current block, which may still have room */
+    if (arena->blocks != NULL) {
+      block->next = arena->blocks->next;
+      arena->blocks->next = block;
+    } else {
+      block->next = NULL;
+      arena->blocks = block;
+    }
+
+    return (char *)block + ARENA_BLOCK_HEADER;
+  }
+
+  block = g_malloc (ARENA_BLOCK_HEADER + ARENA_BLOCK_SIZE);
+  block->next = arena->blocks;
+  arena->blocks = block;
+
+  data = (char *)block + ARENA_BLOCK_HEADER;
+  arena->next = data + size;
+  arena->end = data + ARENA_BLOCK_SIZE;
+
+  return data;
+}
+
+/* Memory is aligned for any type, and lives as long as the arena */
+gpointer
+arena_alloc (arena *arena, gsize size)
+{
+  gpointer data;
+
+  size = ARENA_ALIGN (MAX (size, 1));
+
+  if (G_UNLIKELY (size > (gsize)(arena->end - arena->next)))
+    return arena_alloc_block (arena, size);
+
+  data = arena->next;
+  arena->next += size;
+
+  return data;
+}
+
+gpointer
+arena_alloc0 (arena *arena, gsize size)
+{
+  return memset (arena_alloc (arena, size), 0, size);
+}
+
+/* Copy the first length bytes of string, which needn't be nul terminated */
+char *
+arena_strndup (arena *arena, const char *string, gsize length)
+{
+  char *copy;
+
+  copy = arena_alloc (arena, length + 1);
+  memcpy (copy, string, length);
+  copy[length] = '\0';
+
+  return copy;
+}
+
+char *
+arena_strdup (arena *arena, const char *string)
+{
+  if (string == NULL)
+    return NULL;
+
+  return arena_strndup (arena, string, strlen (string));
+}
+
+char *
+arena_strdup_printf (arena *arena, const char *format, ...)
+{
+  va_list args;
+  char *string;
+  int length;
+
+  va_start (args, format);
+  length = g_vsnprintf (NULL, 0, format, args);
+  va_end (args);
+
+  string = arena_alloc (arena, length + 1);
+
+  va_start (args, format);
+  g_vsnprintf (string, length + 1, format, args);
+  va_end (args);
+
+  return string;
+}
@@ -0,0 +1,42 @@
+/*
+ *  openaltium is a set of tools for opening Altium (TM) library files
+ *  Copyright (C) 2016  Peter Clifton <Peter.Clifton@clifton-electronics.co.uk>
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 2.1 of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this library; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+
+/* Bump allocator for everything decoded out of one library. Allocations
+ * are carved out of large blocks and never freed individually; the whole
+ * arena goes in one go when the library is closed.
+ *
+ * NB: An arena isn't locked, so it must only be used by one thread at a
+ *     time. Work handed to other threads gets arenas of its own.
+ */
+
+typedef struct arena arena;
+
+arena *arena_new (void);
+void arena_free (arena *arena);
+void arena_clear (arena *arena);
+
+gpointer arena_alloc (arena *arena, gsize size);
+gpointer arena_alloc0 (arena *arena, gsize size);
+char *arena_strndup (arena *arena, const char *string, gsize length);
+char *arena_strdup (arena *arena, const char *string);
+char *arena_strdup_printf (arena *arena, const char *format, ...) G_GNUC_PRINTF (2, 3);
+
+#define arena_new_struct(arena, type) ((type *) arena_alloc0 ((arena), sizeof (type)))
+#define arena_new_array(arena, type, n) ((type *) arena_alloc0 ((arena), sizeof (type) * (n)))
@@ -0,0 +1,256 @@
+/*
+ *  openaltium is a set of tools for opening Altium (TM) library files
+ *  Copyright (C) 2016  Peter Clifton <Peter.Clifton@clifton-electronics.co.uk>
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 2.1 of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this library; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <string.h>
+#include <glib.h>
+#include <glib/gstdio.h>
+
+#include "options.h"
+#include "openaltium-error.h"
+#include "pcblib.h"
+#include "schlib.h"
+#include "intlib.h"
+#include "batch.h"
+#include "logging.h"
+
+
+typedef enum {
+  LIBRARY_NONE,
+  LIBRARY_PCBLIB,
+  LIBRARY_SCHLIB,
+  LIBRARY_INTLIB,
+} library_type;
+
+typedef struct {
+  char *path;           /* Library file to convert */
+  char *relpath;        /* Its path relative to the directory being converted */
+  char *output_dir;     /* Directory its converted files go into */
+  library_type type;
+} batch_job;
+
+typedef struct {
+  const conversion_options *options;
+  volatile gint failures;
+} batch_state;
+
+
+static library_type
+library_type_for_filename (const char *filename)
+{
+  library_type type = LIBRARY_NONE;
+  char *lower;
+
+  lower = g_ascii_strdown (filename, -1);
+
+  if (g_str_has_suffix (lower, ".pcblib"))
+    type = LIBRARY_PCBLIB;
+  else if (g_str_has_suffix (lower, ".schlib"))
+    type = LIBRARY_SCHLIB;
+  else if (g_str_has_suffix (lower, ".intlib"))
+    type = LIBRARY_INTLIB;
+
+  g_free (lower);
+  return type;
+}
+
+static void
+batch_job_free (batch_job *job)
+{
+  g_free (job->path);
+  g_free (job->relpath);
+  g_free (job->output_dir);
+  g_slice_free (batch_job, job);
+}
+
+/* Each library gets its own directory, named after its path relative to
+ * the source directory without the extension, so libraries with the same
+ * basename in different places don't trample each other.
+ */
+static char *
+job_output_dir (const conversion_options *options, const char *relpath)
+{
+  char *stem;
+  char *dot;
+  char *dir;
+
+  stem = g_strdup (relpath);
+  dot = strrchr (stem, '.');
+  if (dot != NULL)
+    *dot = '\0';
+
+  dir = conversion_output_path (options, stem);
+  g_free (stem);
+
+  return dir;
+}
+
+static void
+find_libraries (GPtrArray *jobs, const conversion_options *options,
+                const char *dirname, const char *reldir)
+{
+  GError *error = NULL;
+  const char *name;
+  GDir *dir;
+
+  dir = g_dir_open (dirname, 0, &error);
+  if (dir == NULL) {
+    fprintf (stdout, "Error: %s\n", error->message);
+    g_error_free (error);
+    return;
+  }
+
+  while ((name = g_dir_read_name (dir)) != NULL) {
+    char *path = g_build_filename (dirname, name, NULL);
+    char *relpath = (reldir == NULL) ? g_strdup (name) : g_build_filename (reldir, name, NULL);
+    library_type type;
+
+    if (g_file_test (path, G_FILE_TEST_IS_DIR)) {
+      find_libraries (jobs, options, path, relpath);
+    } else if ((type = library_type_for_filename (name)) != LIBRARY_NONE) {
+      batch_job *job = g_slice_new0 (batch_job);
+      job->path = g_strdup (path);
+      job->relpath = g_strdup (relpath);
+      job->output_dir = job_output_dir (options, relpath);
+      job->type = type;
+      g_ptr_array_add (jobs, job);
+    }
+
+    g_free (relpath);
+    g_free (path);
+  }
+
+  g_dir_close (dir);
+}
+
+static bool
+convert_library (batch_job *job, const conversion_options *batch_options, GError **error)
+{
+  conversion_options options = *batch_options;
+  GError *tmp_error = NULL;
+  bool ok = false;
+
+  if (g_mkdir_with_parents (job->output_dir, 0755) != 0) {
+    g_set_error (error, OPENALTIUM_ERROR, OPENALTIUM_ERROR_OUTPUT,
+                 "Couldn't create output directory %s", job->output_dir);
+    return false;
+  }
+
+  options.output_dir = job->output_dir;
+
+  if (!conversion_open_manifest (&options, job->relpath, error))
+    return false;
+
+  if (!conversion_open_raw_dump (&options, job->relpath, error)) {
+    conversion_close_manifest (&options, NULL);
+    return false;
+  }
+
+  switch (job->type) {
+    case LIBRARY_PCBLIB:
+      ok = parse_pcblib_file (job->path, &options, error);
+      break;
+
+    case LIBRARY_SCHLIB:
+      ok = parse_schlib_file (job->path, &options, error);
+      break;
+
+    case LIBRARY_INTLIB:
+      ok = parse_intlib_file (job->path, &options, error);
+      break;
+
+    case LIBRARY_NONE:
+    default:
+      g_assert_not_reached ();
+  }
+
+  if (!conversion_close_raw_dump (&options, &tmp_error)) {
+    if (ok)
+      g_propagate_error (error, tmp_error);
+    else
+      g_error_free (tmp_error);
+    ok = false;
+  }
+
+  if (!conversion_close_manifest (&options, ok ? error : NULL))
+    ok = false;
+
+  return ok;
+}
+
+static void
+convert_library_job (gpointer data, gpointer user_data)
+{
+  batch_job *job = data;
+  batch_state *state = user_data;
+  GError *error = NULL;
+
+  log_info ("Converting '%s' into '%s'\n", job->path, job->output_dir);
+
+  if (!convert_library (job, state->options, &error)) {
+    fprintf (stdout, "ERROR PROCESSING FILE '%s': %s\n", job->path, error->message);
+    g_error_free (error);
+    g_atomic_int_inc (&state->failures);
+  }
+}
+
+int
+convert_directory (const char *source_dir, const conversion_options *options, int jobs)
+{
+  GError *error = NULL;
+  GThreadPool *pool;
+  GPtrArray *libraries;
+  batch_state state;
+  int i;
+
+  if (jobs < 1)
+    jobs = g_get_num_processors ();
+
+  libraries = g_ptr_array_new_with_free_func ((GDestroyNotify) batch_job_free);
+  find_libraries (libraries, options, source_dir, NULL);
+
+  log_info ("Found %u libraries under '%s', converting with %i job(s)\n",
+           libraries->len, source_dir, jobs);
+
+  state.options = options;
+  state.failures = 0;
+
+  pool = g_thread_pool_new (convert_library_job, &state, jobs, TRUE, &error);
+  if (pool == NULL) {
+    fprintf (stdout, "Error: %s\n", error->message);
+    g_error_free (error);
+    g_ptr_array_unref (libraries);
+    return -1;
+  }
+
+  for (i = 0; i < libraries->len; i++)
+    g_thread_pool_push (pool, g_ptr_array_index (libraries, i), NULL);
+
+  /* Wait for all the queued conversions to finish */
+  g_thread_pool_free (pool, FALSE, TRUE);
+
+  log_info ("Converted %u libraries, %i failed\n",
+           libraries->len - state.failures, state.failures);
+
+  g_ptr_array_unref (libraries);
+
+  return state.failures;
+}
@@ -0,0 +1,154 @@
+/*
+ *  openaltium is a set of tools for opening Altium (TM) library files
+ *  Copyright (C) 2016  Peter Clifton <Peter.Clifton@clifton-electronics.co.uk>
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 2.1 of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this library; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+/* Compare writing footprint lines through stdio against the output writer.
+ *
+ * Usage: bench_output [number of lines]
+ */
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <glib.h>
+#include <glib/gstdio.h>
+
+#include "output-writer.h"
+
+
+#define DEFAULT_LINES 2000000
+
+static void
+fprint_coord (FILE *file, int32_t coord)
+{
+  fprintf (file, "%.2fmil", (double)coord / 10000.);
+}
+
+static double
+bench_stdio (const char *filename, const int32_t *coords, int lines)
+{
+  GTimer *timer;
+  FILE *file;
+  double elapsed;
+  int i;
+
+  timer = g_timer_new ();
+
+  file = g_fopen (filename, "w");
+  for (i = 0; i < lines; i++) {
+    const int32_t *c = &coords[i * 5];
+    fprintf (file, "\tElementLine[");
+    fprint_coord (file, c[0]);  fprintf (file, " ");
+    fprint_coord (file, -c[1]); fprintf (file, " ");
+    fprint_coord (file, c[2]);  fprintf (file, " ");
+    fprint_coord (file, -c[3]); fprintf (file, " ");
+    fprint_coord (file, c[4]);  fprintf (file, "]\n");
+  }
+  fclose (file);
+
+  elapsed = g_timer_elapsed (timer, NULL);
+  g_timer_destroy (timer);
+
+  return elapsed;
+}
+
+static double
+bench_writer (const char *filename, const int32_t *coords, int lines)
+{
+  GTimer *timer;
+  output_writer *file;
+  double elapsed;
+  int i;
+
+  timer = g_timer_new ();
+
+  file = output_writer_open (filename, NULL);
+  for (i = 0; i < lines; i++) {
+    const int32_t *c = &coords[i * 5];
+    output_puts (file, "\tElementLine[");
+    output_coord (file, c[0]);  output_putc (file, ' ');
+    output_coord (file, -c[1]); output_putc (file, ' ');
+    output_coord (file, c[2]);  output_putc (file, ' ');
+    output_coord (file, -c[3]); output_putc (file, ' ');
+    output_coord (file, c[4]);  output_puts (file, "]\n");
+  }
+  output_writer_close (file, NULL);
+
+  elapsed = g_timer_elapsed (timer, NULL);
+  g_timer_destroy (timer);
+
+  return elapsed;
+}
+
+int
+main (int argc, char **argv)
+{
+  char *stdio_file;
+  char *writer_file;
+  char *stdio_data;
+  char *writer_data;
+  gsize stdio_length;
+  gsize writer_length;
+  int32_t *coords;
+  double stdio_time;
+  double writer_time;
+  GRand *rand;
+  int lines = DEFAULT_LINES;
+  int i;
+
+  if (argc > 1)
+    lines = atoi (argv[1]);
+
+  /* Typical footprint sized coordinates, +/- 2 inches */
+  rand = g_rand_new_with_seed (1);
+  coords = g_new (int32_t, lines * 5);
+  for (i = 0; i < lines * 5; i++)
+    coords[i] = g_rand_int_range (rand, -20000000, 20000000);
+  g_rand_free (rand);
+
+  stdio_file = g_build_filename (g_get_tmp_dir (), "bench_output_stdio.fp", NULL);
+  writer_file = g_build_filename (g_get_tmp_dir (), "bench_output_writer.fp", NULL);
+
+  stdio_time = bench_stdio (stdio_file, coords, lines);
+  writer_time = bench_writer (writer_file, coords, lines);
+
+  /* Both paths must produce identical files */
+  g_file_get_contents (stdio_file, &stdio_data, &stdio_length, NULL);
+  g_file_get_contents (writer_file, &writer_data, &writer_length, NULL);
+  if (stdio_length != writer_length || memcmp (stdio_data, writer_data, stdio_length) != 0) {
+    fprintf (stderr, "Output differs between stdio and output writer!\n");
+    return EXIT_FAILURE;
+  }
+
+  printf ("%i lines, %lu bytes\n", lines, (unsigned long)writer_length);
+  printf ("stdio:         %.3fs\n", stdio_time);
+  printf ("output writer: %.3fs\n", writer_time);
+  printf ("speedup:       %.2fx\n", stdio_time / writer_time);
+
+  g_unlink (stdio_file);
+  g_unlink (writer_file);
+  g_free (stdio_data);
+  g_free (writer_data);
+  g_free (stdio_file);
+  g_free (writer_file);
+  g_free (coords);
+
+  return EXIT_SUCCESS;
+}
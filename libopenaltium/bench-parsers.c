@@ -0,0 +1,534 @@
+/*
+ *  openaltium is a set of tools for opening Altium (TM) library files
+ *  Copyright (C) 2016  Peter Clifton <Peter.Clifton@clifton-electronics.co.uk>
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 2.1 of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this library; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+/* Measure the throughput of the stream readers, the parameter lists and
+ * the record decoders, on fixed synthetic inputs so runs can be compared.
+ *
+ * Usage: bench_parsers [JSON results file] [label]
+ */
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <glib.h>
+#include <glib/gstdio.h>
+
+#include "content-parser.h"
+#include "arena.h"
+#include "parameters.h"
+#include "models.h"
+#include "output-writer.h"
+#include "footprint.h"
+#include "pcblib-data.h"
+#include "schlib-data.h"
+#include "synth-library.h"
+
+
+#define MIN_SECONDS     0.5     /* Each benchmark repeats until it has run this long */
+#define N_SCALARS       (1 << 18)
+#define N_STRINGS       20000
+#define N_RECORDS       2000
+#define N_SYMBOLS       200
+
+/* One pass over the input; returns the number of records handled, 0 on failure */
+typedef guint64 (*bench_func) (gpointer data);
+
+typedef struct {
+  const char *name;
+  gsize bytes;          /* Of input, per pass */
+  guint64 records;      /* Per pass */
+  guint passes;
+  double seconds;
+} bench_result;
+
+static volatile guint64 sink;   /* Keeps the compiler from dropping reads */
+
+static void
+run_bench (GArray *results, const char *name, bench_func func, gpointer data, gsize bytes)
+{
+  bench_result result = {name, bytes, 0, 0, 0.};
+  GTimer *timer;
+
+  /* Warm up, and check the input decodes at all */
+  result.records = func (data);
+  if (result.records == 0) {
+    fprintf (stderr, "%s: couldn't decode the input!\n", name);
+    exit (EXIT_FAILURE);
+  }
+
+  timer = g_timer_new ();
+  do {
+    func (data);
+    result.passes++;
+  } while (g_timer_elapsed (timer, NULL) < MIN_SECONDS);
+  result.seconds = g_timer_elapsed (timer, NULL);
+  g_timer_destroy (timer);
+
+  printf ("%-32s %10.1f MB/s %14.0f records/s\n", name,
+          result.bytes * result.passes / result.seconds / 1e6,
+          result.records * result.passes / result.seconds);
+
+  g_array_append_val (results, result);
+}
+
+static file_content
+content_from_array (GByteArray *array)
+{
+  file_content content = {(char *) array->data, array->len, 0, NULL};
+  return content;
+}
+
+
+/* Stream readers */
+
+static guint64
+bench_get_uint32 (gpointer data)
+{
+  file_content content = *(file_content *) data;
+  uint32_t value;
+  guint64 sum = 0;
+  guint64 n = 0;
+
+  while (content_get_uint32 (&content, &value)) {
+    sum += value;
+    n++;
+  }
+
+  sink = sum;
+  return n;
+}
+
+static guint64
+bench_get_double (gpointer data)
+{
+  file_content content = *(file_content *) data;
+  double value;
+  double sum = 0.;
+  guint64 n = 0;
+
+  while (content_get_double (&content, &value)) {
+    sum += value;
+    n++;
+  }
+
+  sink = sum;
+  return n;
+}
+
+static guint64
+bench_get_int32_array (gpointer data)
+{
+  file_content content = *(file_content *) data;
+  int32_t values[8];
+  guint64 sum = 0;
+  guint64 n = 0;
+
+  while (content_get_int32_array (&content, values, 8)) {
+    sum += values[0] + values[7];
+    n++;
+  }
+
+  sink = sum;
+  return n;
+}
+
+static guint64
+bench_multi_prefixed_strings (gpointer data)
+{
+  file_content content = *(file_content *) data;
+  content_string view;
+  guint64 sum = 0;
+  guint64 n = 0;
+
+  while (content.cursor < content.length &&
+         content_get_length_multi_prefixed_string_view (&content, &view)) {
+    sum += view.length;
+    n++;
+  }
+
+  sink = sum;
+  return n;
+}
+
+static guint64
+bench_dword_prefixed_strings (gpointer data)
+{
+  file_content content = *(file_content *) data;
+  content_string view;
+  guint64 sum = 0;
+  guint64 n = 0;
+
+  while (content.cursor < content.length &&
+         content_get_length_dword_prefixed_string_view (&content, &view)) {
+    sum += view.length;
+    n++;
+  }
+
+  sink = sum;
+  return n;
+}
+
+
+/* Parameter lists */
+
+typedef struct {
+  char **strings;
+  arena *arena;
+  parameter_list *list;
+} parameters_bench;
+
+/* Typical SchLib records, one of each kind the decoders see most */
+static const char *parameter_strings[] = {
+  "|RECORD=1|LIBREFERENCE=LM358|%UTF8%COMPONENTDESCRIPTION=Dual operational amplifier"
+    "|PARTCOUNT=3|DISPLAYMODECOUNT=1|INDEXINSHEET=-1|OWNERPARTID=-1|CURRENTPARTID=1"
+    "|LIBRARYPATH=*|SOURCELIBRARYNAME=*|SHEETPARTFILENAME=*|TARGETFILENAME=*"
+    "|UNIQUEID=ABCDEFGH|AREACOLOR=11599871|COLOR=128|PARTIDLOCKED=T",
+  "|RECORD=6|OWNERPARTID=1|LINEWIDTH=1|COLOR=16711680|LOCATIONCOUNT=4"
+    "|X1=10|Y1=-20|X2=30|Y2=-20|X3=30|Y3=20|X4=10|Y4=20",
+  "|RECORD=14|OWNERPARTID=1|LOCATION.X=-30|LOCATION.Y=-40|CORNER.X=30|CORNER.Y=40"
+    "|LINEWIDTH=1|COLOR=128|AREACOLOR=11599871|ISSOLID=T",
+  "|RECORD=41|OWNERPARTID=-1|LOCATION.X=-5|LOCATION.Y=-15|COLOR=8388608|FONTID=1"
+    "|ISHIDDEN=T|TEXT=*|NAME=Comment|UNIQUEID=HGFEDCBA",
+};
+
+static const char *parameter_lookups[] = {
+  "RECORD", "OWNERPARTID", "LOCATION.X", "LOCATION.Y", "LINEWIDTH",
+  "COLOR", "ISSOLID", "NAME", "X3", "MISSING",
+};
+
+static guint64
+bench_parameter_list_new (gpointer data)
+{
+  parameters_bench *bench = data;
+  guint64 n;
+
+  for (n = 0; bench->strings[n] != NULL; n++)
+    parameter_list_free (parameter_list_new_from_string (bench->strings[n]));
+
+  return n;
+}
+
+static guint64
+bench_parameter_list_in_arena (gpointer data)
+{
+  parameters_bench *bench = data;
+  guint64 n;
+
+  for (n = 0; bench->strings[n] != NULL; n++)
+    parameter_list_new_in_arena (bench->arena, bench->strings[n], strlen (bench->strings[n]));
+
+  arena_clear (bench->arena);
+  return n;
+}
+
+static guint64
+bench_parameter_list_get (gpointer data)
+{
+  parameters_bench *bench = data;
+  guint64 sum = 0;
+  guint64 n = 0;
+  int i, j;
+
+  for (i = 0; i < N_STRINGS / G_N_ELEMENTS (parameter_lookups); i++) {
+    for (j = 0; j < G_N_ELEMENTS (parameter_lookups); j++) {
+      sum += parameter_list_get_int (bench->list, parameter_lookups[j]);
+      sum += parameter_list_get_double (bench->list, parameter_lookups[j]);
+      sum += parameter_list_get_dimension (bench->list, parameter_lookups[j]);
+      sum += parameter_list_get_bool (bench->list, parameter_lookups[j]);
+      sum += strlen (parameter_list_peek_string (bench->list, parameter_lookups[j]));
+      n += 5;
+    }
+  }
+
+  sink = sum;
+  return n;
+}
+
+
+/* PcbLib record decoders */
+
+typedef struct {
+  file_content content;
+  footprint *fp;
+  const model_map *map;
+  guint64 n_records;
+} pcblib_bench;
+
+/* The map of the one model bodies place, which is never extracted */
+static model_map *
+make_model_map (arena *arena)
+{
+  parameter_list *list;
+  char *parameters;
+  model_map *map;
+
+  parameters = synth_model_parameters (0);
+  list = parameter_list_new_from_string (parameters);
+  g_free (parameters);
+
+  map = model_map_new ();
+  model_map_insert (map, model_info_new_from_parameters (arena, list));
+  parameter_list_free (list);
+
+  return map;
+}
+
+/* A footprint of N_RECORDS records of one type, bodies placing the
+ * model in map
+ */
+static void
+make_pcblib_bench (pcblib_bench *bench, int type, const model_map *map)
+{
+  GByteArray *array = g_byte_array_new ();
+  synth_record_mix mix = {{0}};
+  char *model_id = synth_model_id (0);
+
+  mix.counts[type] = N_RECORDS;
+  bench->n_records = synth_pcblib_footprint (array, "BENCH", &mix, model_id);
+  g_free (model_id);
+
+  bench->content = content_from_array (array);
+  g_byte_array_free (array, FALSE);
+  bench->fp = footprint_new ();
+  bench->map = map;
+}
+
+static guint64
+bench_decode_pcblib (gpointer data)
+{
+  pcblib_bench *bench = data;
+  file_content content = bench->content;
+
+  footprint_clear (bench->fp);
+  if (!decode_pcblib_data (bench->fp, &content, bench->n_records, bench->map, 0, NULL))
+    return 0;
+
+  return bench->n_records;
+}
+
+
+/* SchLib symbols */
+
+typedef struct {
+  file_content content;
+  arena *arena;
+  char *filename;
+  guint64 n_records;
+} schlib_bench;
+
+static void
+make_schlib_bench (schlib_bench *bench)
+{
+  GByteArray *array = g_byte_array_new ();
+  int i, j;
+
+  bench->n_records = 0;
+  for (i = 0; i < N_SYMBOLS; i++) {
+    for (j = 0; j < G_N_ELEMENTS (parameter_strings); j++) {
+      synth_append_dword_prefixed_string (array, parameter_strings[j]);
+      bench->n_records++;
+    }
+    for (j = 0; j < 8; j++) {
+      synth_schlib_binary_pin (array, 1, j);
+      bench->n_records++;
+    }
+  }
+
+  bench->content = content_from_array (array);
+  g_byte_array_free (array, FALSE);
+  bench->arena = arena_new ();
+  bench->filename = g_build_filename (g_get_tmp_dir (), "bench_parsers.sym", NULL);
+}
+
+static guint64
+bench_decode_schlib (gpointer data)
+{
+  schlib_bench *bench = data;
+  file_content content = bench->content;
+  output_writer *file;
+  bool ok;
+
+  file = output_writer_open (bench->filename, NULL);
+  if (file == NULL)
+    return 0;
+
+  ok = decode_schlib_data (bench->arena, &file, 1, &content, NULL);
+  output_writer_close (file, NULL);
+  arena_clear (bench->arena);
+
+  return ok ? bench->n_records : 0;
+}
+
+
+static bool
+write_json (GArray *results, const char *filename, const char *label, GError **error)
+{
+  GString *json;
+  char *escaped;
+  bool ok;
+  int i;
+
+  json = g_string_new ("{\n");
+
+  escaped = g_strescape (label, NULL);
+  g_string_append_printf (json, "  \"label\": \"%s\",\n", escaped);
+  g_free (escaped);
+
+  g_string_append (json, "  \"results\": [\n");
+  for (i = 0; i < results->len; i++) {
+    bench_result *result = &g_array_index (results, bench_result, i);
+
+    g_string_append_printf (json,
+                            "    {\"name\": \"%s\", \"bytes\": %" G_GSIZE_FORMAT
+                            ", \"records\": %" G_GUINT64_FORMAT ", \"passes\": %u"
+                            ", \"seconds\": %.6f, \"mb_per_s\": %.3f, \"records_per_s\": %.1f}%s\n",
+                            result->name, result->bytes, result->records, result->passes,
+                            result->seconds,
+                            result->bytes * result->passes / result->seconds / 1e6,
+                            result->records * result->passes / result->seconds,
+                            (i + 1 < results->len) ? "," : "");
+  }
+  g_string_append (json, "  ]\n}\n");
+
+  ok = g_file_set_contents (filename, json->str, json->len, error);
+  g_string_free (json, TRUE);
+
+  return ok;
+}
+
+int
+main (int argc, char **argv)
+{
+  GArray *results;
+  GByteArray *array;
+  GRand *rand;
+  GError *error = NULL;
+  file_content scalars;
+  file_content names;
+  file_content strings;
+  parameters_bench parameters;
+  pcblib_bench pcblib;
+  arena *models_arena;
+  model_map *models;
+  schlib_bench schlib;
+  gsize parameters_bytes = 0;
+  int i;
+
+  static const struct {
+    const char *name;
+    int type;
+  } pcblib_records[] = {
+    {"decode_pcblib_data arc",    1},
+    {"decode_pcblib_data pad",    2},
+    {"decode_pcblib_data via",    3},
+    {"decode_pcblib_data track",  4},
+    {"decode_pcblib_data text",   5},
+    {"decode_pcblib_data fill",   6},
+    {"decode_pcblib_data region", 11},
+    {"decode_pcblib_data body",   12},
+  };
+
+  results = g_array_new (FALSE, FALSE, sizeof (bench_result));
+
+  /* Stream readers */
+  rand = g_rand_new_with_seed (1);
+  array = g_byte_array_new ();
+  for (i = 0; i < N_SCALARS; i++)
+    synth_append_uint32 (array, g_rand_int (rand));
+  scalars = content_from_array (array);
+  g_byte_array_free (array, FALSE);
+
+  array = g_byte_array_new ();
+  for (i = 0; i < N_STRINGS; i++) {
+    char name[32];
+    g_snprintf (name, sizeof (name), "FOOTPRINT_%.*s_%i", g_rand_int_range (rand, 0, 12),
+                "SOIC127P600X", i);
+    synth_append_multi_prefixed_string (array, name);
+  }
+  names = content_from_array (array);
+  g_byte_array_free (array, FALSE);
+
+  array = g_byte_array_new ();
+  for (i = 0; i < N_STRINGS; i++)
+    synth_append_dword_prefixed_string (array, parameter_strings[i % G_N_ELEMENTS (parameter_strings)]);
+  strings = content_from_array (array);
+  g_byte_array_free (array, FALSE);
+  g_rand_free (rand);
+
+  run_bench (results, "content_get_uint32", bench_get_uint32, &scalars, scalars.length);
+  run_bench (results, "content_get_double", bench_get_double, &scalars, scalars.length);
+  run_bench (results, "content_get_int32_array", bench_get_int32_array, &scalars, scalars.length);
+  run_bench (results, "multi prefixed string views", bench_multi_prefixed_strings, &names, names.length);
+  run_bench (results, "dword prefixed string views", bench_dword_prefixed_strings, &strings, strings.length);
+
+  /* Parameter lists */
+  parameters.strings = g_new0 (char *, N_STRINGS + 1);
+  for (i = 0; i < N_STRINGS; i++) {
+    parameters.strings[i] = g_strdup (parameter_strings[i % G_N_ELEMENTS (parameter_strings)]);
+    parameters_bytes += strlen (parameters.strings[i]);
+  }
+  parameters.arena = arena_new ();
+  parameters.list = parameter_list_new_from_string (parameter_strings[1]);
+
+  run_bench (results, "parameter_list_new_from_string", bench_parameter_list_new,
+             &parameters, parameters_bytes);
+  run_bench (results, "parameter_list_new_in_arena", bench_parameter_list_in_arena,
+             &parameters, parameters_bytes);
+  run_bench (results, "parameter_list_get_*", bench_parameter_list_get, &parameters, 0);
+
+  /* Record decoders */
+  models_arena = arena_new ();
+  models = make_model_map (models_arena);
+
+  for (i = 0; i < G_N_ELEMENTS (pcblib_records); i++) {
+    make_pcblib_bench (&pcblib, pcblib_records[i].type, models);
+    run_bench (results, pcblib_records[i].name, bench_decode_pcblib,
+               &pcblib, pcblib.content.length);
+    footprint_free (pcblib.fp);
+    g_free (pcblib.content.data);
+  }
+
+  make_schlib_bench (&schlib);
+  run_bench (results, "decode_schlib_data", bench_decode_schlib, &schlib, schlib.content.length);
+
+  if (argc > 1 &&
+      !write_json (results, argv[1], (argc > 2) ? argv[2] : "", &error)) {
+    fprintf (stderr, "Couldn't save the results: %s\n", error->message);
+    g_error_free (error);
+    return EXIT_FAILURE;
+  }
+
+  g_unlink (schlib.filename);
+  g_free (schlib.filename);
+  g_free (schlib.content.data);
+  arena_free (schlib.arena);
+  model_map_free (models);
+  arena_free (models_arena);
+  parameter_list_free (parameters.list);
+  arena_free (parameters.arena);
+  g_strfreev (parameters.strings);
+  g_free (strings.data);
+  g_free (names.data);
+  g_free (scalars.data);
+  g_array_unref (results);
+
+  return EXIT_SUCCESS;
+}
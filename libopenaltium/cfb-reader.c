@@ -0,0 +1,600 @@
+/*
+ *  openaltium is a set of tools for opening Altium (TM) library files
+ *  Copyright (C) 2016  Peter Clifton <Peter.Clifton@clifton-electronics.co.uk>
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 2.1 of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this library; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <string.h>
+#include <glib.h>
+#include <gio/gio.h>
+#include <gsf/gsf.h>
+#include <gsf/gsf-infile.h>
+
+#include "content-parser.h"
+#include "cfb-reader.h"
+
+
+#define CFB_HEADER_SIZE     512
+#define CFB_DIRENT_SIZE     128
+#define CFB_HEADER_DIFAT    109
+
+#define CFB_FREESECT        0xFFFFFFFF
+#define CFB_ENDOFCHAIN      0xFFFFFFFE
+#define CFB_NOSTREAM        0xFFFFFFFF
+
+#define CFB_TYPE_STORAGE    1
+#define CFB_TYPE_STREAM     2
+#define CFB_TYPE_ROOT       5
+
+#define CFB_DATA_KEY        "openaltium-cfb-file"
+
+static const uint8_t cfb_signature[8] = {0xD0, 0xCF, 0x11, 0xE0, 0xA1, 0xB1, 0x1A, 0xE1};
+
+typedef struct {
+  char *name;
+  uint8_t type;
+  uint32_t left;
+  uint32_t right;
+  uint32_t child;
+  uint32_t start;
+  uint64_t size;
+} cfb_entry;
+
+struct cfb_file {
+  GBytes *bytes;
+  const uint8_t *data;
+  size_t length;
+
+  unsigned int sector_shift;
+  unsigned int mini_sector_shift;
+  uint32_t mini_stream_cutoff;
+
+  uint32_t *fat;
+  uint32_t n_fat;
+  uint32_t *minifat;
+  uint32_t n_minifat;
+  uint32_t *ministream;         /* Sector chain holding the mini stream */
+  uint32_t n_ministream;
+
+  cfb_entry *entries;
+  uint32_t n_entries;
+  GHashTable *paths;            /* path -> cfb_entry */
+};
+
+
+static uint16_t
+get_le16 (const uint8_t *p)
+{
+  return (uint16_t)p[0] | (uint16_t)p[1] << 8;
+}
+
+static uint32_t
+get_le32 (const uint8_t *p)
+{
+  return (uint32_t)p[0] | (uint32_t)p[1] << 8 | (uint32_t)p[2] << 16 | (uint32_t)p[3] << 24;
+}
+
+static uint64_t
+get_le64 (const uint8_t *p)
+{
+  return (uint64_t)get_le32 (p) | (uint64_t)get_le32 (p + 4) << 32;
+}
+
+static size_t
+sector_size (cfb_file *cfb)
+{
+  return (size_t)1 << cfb->sector_shift;
+}
+
+/* Returns a pointer to the start of a regular sector, or NULL if it lies outside the file */
+static const uint8_t *
+sector_data (cfb_file *cfb, uint32_t sector)
+{
+  uint64_t offset = ((uint64_t)sector + 1) << cfb->sector_shift;
+
+  if (sector >= CFB_ENDOFCHAIN - 3 ||
+      offset + sector_size (cfb) > cfb->length)
+    return NULL;
+
+  return &cfb->data[offset];
+}
+
+/* Follow a chain in the given allocation table, returning the sector numbers */
+static uint32_t *
+read_chain (const uint32_t *table, uint32_t n_table, uint32_t start, uint32_t *n_chain)
+{
+  GArray *chain;
+  uint32_t sector;
+
+  chain = g_array_new (FALSE, FALSE, sizeof (uint32_t));
+
+  for (sector = start; sector != CFB_ENDOFCHAIN; sector = table[sector]) {
+    /* Loops or out of range links mean a corrupt file */
+    if (sector >= n_table || chain->len >= n_table) {
+      g_array_free (chain, TRUE);
+      return NULL;
+    }
+    g_array_append_val (chain, sector);
+  }
+
+  *n_chain = chain->len;
+  return (uint32_t *)g_array_free (chain, FALSE);
+}
+
+/* Concatenate the regular sectors of a chain into a newly allocated buffer */
+static uint8_t *
+copy_chain (cfb_file *cfb, const uint32_t *chain, uint32_t n_chain)
+{
+  uint8_t *buffer;
+  uint32_t i;
+
+  buffer = g_malloc ((size_t)n_chain << cfb->sector_shift);
+
+  for (i = 0; i < n_chain; i++) {
+    const uint8_t *sector = sector_data (cfb, chain[i]);
+    if (sector == NULL) {
+      g_free (buffer);
+      return NULL;
+    }
+    memcpy (&buffer[(size_t)i << cfb->sector_shift], sector, sector_size (cfb));
+  }
+
+  return buffer;
+}
+
+static bool
+load_fat (cfb_file *cfb, const uint8_t *header, GError **error)
+{
+  uint32_t n_fat_sectors = get_le32 (&header[0x2C]);
+  uint32_t difat_sector = get_le32 (&header[0x44]);
+  uint32_t n_difat_sectors = get_le32 (&header[0x48]);
+  uint32_t per_sector = sector_size (cfb) / 4;
+  uint32_t *fat_sectors;
+  uint32_t n = 0;
+  uint32_t i;
+
+  if (n_fat_sectors > cfb->length >> cfb->sector_shift) {
+    g_set_error (error, G_FILE_ERROR, G_FILE_ERROR_FAILED, "Bad FAT sector count %u", n_fat_sectors);
+    return false;
+  }
+
+  fat_sectors = g_new (uint32_t, n_fat_sectors);
+
+  for (i = 0; i < CFB_HEADER_DIFAT && n < n_fat_sectors; i++)
+    fat_sectors[n++] = get_le32 (&header[0x4C + 4 * i]);
+
+  /* Any further FAT sector locations are listed in the DIFAT chain */
+  for (i = 0; i < n_difat_sectors && n < n_fat_sectors; i++) {
+    const uint8_t *difat = sector_data (cfb, difat_sector);
+    uint32_t j;
+
+    if (difat == NULL) {
+      g_set_error (error, G_FILE_ERROR, G_FILE_ERROR_FAILED, "Bad DIFAT sector %u", difat_sector);
+      g_free (fat_sectors);
+      return false;
+    }
+
+    for (j = 0; j < per_sector - 1 && n < n_fat_sectors; j++)
+      fat_sectors[n++] = get_le32 (&difat[4 * j]);
+
+    difat_sector = get_le32 (&difat[4 * (per_sector - 1)]);
+  }
+
+  if (n < n_fat_sectors) {
+    g_set_error (error, G_FILE_ERROR, G_FILE_ERROR_FAILED, "Truncated DIFAT");
+    g_free (fat_sectors);
+    return false;
+  }
+
+  cfb->n_fat = n_fat_sectors * per_sector;
+  cfb->fat = g_new (uint32_t, cfb->n_fat);
+
+  for (i = 0; i < n_fat_sectors; i++) {
+    const uint8_t *sector = sector_data (cfb, fat_sectors[i]);
+    uint32_t j;
+
+    if (sector == NULL) {
+      g_set_error (error, G_FILE_ERROR, G_FILE_ERROR_FAILED, "Bad FAT sector %u", fat_sectors[i]);
+      g_free (fat_sectors);
+      return false;
+    }
+
+    for (j = 0; j < per_sector; j++)
+      cfb->fat[i * per_sector + j] = get_le32 (&sector[4 * j]);
+  }
+
+  g_free (fat_sectors);
+  return true;
+}
+
+static bool
+load_minifat (cfb_file *cfb, const uint8_t *header, GError **error)
+{
+  uint32_t start = get_le32 (&header[0x3C]);
+  uint32_t *chain;
+  uint32_t n_chain;
+  uint8_t *buffer;
+  uint32_t i;
+
+  if (start == CFB_ENDOFCHAIN || start == CFB_FREESECT)
+    return true; /* No small streams in this file */
+
+  chain = read_chain (cfb->fat, cfb->n_fat, start, &n_chain);
+  if (chain == NULL ||
+      (buffer = copy_chain (cfb, chain, n_chain)) == NULL) {
+    g_set_error (error, G_FILE_ERROR, G_FILE_ERROR_FAILED, "Bad mini FAT chain");
+    g_free (chain);
+    return false;
+  }
+
+  cfb->n_minifat = (n_chain << cfb->sector_shift) / 4;
+  cfb->minifat = g_new (uint32_t, cfb->n_minifat);
+  for (i = 0; i < cfb->n_minifat; i++)
+    cfb->minifat[i] = get_le32 (&buffer[4 * i]);
+
+  g_free (buffer);
+  g_free (chain);
+  return true;
+}
+
+static bool
+load_directory (cfb_file *cfb, const uint8_t *header, GError **error)
+{
+  uint32_t *chain;
+  uint32_t n_chain;
+  uint8_t *buffer;
+  uint32_t i;
+
+  chain = read_chain (cfb->fat, cfb->n_fat, get_le32 (&header[0x30]), &n_chain);
+  if (chain == NULL || n_chain == 0 ||
+      (buffer = copy_chain (cfb, chain, n_chain)) == NULL) {
+    g_set_error (error, G_FILE_ERROR, G_FILE_ERROR_FAILED, "Bad directory chain");
+    g_free (chain);
+    return false;
+  }
+  g_free (chain);
+
+  cfb->n_entries = (n_chain << cfb->sector_shift) / CFB_DIRENT_SIZE;
+  cfb->entries = g_new0 (cfb_entry, cfb->n_entries);
+
+  for (i = 0; i < cfb->n_entries; i++) {
+    const uint8_t *dirent = &buffer[i * CFB_DIRENT_SIZE];
+    cfb_entry *entry = &cfb->entries[i];
+    uint16_t name_bytes = get_le16 (&dirent[0x40]);
+    gunichar2 name[32];
+    int j;
+
+    entry->type = dirent[0x42];
+    entry->left = get_le32 (&dirent[0x44]);
+    entry->right = get_le32 (&dirent[0x48]);
+    entry->child = get_le32 (&dirent[0x4C]);
+    entry->start = get_le32 (&dirent[0x74]);
+    entry->size = get_le64 (&dirent[0x78]);
+
+    /* Version 3 files may have junk in the high part of the size */
+    if (cfb->sector_shift == 9)
+      entry->size &= 0xFFFFFFFF;
+
+    if (name_bytes < 2 || name_bytes > 64)
+      continue;
+
+    for (j = 0; j < name_bytes / 2 - 1; j++)
+      name[j] = get_le16 (&dirent[2 * j]);
+    entry->name = g_utf16_to_utf8 (name, name_bytes / 2 - 1, NULL, NULL, NULL);
+  }
+
+  g_free (buffer);
+  return true;
+}
+
+/* Walk the red-black sibling trees, recording the full path of each entry */
+static void
+index_paths (cfb_file *cfb)
+{
+  GArray *stack;
+  char **prefixes;
+  uint8_t *visited;
+  uint32_t i;
+
+  cfb->paths = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
+
+  if (cfb->n_entries == 0 || cfb->entries[0].child == CFB_NOSTREAM)
+    return;
+
+  stack = g_array_new (FALSE, FALSE, sizeof (uint32_t));
+  prefixes = g_new0 (char *, cfb->n_entries);
+  visited = g_new0 (uint8_t, cfb->n_entries);
+
+  g_array_append_val (stack, cfb->entries[0].child);
+  visited[0] = 1;
+
+  while (stack->len > 0) {
+    uint32_t index = g_array_index (stack, uint32_t, stack->len - 1);
+    const char *prefix = prefixes[index];
+    cfb_entry *entry;
+    char *path;
+
+    g_array_set_size (stack, stack->len - 1);
+
+    if (index >= cfb->n_entries || visited[index])
+      continue;
+    visited[index] = 1;
+    entry = &cfb->entries[index];
+
+    /* Siblings share our prefix */
+    if (entry->left < cfb->n_entries && !visited[entry->left]) {
+      prefixes[entry->left] = g_strdup (prefix);
+      g_array_append_val (stack, entry->left);
+    }
+    if (entry->right < cfb->n_entries && !visited[entry->right]) {
+      prefixes[entry->right] = g_strdup (prefix);
+      g_array_append_val (stack, entry->right);
+    }
+
+    if (entry->name == NULL)
+      continue;
+
+    path = (prefix == NULL) ? g_strdup (entry->name) :
+                              g_strconcat (prefix, "/", entry->name, NULL);
+
+    if (entry->type == CFB_TYPE_STORAGE &&
+        entry->child < cfb->n_entries && !visited[entry->child]) {
+      prefixes[entry->child] = g_strdup (path);
+      g_array_append_val (stack, entry->child);
+    }
+
+    g_hash_table_replace (cfb->paths, path, entry);
+  }
+
+  for (i = 0; i < cfb->n_entries; i++)
+    g_free (prefixes[i]);
+  g_free (prefixes);
+  g_free (visited);
+  g_array_free (stack, TRUE);
+}
+
+cfb_file *
+cfb_file_new_from_bytes (GBytes *bytes, GError **error)
+{
+  cfb_file *cfb;
+  const uint8_t *header;
+  cfb_entry *root;
+
+  cfb = g_slice_new0 (cfb_file);
+  cfb->bytes = g_bytes_ref (bytes);
+  cfb->data = g_bytes_get_data (bytes, &cfb->length);
+
+  header = cfb->data;
+  if (cfb->length < CFB_HEADER_SIZE ||
+      memcmp (header, cfb_signature, sizeof (cfb_signature)) != 0) {
+    g_set_error (error, G_FILE_ERROR, G_FILE_ERROR_FAILED, "Not a compound file");
+    goto error;
+  }
+
+  cfb->sector_shift = get_le16 (&header[0x1E]);
+  cfb->mini_sector_shift = get_le16 (&header[0x20]);
+  cfb->mini_stream_cutoff = get_le32 (&header[0x38]);
+
+  if ((cfb->sector_shift != 9 && cfb->sector_shift != 12) ||
+      cfb->mini_sector_shift != 6) {
+    g_set_error (error, G_FILE_ERROR, G_FILE_ERROR_FAILED,
+                 "Unsupported sector sizes (shift %u, mini shift %u)",
+                 cfb->sector_shift, cfb->mini_sector_shift);
+    goto error;
+  }
+
+  if (!load_fat (cfb, header, error) ||
+      !load_minifat (cfb, header, error) ||
+      !load_directory (cfb, header, error))
+    goto error;
+
+  /* The root entry owns the mini stream */
+  root = &cfb->entries[0];
+  if (root->start != CFB_ENDOFCHAIN && root->size > 0) {
+    cfb->ministream = read_chain (cfb->fat, cfb->n_fat, root->start, &cfb->n_ministream);
+    if (cfb->ministream == NULL) {
+      g_set_error (error, G_FILE_ERROR, G_FILE_ERROR_FAILED, "Bad mini stream chain");
+      goto error;
+    }
+  }
+
+  index_paths (cfb);
+
+  return cfb;
+
+error:
+  cfb_file_free (cfb);
+  return NULL;
+}
+
+cfb_file *
+cfb_file_open (const char *filename, GError **error)
+{
+  GMappedFile *mapped;
+  GBytes *bytes;
+  cfb_file *cfb;
+
+  mapped = g_mapped_file_new (filename, FALSE, error);
+  if (mapped == NULL)
+    return NULL;
+
+  bytes = g_mapped_file_get_bytes (mapped);
+  g_mapped_file_unref (mapped);
+
+  cfb = cfb_file_new_from_bytes (bytes, error);
+  g_bytes_unref (bytes);
+
+  return cfb;
+}
+
+void
+cfb_file_free (cfb_file *cfb)
+{
+  uint32_t i;
+
+  if (cfb == NULL)
+    return;
+
+  if (cfb->paths != NULL)
+    g_hash_table_unref (cfb->paths);
+
+  for (i = 0; i < cfb->n_entries; i++)
+    g_free (cfb->entries[i].name);
+
+  g_free (cfb->entries);
+  g_free (cfb->ministream);
+  g_free (cfb->minifat);
+  g_free (cfb->fat);
+  g_bytes_unref (cfb->bytes);
+  g_slice_free (cfb_file, cfb);
+}
+
+/* Locate the file offset of the given byte offset within the mini stream */
+static const uint8_t *
+ministream_data (cfb_file *cfb, uint64_t offset, size_t length)
+{
+  uint64_t index = offset >> cfb->sector_shift;
+  size_t within = offset & (sector_size (cfb) - 1);
+  const uint8_t *sector;
+
+  if (index >= cfb->n_ministream || within + length > sector_size (cfb))
+    return NULL;
+
+  sector = sector_data (cfb, cfb->ministream[index]);
+  return (sector == NULL) ? NULL : sector + within;
+}
+
+/* Whether there is a storage or stream at path */
+bool
+cfb_file_has_path (cfb_file *cfb, const char *path)
+{
+  return g_hash_table_contains (cfb->paths, path);
+}
+
+file_content *
+cfb_file_get_content (cfb_file *cfb, const char *path)
+{
+  cfb_entry *entry;
+  bool small;
+  const uint32_t *table;
+  uint32_t n_table;
+  unsigned int shift;
+  size_t block_size;
+  const uint8_t *first = NULL;
+  const uint8_t *expected = NULL;
+  bool contiguous = true;
+  uint8_t *copy = NULL;
+  uint64_t done = 0;
+  uint32_t sector;
+  uint32_t steps = 0;
+  file_content *content;
+
+  entry = g_hash_table_lookup (cfb->paths, path);
+  if (entry == NULL || entry->type != CFB_TYPE_STREAM || entry->size > G_MAXUINT32)
+    return NULL;
+
+  small = entry->size < cfb->mini_stream_cutoff;
+  table = small ? cfb->minifat : cfb->fat;
+  n_table = small ? cfb->n_minifat : cfb->n_fat;
+  shift = small ? cfb->mini_sector_shift : cfb->sector_shift;
+  block_size = (size_t)1 << shift;
+
+  /* Walk the chain once; only fall back to copying if the sectors are fragmented */
+  for (sector = entry->start; done < entry->size; sector = table[sector]) {
+    size_t chunk = MIN (block_size, entry->size - done);
+    const uint8_t *block;
+
+    if (sector >= n_table || steps++ > n_table)
+      goto error;
+
+    block = small ? ministream_data (cfb, (uint64_t)sector << shift, chunk) :
+                    sector_data (cfb, sector);
+    if (block == NULL)
+      goto error;
+
+    if (first == NULL)
+      first = block;
+
+    if (contiguous && expected != NULL && block != expected) {
+      contiguous = false;
+      copy = g_malloc (entry->size);
+      memcpy (copy, first, done);
+    }
+
+    if (!contiguous)
+      memcpy (&copy[done], block, chunk);
+
+    expected = block + chunk;
+    done += chunk;
+  }
+
+  content = g_new0 (file_content, 1);
+  content->cursor = 0;
+  content->length = entry->size;
+
+  if (contiguous) {
+    content->bytes = g_bytes_new_from_bytes (cfb->bytes, (first == NULL) ? 0 : first - cfb->data, entry->size);
+    content->data = (char *)g_bytes_get_data (content->bytes, NULL);
+  } else {
+    content->bytes = g_bytes_new_take (copy, entry->size);
+    content->data = (char *)copy;
+  }
+
+  return content;
+
+error:
+  fprintf (stdout, "Error: Corrupt sector chain for '%s'\n", path);
+  g_free (copy);
+  return NULL;
+}
+
+/* Make the compound file available to streams opened below a GSF root */
+void
+cfb_file_attach (cfb_file *cfb, GsfInfile *root)
+{
+  g_object_set_data_full (G_OBJECT (root), CFB_DATA_KEY, cfb, (GDestroyNotify) cfb_file_free);
+}
+
+/* Returns a view of the named child of a GSF storage, if a mapped
+ * compound file was attached to its root, otherwise NULL.
+ */
+file_content *
+cfb_content_for_child (GsfInfile *storage, const char *name)
+{
+  GsfInput *node;
+  GString *path;
+  cfb_file *cfb;
+  file_content *content;
+
+  path = g_string_new (name);
+
+  for (node = GSF_INPUT (storage);
+       gsf_input_container (node) != NULL;
+       node = GSF_INPUT (gsf_input_container (node))) {
+    g_string_prepend_c (path, '/');
+    g_string_prepend (path, gsf_input_name (node));
+  }
+
+  cfb = g_object_get_data (G_OBJECT (node), CFB_DATA_KEY);
+  content = (cfb == NULL) ? NULL : cfb_file_get_content (cfb, path->str);
+
+  g_string_free (path, TRUE);
+
+  return content;
+}
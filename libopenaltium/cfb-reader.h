@@ -0,0 +1,35 @@
+/*
+ *  openaltium is a set of tools for opening Altium (TM) library files
+ *  Copyright (C) 2016  Peter Clifton <Peter.Clifton@clifton-electronics.co.uk>
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 2.1 of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this library; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+
+/* Read-only compound file (OLE / CFB) reader working in place on a
+ * memory-mapped file. Streams are addressed by their '/' separated path
+ * from the root storage, e.g. "Library/Data".
+ */
+
+typedef struct cfb_file cfb_file;
+
+cfb_file *cfb_file_open (const char *filename, GError **error);
+cfb_file *cfb_file_new_from_bytes (GBytes *bytes, GError **error);
+void cfb_file_free (cfb_file *cfb);
+bool cfb_file_has_path (cfb_file *cfb, const char *path);
+file_content *cfb_file_get_content (cfb_file *cfb, const char *path);
+
+void cfb_file_attach (cfb_file *cfb, GsfInfile *root);
+file_content *cfb_content_for_child (GsfInfile *storage, const char *name);
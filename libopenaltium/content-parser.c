@@ -18,57 +18,67 @@
  */
 
 #include <stdint.h>
+#include <stdbool.h>
 #include <glib.h>
 #include <stdio.h>
+#include <string.h>
 
 #include "content-parser.h"
+#include "logging.h"
 
+
+/* Strings are cut short at an embedded NUL, as g_strndup () would */
 int
-content_check_available (file_content *content, unsigned int length)
+content_get_n_chars_view (file_content *content, unsigned int n_chars, content_string *view)
 {
-  return (content->cursor + length > content->length) ? 0 : 1;
-}
+  const char *span;
+  const char *nul;
 
-/* FIXME: These need to read from the file as little endian, the
- *        implementation only works in Little Endian computers.
- */
-#define CONTENT_GET_TYPE(name, type) \
-int \
-content_get_##name (file_content *content, type *data) \
-{ \
-  g_return_val_if_fail (content_check_available (content, sizeof (type)), 0); \
-  *data = *(type*)&content->data[content->cursor]; \
-  content->cursor += sizeof (type); \
-  return 1; \
-}
+  if (n_chars > G_MAXINT)
+    return 0;
 
-CONTENT_GET_TYPE(uint32, uint32_t)
-CONTENT_GET_TYPE(int32, int32_t)
-CONTENT_GET_TYPE(uint16, uint16_t)
-CONTENT_GET_TYPE(int16, int16_t)
-CONTENT_GET_TYPE(byte, uint8_t)
-CONTENT_GET_TYPE(double, double)
+  span = content_take (content, n_chars);
+  if (span == NULL)
+    return 0;
+
+  nul = memchr (span, '\0', n_chars);
+  view->str = span;
+  view->length = (nul != NULL) ? nul - span : n_chars;
+  return 1;
+}
 
 
 char *
 content_get_n_chars (file_content *content, unsigned int n_chars)
 {
-  char *data;
-  g_return_val_if_fail (content_check_available (content, n_chars), NULL);
-  data = g_strndup (&content->data[content->cursor], n_chars);
-  content->cursor += n_chars;
-  return data;
+  content_string view;
+
+  if (!content_get_n_chars_view (content, n_chars, &view))
+    return NULL;
+  return content_string_dup (view);
 }
 
 
 char *
 content_get_n_wchars (file_content *content, unsigned int n_chars)
 {
+  const char *span;
+  gunichar2 *utf16;
   char *data;
-  g_return_val_if_fail (content_check_available (content, 2 * n_chars), NULL);
+  unsigned int i;
+
+  span = content_take_array (content, n_chars, 2);
+  if (span == NULL)
+    return NULL;
+
+  /* The stream's UTF-16 is little endian and needn't be aligned */
+  utf16 = g_new (gunichar2, n_chars);
+  for (i = 0; i < n_chars; i++)
+    utf16[i] = content_load_uint16 (span + 2 * i);
+
   /* FIXME: Add error handling for this next call */
-  data = g_utf16_to_utf8 ((gunichar2 *)&content->data[content->cursor], n_chars, NULL, NULL, NULL);
-  content->cursor += 2 * n_chars;
+  data = g_utf16_to_utf8 (utf16, n_chars, NULL, NULL, NULL);
+  g_free (utf16);
   return data;
 }
 
@@ -77,61 +87,132 @@ int
 content_skip_bytes (file_content *content, unsigned int n_bytes)
 {
   int i;
-  g_return_val_if_fail (content_check_available (content, n_bytes), 0);
-  for (i = 0; i < n_bytes; i++) {
-    printf ("Skipped byte %i\n", content->data[content->cursor + i]);
+  if (!content_check_available (content, n_bytes))
+    return 0;
+  if (log_trace_enabled ()) {
+    for (i = 0; i < n_bytes; i++)
+      printf ("Skipped byte %i\n", content->data[content->cursor + i]);
   }
   content->cursor += n_bytes;
   return 1;
 }
 
 
-char *
-content_get_length_multi_prefixed_string (file_content *content)
+int
+content_get_length_multi_prefixed_string_view (file_content *content, content_string *view)
 {
   uint32_t txt_block_length;
   uint8_t txt_length;
-  char *string;
 
   /* Text block skip length */
   if (!content_get_uint32 (content, &txt_block_length))
-    return NULL;
+    return 0;
 
 #if 0
   if (txt_block_length == 0) {
-    printf ("0 LEN TXT!!!!\n");
-    return NULL; //g_strdup(""); /* empty string? */
+    log_trace ("0 LEN TXT!!!!\n");
+    return 0; //g_strdup(""); /* empty string? */
   }
 #endif
 
   if (!content_get_byte (content, &txt_length))
-    return NULL;
+    return 0;
 
-  fflush (stdout);
+  if (log_trace_enabled ())
+    fflush (stdout);
   if (txt_block_length != 1 + txt_length) //exit (-1);
     g_warning ("txt_block_length = %i\n, 1 + txt_length = %i\n", txt_block_length, 1 + txt_length);
 
-  if (txt_block_length == 0 && txt_length == 0)
-    return g_strdup(""); /* empty string? */
+  if (txt_block_length == 0 && txt_length == 0) { /* empty string? */
+    view->str = "";
+    view->length = 0;
+    return 1;
+  }
 
   //g_return_val_if_fail (txt_block_length == 1 + txt_length, NULL);
 //REINSTATE!  g_assert (txt_block_length == 1 + txt_length);
 
-  string = content_get_n_chars (content, txt_length);
-  return string;
+  return content_get_n_chars_view (content, txt_length, view);
 }
 
 
 char *
-content_get_length_dword_prefixed_string (file_content *content)
+content_get_length_multi_prefixed_string (file_content *content)
+{
+  content_string view;
+
+  if (!content_get_length_multi_prefixed_string_view (content, &view))
+    return NULL;
+  return content_string_dup (view);
+}
+
+
+int
+content_get_length_dword_prefixed_string_view (file_content *content, content_string *view)
 {
   uint32_t txt_block_length;
-  char *string;
 
   /* Text block skip length */
   if (!content_get_uint32 (content, &txt_block_length))
+    return 0;
+
+  return content_get_n_chars_view (content, txt_block_length, view);
+}
+
+
+char *
+content_get_length_dword_prefixed_string (file_content *content)
+{
+  content_string view;
+
+  if (!content_get_length_dword_prefixed_string_view (content, &view))
     return NULL;
+  return content_string_dup (view);
+}
+
+
+/* A cheap 64 bit hash of the whole stream, to tell whether it changed
+ * since an earlier run. It is taken a word at a time, so it runs over the
+ * mapped bytes about as fast as they can be read. Each step passes the
+ * state through MurmurHash3's finaliser, so a change to any bit of a word
+ * reaches every bit of the hash. NB: Not a cryptographic hash, and word
+ * order makes it host endian dependent.
+ */
+static inline guint64
+fingerprint_mix (guint64 hash)
+{
+  hash ^= hash >> 33;
+  hash *= G_GUINT64_CONSTANT (0xff51afd7ed558ccd);
+  hash ^= hash >> 33;
+  hash *= G_GUINT64_CONSTANT (0xc4ceb9fe1a85ec53);
+  hash ^= hash >> 33;
+
+  return hash;
+}
+
+guint64
+content_fingerprint (const file_content *content, guint64 seed)
+{
+  const char *data = content->data;
+  unsigned int remaining = content->length;
+  guint64 hash = seed ^ G_GUINT64_CONSTANT (0xcbf29ce484222325);
+  guint64 word;
+
+  while (remaining >= sizeof (word)) {
+    memcpy (&word, data, sizeof (word));
+    hash = fingerprint_mix (hash ^ word);
+    data += sizeof (word);
+    remaining -= sizeof (word);
+  }
+
+  /* The tail is zero padded into a last word, the length tells them apart */
+  if (remaining > 0) {
+    word = 0;
+    memcpy (&word, data, remaining);
+    hash = fingerprint_mix (hash ^ word);
+  }
+
+  hash = fingerprint_mix (hash ^ content->length);
 
-  string = content_get_n_chars (content, txt_block_length);
-  return string;
+  return hash;
 }
@@ -21,18 +21,160 @@ typedef struct {
   char *data;
   unsigned int length;
   unsigned int cursor;
+  GBytes *bytes; /* Backing storage released along with the content, if not NULL */
 } file_content;
 
-int content_check_available (file_content *content, unsigned int length);
-int content_get_uint32 (file_content *content, uint32_t *data);
-int content_get_int32 (file_content *content, int32_t *data);
-int content_get_uint16 (file_content *content, uint16_t *data);
-int content_get_int16 (file_content *content, int16_t *data);
-int content_get_byte (file_content *content, uint8_t *data);
-int content_get_double (file_content *content, double *data);
+/* The fixed size readers are inline, so the decoders' runs of reads fold
+ * into straight loads. NB: Lengths come from the file, so mustn't be
+ * added to the cursor until they are known to fit, in case the sum wraps.
+ */
+static inline int
+content_check_available (file_content *content, unsigned int length)
+{
+  return (content->cursor > content->length ||
+          length > content->length - content->cursor) ? 0 : 1;
+}
+
+/* Claim the next n_bytes of the stream with a single bounds check. Returns
+ * a pointer into the stream itself (nothing is copied), or NULL if there
+ * aren't that many bytes left. Fixed layouts are then picked out of the
+ * span with content_load_*.
+ */
+static inline const char *
+content_take (file_content *content, unsigned int n_bytes)
+{
+  const char *span;
+
+  if (!content_check_available (content, n_bytes))
+    return NULL;
+
+  span = &content->data[content->cursor];
+  content->cursor += n_bytes;
+  return span;
+}
+
+/* As content_take, for n_items of item_size bytes each */
+static inline const char *
+content_take_array (file_content *content, unsigned int n_items, unsigned int item_size)
+{
+  if (item_size != 0 && n_items > G_MAXUINT / item_size)
+    return NULL;
+
+  return content_take (content, n_items * item_size);
+}
+
+/* Little endian loads from any address. Put together a byte at a time, so
+ * they are right on big endian hosts and safe on strict alignment ones;
+ * compilers turn them back into single loads where the target allows.
+ */
+static inline uint8_t
+content_load_byte (const char *p)
+{
+  return (uint8_t) p[0];
+}
+
+static inline uint16_t
+content_load_uint16 (const char *p)
+{
+  const uint8_t *b = (const uint8_t *) p;
+  return (uint16_t) (b[0] | b[1] << 8);
+}
+
+static inline uint32_t
+content_load_uint32 (const char *p)
+{
+  const uint8_t *b = (const uint8_t *) p;
+  return (uint32_t) b[0] | (uint32_t) b[1] << 8 |
+         (uint32_t) b[2] << 16 | (uint32_t) b[3] << 24;
+}
+
+static inline uint64_t
+content_load_uint64 (const char *p)
+{
+  return (uint64_t) content_load_uint32 (p) |
+         (uint64_t) content_load_uint32 (p + 4) << 32;
+}
+
+static inline int16_t
+content_load_int16 (const char *p)
+{
+  return (int16_t) content_load_uint16 (p);
+}
+
+static inline int32_t
+content_load_int32 (const char *p)
+{
+  return (int32_t) content_load_uint32 (p);
+}
+
+static inline double
+content_load_double (const char *p)
+{
+  union { uint64_t bits; double value; } u;
+
+  u.bits = content_load_uint64 (p);
+  return u.value;
+}
+
+/* content_get_<name> reads one value, content_get_<name>_array reads n
+ * consecutive ones behind one bounds check. Both return 0, reading
+ * nothing, if the stream is too short.
+ */
+#define CONTENT_GET_TYPE(name, type, size) \
+static inline int \
+content_get_##name (file_content *content, type *data) \
+{ \
+  const char *span = content_take (content, size); \
+  if (span == NULL) \
+    return 0; \
+  *data = content_load_##name (span); \
+  return 1; \
+} \
+\
+static inline int \
+content_get_##name##_array (file_content *content, type *data, unsigned int n) \
+{ \
+  const char *span = content_take_array (content, n, size); \
+  unsigned int i; \
+  if (span == NULL) \
+    return 0; \
+  for (i = 0; i < n; i++) \
+    data[i] = content_load_##name (span + i * size); \
+  return 1; \
+}
+
+CONTENT_GET_TYPE(uint32, uint32_t, 4)
+CONTENT_GET_TYPE(int32, int32_t, 4)
+CONTENT_GET_TYPE(uint16, uint16_t, 2)
+CONTENT_GET_TYPE(int16, int16_t, 2)
+CONTENT_GET_TYPE(byte, uint8_t, 1)
+CONTENT_GET_TYPE(double, double, 8)
+
+#undef CONTENT_GET_TYPE
+
+/* A string within the stream: not NUL terminated, and only valid for as
+ * long as the file_content it was read from. Print it with "%.*s", and
+ * copy it with content_string_dup () to keep it any longer.
+ */
+typedef struct {
+  const char *str;
+  int length;           /* An int, to suit "%.*s" */
+} content_string;
+
+static inline char *
+content_string_dup (content_string view)
+{
+  return g_strndup (view.str, view.length);
+}
+
+int content_get_n_chars_view (file_content *content, unsigned int n_chars, content_string *view);
+int content_get_length_multi_prefixed_string_view (file_content *content, content_string *view);
+int content_get_length_dword_prefixed_string_view (file_content *content, content_string *view);
 
 char *content_get_n_chars (file_content *content, unsigned int n_chars);
 char *content_get_n_wchars (file_content *content, unsigned int n_chars);
 int content_skip_bytes (file_content *content, unsigned int n_bytes);
 char *content_get_length_multi_prefixed_string (file_content *content);
 char *content_get_length_dword_prefixed_string (file_content *content);
+
+guint64 content_fingerprint (const file_content *content, guint64 seed);
@@ -0,0 +1,177 @@
+/*
+ *  openaltium is a set of tools for opening Altium (TM) library files
+ *  Copyright (C) 2016  Peter Clifton <Peter.Clifton@clifton-electronics.co.uk>
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 2.1 of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this library; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <glib.h>
+
+#include "arena.h"
+#include "output-writer.h"
+#include "footprint.h"
+
+
+static void
+write_models (output_writer *file, const footprint_models *models)
+{
+  guint i;
+
+  for (i = 0; i < models->len; i++) {
+    double ox = models->origin_x[i], oy = models->origin_y[i], oz = models->origin_z[i];
+    double ax = models->axis_x[i],   ay = models->axis_y[i],   az = models->axis_z[i];
+    double rx = models->ref_x[i],    ry = models->ref_y[i],    rz = models->ref_z[i];
+
+    output_puts (file, "\tAttribute(\"PCB::3d_model::type\" \"STEP-AP214\")\n"); /* XXX: ASSUMED, BUT MAY NOT BE! */
+    output_printf (file, "\tAttribute(\"PCB::3d_model::filename\" \"%s\")\n", models->filename[i]); /* XXX: NEED TO FIX PCB SEARCH PATHS!!! */
+    output_printf (file, "\tAttribute(\"PCB::3d_model::origin\" \"%f mil %f mil %f mil\")\n", ox, oy, oz);
+    output_printf (file, "\tAttribute(\"PCB::3d_model::origin::X\" \"%f mil\")\n", ox);
+    output_printf (file, "\tAttribute(\"PCB::3d_model::origin::Y\" \"%f mil\")\n", oy);
+    output_printf (file, "\tAttribute(\"PCB::3d_model::origin::Z\" \"%f mil\")\n", oz);
+    output_printf (file, "\tAttribute(\"PCB::3d_model::axis\" \"%f %f %f\")\n", ax, ay, az);
+    output_printf (file, "\tAttribute(\"PCB::3d_model::axis::X\" \"%f\")\n", ax);
+    output_printf (file, "\tAttribute(\"PCB::3d_model::axis::Y\" \"%f\")\n", ay);
+    output_printf (file, "\tAttribute(\"PCB::3d_model::axis::Z\" \"%f\")\n", az);
+    output_printf (file, "\tAttribute(\"PCB::3d_model::ref_dir\" \"%f %f %f\")\n", rx, ry, rz);
+    output_printf (file, "\tAttribute(\"PCB::3d_model::ref_dir::X\" \"%f\")\n", rx);
+    output_printf (file, "\tAttribute(\"PCB::3d_model::ref_dir::Y\" \"%f\")\n", ry);
+    output_printf (file, "\tAttribute(\"PCB::3d_model::ref_dir::Z\" \"%f\")\n", rz);
+    output_puts (file, "\tAttribute(\"PCB::rotation\" \"0 degrees\")\n");
+  }
+}
+
+static const char *
+pad_flags_string (uint8_t flags)
+{
+  if (flags & FOOTPRINT_PAD_HOLE)
+    return "hole";
+
+  if (flags & FOOTPRINT_PAD_ONSOLDER)
+    return (flags & FOOTPRINT_PAD_SQUARE) ? "square,onsolder" : "onsolder";
+
+  return (flags & FOOTPRINT_PAD_SQUARE) ? "square" : "";
+}
+
+static void
+write_pads (output_writer *file, const footprint_pads *pads)
+{
+  guint i;
+
+  for (i = 0; i < pads->len; i++) {
+    if (pads->flags[i] & FOOTPRINT_PAD_PIN) {
+      output_puts (file, "\tPin[");
+      output_coord (file, pads->x1[i]);        output_putc (file, ' ');
+      output_coord (file, -pads->y1[i]);       output_putc (file, ' ');
+    } else {
+      output_puts (file, "\tPad[");
+      output_coord (file, pads->x1[i]);        output_putc (file, ' ');
+      output_coord (file, -pads->y1[i]);       output_putc (file, ' ');
+      output_coord (file, pads->x2[i]);        output_putc (file, ' ');
+      output_coord (file, -pads->y2[i]);       output_putc (file, ' ');
+    }
+    output_coord (file, pads->thickness[i]);   output_putc (file, ' ');
+    output_coord (file, pads->clearance[i]);   output_putc (file, ' ');
+    output_coord (file, pads->mask[i]);        output_putc (file, ' ');
+    if (pads->flags[i] & FOOTPRINT_PAD_PIN) {
+      output_coord (file, pads->drill[i]);     output_putc (file, ' ');
+    }
+    output_printf (file, "\"\" \"%s\" \"%s\"]\n", pads->name[i], pad_flags_string (pads->flags[i]));
+  }
+}
+
+static void
+write_line (output_writer *file, int32_t x1, int32_t y1, int32_t x2, int32_t y2, int32_t width)
+{
+  output_puts (file, "\tElementLine[");
+  output_coord (file, x1);    output_putc (file, ' ');
+  output_coord (file, -y1);   output_putc (file, ' ');
+  output_coord (file, x2);    output_putc (file, ' ');
+  output_coord (file, -y2);   output_putc (file, ' ');
+  output_coord (file, width); output_puts (file, "]\n");
+}
+
+static void
+write_lines (output_writer *file, const footprint_lines *lines)
+{
+  guint i;
+
+  for (i = 0; i < lines->len; i++)
+    write_line (file, lines->x1[i], lines->y1[i], lines->x2[i], lines->y2[i], lines->width[i]);
+}
+
+/* XXX: We don't support rectangles in our footprints! Draw the outline
+ * and diagonals so they can at least be seen.
+ */
+static void
+write_rectangles (output_writer *file, const footprint_rectangles *rectangles)
+{
+  int32_t width = 50;
+  guint i;
+
+  for (i = 0; i < rectangles->len; i++) {
+    int32_t x1 = rectangles->x1[i], y1 = rectangles->y1[i];
+    int32_t x2 = rectangles->x2[i], y2 = rectangles->y2[i];
+
+    write_line (file, x1, y1, x1, y2, width);
+    write_line (file, x2, y1, x2, y2, width);
+    write_line (file, x1, y1, x2, y1, width);
+    write_line (file, x1, y2, x2, y2, width);
+    write_line (file, x1, y1, x2, y2, width);
+    write_line (file, x1, y2, x2, y1, width);
+  }
+}
+
+static void
+write_arcs (output_writer *file, const footprint_arcs *arcs)
+{
+  guint i;
+
+  /* XXX: GOODNESS KNOWS WHAT THE ANGLE CONVENTION IS... EXAMPLES SO FAR ARE FULL CIRCLE ARCS!!! */
+  for (i = 0; i < arcs->len; i++) {
+    output_puts (file, "\tElementArc[");
+    output_coord (file, arcs->x[i]);      output_putc (file, ' ');
+    output_coord (file, -arcs->y[i]);     output_putc (file, ' ');
+    output_coord (file, arcs->radius[i]); output_putc (file, ' ');
+    output_coord (file, arcs->radius[i]); output_putc (file, ' ');
+    output_printf (file, "%f %f ", 180 + arcs->start_angle[i], arcs->delta_angle[i]);
+    output_coord (file, arcs->thickness[i]); output_puts (file, "]\n");
+  }
+}
+
+/* Write the footprint out as a pcb Element. PCB doesn't support text or
+ * polygons in elements, so those are left out.
+ */
+void
+footprint_write_pcb (output_writer *file, const footprint *fp)
+{
+  int32_t origin_x = 0;
+  int32_t origin_y = 0;
+
+  output_puts (file, "Element[\"\" \"\" \"\" \"\" ");
+  output_coord (file, origin_x); output_putc (file, ' ');
+  output_coord (file, origin_y); output_putc (file, ' ');
+  output_puts (file, "0.0 0.0 0 100 \"\"]\n");
+  output_puts (file, "(\n");
+
+  write_models (file, &fp->models);
+  write_pads (file, &fp->pads);
+  write_lines (file, &fp->lines);
+  write_rectangles (file, &fp->rectangles);
+  write_arcs (file, &fp->arcs);
+
+  output_puts (file, ")\n");
+}
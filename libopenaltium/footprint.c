@@ -0,0 +1,367 @@
+/*
+ *  openaltium is a set of tools for opening Altium (TM) library files
+ *  Copyright (C) 2016  Peter Clifton <Peter.Clifton@clifton-electronics.co.uk>
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 2.1 of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this library; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <glib.h>
+
+#include "arena.h"
+#include "output-writer.h"
+#include "footprint.h"
+
+
+#define TABLE_MIN_ALLOCATED 16
+
+/* Make room for n more rows, returning true if the columns must be resized */
+static bool
+table_reserve (guint len, guint *allocated, guint n)
+{
+  guint needed = len + n;
+
+  if (needed <= *allocated)
+    return false;
+
+  *allocated = MAX (*allocated, TABLE_MIN_ALLOCATED);
+  while (*allocated < needed)
+    *allocated *= 2;
+
+  return true;
+}
+
+#define RESIZE_COLUMN(table, column) \
+  ((table)->column = g_realloc_n ((table)->column, (table)->allocated, sizeof *(table)->column))
+
+#define FREE_COLUMN(table, column) \
+  g_free ((table)->column)
+
+footprint *
+footprint_new (void)
+{
+  footprint *fp;
+
+  fp = g_slice_new0 (footprint);
+  fp->arena = arena_new ();
+
+  return fp;
+}
+
+void
+footprint_free (footprint *fp)
+{
+  if (fp == NULL)
+    return;
+
+  FREE_COLUMN (&fp->arcs, layer);
+  FREE_COLUMN (&fp->arcs, x);
+  FREE_COLUMN (&fp->arcs, y);
+  FREE_COLUMN (&fp->arcs, radius);
+  FREE_COLUMN (&fp->arcs, start_angle);
+  FREE_COLUMN (&fp->arcs, delta_angle);
+  FREE_COLUMN (&fp->arcs, thickness);
+
+  FREE_COLUMN (&fp->pads, layer);
+  FREE_COLUMN (&fp->pads, x1);
+  FREE_COLUMN (&fp->pads, y1);
+  FREE_COLUMN (&fp->pads, x2);
+  FREE_COLUMN (&fp->pads, y2);
+  FREE_COLUMN (&fp->pads, thickness);
+  FREE_COLUMN (&fp->pads, clearance);
+  FREE_COLUMN (&fp->pads, mask);
+  FREE_COLUMN (&fp->pads, drill);
+  FREE_COLUMN (&fp->pads, flags);
+  FREE_COLUMN (&fp->pads, name);
+
+  FREE_COLUMN (&fp->lines, layer);
+  FREE_COLUMN (&fp->lines, x1);
+  FREE_COLUMN (&fp->lines, y1);
+  FREE_COLUMN (&fp->lines, x2);
+  FREE_COLUMN (&fp->lines, y2);
+  FREE_COLUMN (&fp->lines, width);
+
+  FREE_COLUMN (&fp->texts, layer);
+  FREE_COLUMN (&fp->texts, x);
+  FREE_COLUMN (&fp->texts, y);
+  FREE_COLUMN (&fp->texts, height);
+  FREE_COLUMN (&fp->texts, angle);
+  FREE_COLUMN (&fp->texts, text);
+
+  FREE_COLUMN (&fp->rectangles, layer);
+  FREE_COLUMN (&fp->rectangles, x1);
+  FREE_COLUMN (&fp->rectangles, y1);
+  FREE_COLUMN (&fp->rectangles, x2);
+  FREE_COLUMN (&fp->rectangles, y2);
+
+  FREE_COLUMN (&fp->polygons, layer);
+  FREE_COLUMN (&fp->polygons, first_vertex);
+  FREE_COLUMN (&fp->polygons, n_vertices);
+
+  FREE_COLUMN (&fp->vertices, x);
+  FREE_COLUMN (&fp->vertices, y);
+
+  FREE_COLUMN (&fp->models, filename);
+  FREE_COLUMN (&fp->models, origin_x);
+  FREE_COLUMN (&fp->models, origin_y);
+  FREE_COLUMN (&fp->models, origin_z);
+  FREE_COLUMN (&fp->models, axis_x);
+  FREE_COLUMN (&fp->models, axis_y);
+  FREE_COLUMN (&fp->models, axis_z);
+  FREE_COLUMN (&fp->models, ref_x);
+  FREE_COLUMN (&fp->models, ref_y);
+  FREE_COLUMN (&fp->models, ref_z);
+
+  arena_free (fp->arena);
+  g_slice_free (footprint, fp);
+}
+
+/* Empty every table, keeping their allocations for the next footprint */
+void
+footprint_clear (footprint *fp)
+{
+  fp->arcs.len = 0;
+  fp->pads.len = 0;
+  fp->lines.len = 0;
+  fp->texts.len = 0;
+  fp->rectangles.len = 0;
+  fp->polygons.len = 0;
+  fp->vertices.len = 0;
+  fp->models.len = 0;
+  arena_clear (fp->arena);
+}
+
+/* Copy a string into the footprint, where it lives as long as the footprint
+ * does. A negative length means the string is nul terminated.
+ */
+const char *
+footprint_intern (footprint *fp, const char *string, gssize length)
+{
+  if (length < 0)
+    return arena_strdup (fp->arena, string);
+
+  return arena_strndup (fp->arena, string, length);
+}
+
+guint
+footprint_add_arc (footprint *fp, uint8_t layer, int32_t x, int32_t y, int32_t radius,
+                   double start_angle, double delta_angle, int32_t thickness)
+{
+  footprint_arcs *arcs = &fp->arcs;
+  guint i = arcs->len;
+
+  if (table_reserve (arcs->len, &arcs->allocated, 1)) {
+    RESIZE_COLUMN (arcs, layer);
+    RESIZE_COLUMN (arcs, x);
+    RESIZE_COLUMN (arcs, y);
+    RESIZE_COLUMN (arcs, radius);
+    RESIZE_COLUMN (arcs, start_angle);
+    RESIZE_COLUMN (arcs, delta_angle);
+    RESIZE_COLUMN (arcs, thickness);
+  }
+
+  arcs->layer[i] = layer;
+  arcs->x[i] = x;
+  arcs->y[i] = y;
+  arcs->radius[i] = radius;
+  arcs->start_angle[i] = start_angle;
+  arcs->delta_angle[i] = delta_angle;
+  arcs->thickness[i] = thickness;
+
+  return arcs->len++;
+}
+
+guint
+footprint_add_pad (footprint *fp, uint8_t layer, int32_t x1, int32_t y1, int32_t x2, int32_t y2,
+                   int32_t thickness, int32_t clearance, int32_t mask, int32_t drill,
+                   uint8_t flags, const char *name, gssize name_length)
+{
+  footprint_pads *pads = &fp->pads;
+  guint i = pads->len;
+
+  if (table_reserve (pads->len, &pads->allocated, 1)) {
+    RESIZE_COLUMN (pads, layer);
+    RESIZE_COLUMN (pads, x1);
+    RESIZE_COLUMN (pads, y1);
+    RESIZE_COLUMN (pads, x2);
+    RESIZE_COLUMN (pads, y2);
+    RESIZE_COLUMN (pads, thickness);
+    RESIZE_COLUMN (pads, clearance);
+    RESIZE_COLUMN (pads, mask);
+    RESIZE_COLUMN (pads, drill);
+    RESIZE_COLUMN (pads, flags);
+    RESIZE_COLUMN (pads, name);
+  }
+
+  pads->layer[i] = layer;
+  pads->x1[i] = x1;
+  pads->y1[i] = y1;
+  pads->x2[i] = x2;
+  pads->y2[i] = y2;
+  pads->thickness[i] = thickness;
+  pads->clearance[i] = clearance;
+  pads->mask[i] = mask;
+  pads->drill[i] = drill;
+  pads->flags[i] = flags;
+  pads->name[i] = footprint_intern (fp, name, name_length);
+
+  return pads->len++;
+}
+
+guint
+footprint_add_line (footprint *fp, uint8_t layer, int32_t x1, int32_t y1,
+                    int32_t x2, int32_t y2, int32_t width)
+{
+  footprint_lines *lines = &fp->lines;
+  guint i = lines->len;
+
+  if (table_reserve (lines->len, &lines->allocated, 1)) {
+    RESIZE_COLUMN (lines, layer);
+    RESIZE_COLUMN (lines, x1);
+    RESIZE_COLUMN (lines, y1);
+    RESIZE_COLUMN (lines, x2);
+    RESIZE_COLUMN (lines, y2);
+    RESIZE_COLUMN (lines, width);
+  }
+
+  lines->layer[i] = layer;
+  lines->x1[i] = x1;
+  lines->y1[i] = y1;
+  lines->x2[i] = x2;
+  lines->y2[i] = y2;
+  lines->width[i] = width;
+
+  return lines->len++;
+}
+
+guint
+footprint_add_text (footprint *fp, uint8_t layer, int32_t x, int32_t y, int32_t height,
+                    double angle, const char *text, gssize text_length)
+{
+  footprint_texts *texts = &fp->texts;
+  guint i = texts->len;
+
+  if (table_reserve (texts->len, &texts->allocated, 1)) {
+    RESIZE_COLUMN (texts, layer);
+    RESIZE_COLUMN (texts, x);
+    RESIZE_COLUMN (texts, y);
+    RESIZE_COLUMN (texts, height);
+    RESIZE_COLUMN (texts, angle);
+    RESIZE_COLUMN (texts, text);
+  }
+
+  texts->layer[i] = layer;
+  texts->x[i] = x;
+  texts->y[i] = y;
+  texts->height[i] = height;
+  texts->angle[i] = angle;
+  texts->text[i] = footprint_intern (fp, text, text_length);
+
+  return texts->len++;
+}
+
+guint
+footprint_add_rectangle (footprint *fp, uint8_t layer, int32_t x1, int32_t y1,
+                         int32_t x2, int32_t y2)
+{
+  footprint_rectangles *rectangles = &fp->rectangles;
+  guint i = rectangles->len;
+
+  if (table_reserve (rectangles->len, &rectangles->allocated, 1)) {
+    RESIZE_COLUMN (rectangles, layer);
+    RESIZE_COLUMN (rectangles, x1);
+    RESIZE_COLUMN (rectangles, y1);
+    RESIZE_COLUMN (rectangles, x2);
+    RESIZE_COLUMN (rectangles, y2);
+  }
+
+  rectangles->layer[i] = layer;
+  rectangles->x1[i] = x1;
+  rectangles->y1[i] = y1;
+  rectangles->x2[i] = x2;
+  rectangles->y2[i] = y2;
+
+  return rectangles->len++;
+}
+
+/* Adds a polygon of n_vertices, pointing x and y at its (uninitialised)
+ * vertex coordinates for the caller to fill in. NB: The pointers are only
+ * good until the next polygon is added.
+ */
+guint
+footprint_add_polygon (footprint *fp, uint8_t layer, guint n_vertices,
+                       double **x, double **y)
+{
+  footprint_polygons *polygons = &fp->polygons;
+  footprint_vertices *vertices = &fp->vertices;
+  guint i = polygons->len;
+
+  if (table_reserve (polygons->len, &polygons->allocated, 1)) {
+    RESIZE_COLUMN (polygons, layer);
+    RESIZE_COLUMN (polygons, first_vertex);
+    RESIZE_COLUMN (polygons, n_vertices);
+  }
+
+  if (table_reserve (vertices->len, &vertices->allocated, n_vertices)) {
+    RESIZE_COLUMN (vertices, x);
+    RESIZE_COLUMN (vertices, y);
+  }
+
+  polygons->layer[i] = layer;
+  polygons->first_vertex[i] = vertices->len;
+  polygons->n_vertices[i] = n_vertices;
+
+  *x = vertices->x + vertices->len;
+  *y = vertices->y + vertices->len;
+  vertices->len += n_vertices;
+
+  return polygons->len++;
+}
+
+guint
+footprint_add_model (footprint *fp, const char *filename,
+                     const double origin[3], const double axis[3], const double ref[3])
+{
+  footprint_models *models = &fp->models;
+  guint i = models->len;
+
+  if (table_reserve (models->len, &models->allocated, 1)) {
+    RESIZE_COLUMN (models, filename);
+    RESIZE_COLUMN (models, origin_x);
+    RESIZE_COLUMN (models, origin_y);
+    RESIZE_COLUMN (models, origin_z);
+    RESIZE_COLUMN (models, axis_x);
+    RESIZE_COLUMN (models, axis_y);
+    RESIZE_COLUMN (models, axis_z);
+    RESIZE_COLUMN (models, ref_x);
+    RESIZE_COLUMN (models, ref_y);
+    RESIZE_COLUMN (models, ref_z);
+  }
+
+  models->filename[i] = footprint_intern (fp, filename, -1);
+  models->origin_x[i] = origin[0];
+  models->origin_y[i] = origin[1];
+  models->origin_z[i] = origin[2];
+  models->axis_x[i] = axis[0];
+  models->axis_y[i] = axis[1];
+  models->axis_z[i] = axis[2];
+  models->ref_x[i] = ref[0];
+  models->ref_y[i] = ref[1];
+  models->ref_z[i] = ref[2];
+
+  return models->len++;
+}
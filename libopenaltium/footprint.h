@@ -0,0 +1,167 @@
+/*
+ *  openaltium is a set of tools for opening Altium (TM) library files
+ *  Copyright (C) 2016  Peter Clifton <Peter.Clifton@clifton-electronics.co.uk>
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 2.1 of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this library; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+
+/* Decoded footprint geometry, kept apart from any output format. Each kind
+ * of primitive has a table of parallel column arrays (struct of arrays),
+ * so a pass over one property of every pad, say, touches just that column.
+ *
+ * Coordinates are Altium 1/10000 mil units with y pointing up, as in the
+ * file; angles are in degrees. Strings, and anything else allocated while
+ * decoding, live in the footprint's arena. A footprint is decoded on one
+ * thread, so the arena needn't be shared with the library's.
+ */
+
+/* Pad flags */
+#define FOOTPRINT_PAD_PIN       (1 << 0)  /* Through hole, (x1, y1) == (x2, y2) */
+#define FOOTPRINT_PAD_HOLE      (1 << 1)  /* Unplated */
+#define FOOTPRINT_PAD_SQUARE    (1 << 2)
+#define FOOTPRINT_PAD_ONSOLDER  (1 << 3)
+
+typedef struct {
+  guint len;
+  guint allocated;
+  uint8_t *layer;
+  int32_t *x;
+  int32_t *y;
+  int32_t *radius;
+  double *start_angle;
+  double *delta_angle;
+  int32_t *thickness;
+} footprint_arcs;
+
+/* Pins and pads, as a line segment with a thickness */
+typedef struct {
+  guint len;
+  guint allocated;
+  uint8_t *layer;
+  int32_t *x1;
+  int32_t *y1;
+  int32_t *x2;
+  int32_t *y2;
+  int32_t *thickness;
+  int32_t *clearance;
+  int32_t *mask;
+  int32_t *drill;
+  uint8_t *flags;
+  const char **name;
+} footprint_pads;
+
+typedef struct {
+  guint len;
+  guint allocated;
+  uint8_t *layer;
+  int32_t *x1;
+  int32_t *y1;
+  int32_t *x2;
+  int32_t *y2;
+  int32_t *width;
+} footprint_lines;
+
+typedef struct {
+  guint len;
+  guint allocated;
+  uint8_t *layer;
+  int32_t *x;
+  int32_t *y;
+  int32_t *height;
+  double *angle;
+  const char **text;
+} footprint_texts;
+
+typedef struct {
+  guint len;
+  guint allocated;
+  uint8_t *layer;
+  int32_t *x1;
+  int32_t *y1;
+  int32_t *x2;
+  int32_t *y2;
+} footprint_rectangles;
+
+/* A polygon's outline is n_vertices entries of the vertex table, from first_vertex */
+typedef struct {
+  guint len;
+  guint allocated;
+  uint8_t *layer;
+  guint *first_vertex;
+  guint *n_vertices;
+} footprint_polygons;
+
+typedef struct {
+  guint len;
+  guint allocated;
+  double *x;
+  double *y;
+} footprint_vertices;
+
+/* 3D model placements. NB: The transform is already worked out for pcb's
+ * frame, with y pointing down, and its origin is in mil.
+ */
+typedef struct {
+  guint len;
+  guint allocated;
+  const char **filename;
+  double *origin_x;
+  double *origin_y;
+  double *origin_z;
+  double *axis_x;
+  double *axis_y;
+  double *axis_z;
+  double *ref_x;
+  double *ref_y;
+  double *ref_z;
+} footprint_models;
+
+typedef struct {
+  footprint_arcs arcs;
+  footprint_pads pads;
+  footprint_lines lines;
+  footprint_texts texts;
+  footprint_rectangles rectangles;
+  footprint_polygons polygons;
+  footprint_vertices vertices;
+  footprint_models models;
+  arena *arena;
+} footprint;
+
+footprint *footprint_new (void);
+void footprint_free (footprint *fp);
+void footprint_clear (footprint *fp);
+
+const char *footprint_intern (footprint *fp, const char *string, gssize length);
+
+guint footprint_add_arc (footprint *fp, uint8_t layer, int32_t x, int32_t y, int32_t radius,
+                         double start_angle, double delta_angle, int32_t thickness);
+guint footprint_add_pad (footprint *fp, uint8_t layer, int32_t x1, int32_t y1, int32_t x2, int32_t y2,
+                         int32_t thickness, int32_t clearance, int32_t mask, int32_t drill,
+                         uint8_t flags, const char *name, gssize name_length);
+guint footprint_add_line (footprint *fp, uint8_t layer, int32_t x1, int32_t y1,
+                          int32_t x2, int32_t y2, int32_t width);
+guint footprint_add_text (footprint *fp, uint8_t layer, int32_t x, int32_t y, int32_t height,
+                          double angle, const char *text, gssize text_length);
+guint footprint_add_rectangle (footprint *fp, uint8_t layer, int32_t x1, int32_t y1,
+                               int32_t x2, int32_t y2);
+guint footprint_add_polygon (footprint *fp, uint8_t layer, guint n_vertices,
+                             double **x, double **y);
+guint footprint_add_model (footprint *fp, const char *filename,
+                           const double origin[3], const double axis[3], const double ref[3]);
+
+/* Emitters */
+void footprint_write_pcb (output_writer *file, const footprint *fp);
@@ -0,0 +1,463 @@
+/*
+ *  openaltium is a set of tools for opening Altium (TM) library files
+ *  Copyright (C) 2016  Peter Clifton <Peter.Clifton@clifton-electronics.co.uk>
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 2.1 of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this library; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+/* Write synthetic PcbLib and SchLib files, to convert at scale and to
+ * test against without needing real libraries.
+ *
+ * Usage: generate_library [OPTIONS] -p [PcbLib file]
+ *        generate_library [OPTIONS] -s [SchLib file]
+ */
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <getopt.h>
+#include <glib.h>
+#include <gio/gio.h>
+#include <gsf/gsf.h>
+#include <gsf/gsf-outfile.h>
+#include <gsf/gsf-outfile-msole.h>
+#include <gsf/gsf-output-stdio.h>
+
+#include "content-parser.h"
+#include "arena.h"
+#include "parameters.h"
+#include "models.h"
+#include "output-writer.h"
+#include "footprint.h"
+#include "pcblib-data.h"
+#include "synth-library.h"
+#include "openaltium-error.h"
+
+
+#define DEFAULT_COUNT       100
+#define DEFAULT_MODELS      10
+#define DEFAULT_MODEL_KIB   64
+#define DEFAULT_PARTS       1
+#define DEFAULT_PINS        8
+#define DEFAULT_RECORDS     "arc=2,pad=8,track=4,text=2,fill=1,region=1,body=1"
+
+static void
+print_usage (char *program)
+{
+  fprintf (stdout, "Usage: %s [OPTIONS] -p [PcbLib file]\n", program);
+  fprintf (stdout, "       %s [OPTIONS] -s [SchLib file]\n", program);
+  fprintf (stdout, "OPTIONS: -p, --pcblib Write a PcbLib of footprints\n");
+  fprintf (stdout, "         -s, --schlib Write a SchLib of symbols\n");
+  fprintf (stdout, "         -n, --count  Number of footprints or symbols (default %i)\n", DEFAULT_COUNT);
+  fprintf (stdout, "         -r, --records Records in each footprint (default \"%s\")\n", DEFAULT_RECORDS);
+  fprintf (stdout, "         -m, --models Number of embedded STEP models (default %i)\n", DEFAULT_MODELS);
+  fprintf (stdout, "         -M, --model-size KiB of STEP text in each model (default %i)\n", DEFAULT_MODEL_KIB);
+  fprintf (stdout, "         -P, --parts  Parts in each symbol (default %i)\n", DEFAULT_PARTS);
+  fprintf (stdout, "         -i, --pins   Pins in each part (default %i)\n", DEFAULT_PINS);
+  fprintf (stdout, "         -h, --help   Display usage\n");
+}
+
+/* Parse a record mix such as "arc=2,pad=8", by record type name or number */
+static bool
+parse_record_mix (const char *list, synth_record_mix *mix, GError **error)
+{
+  char **items;
+  int i;
+
+  memset (mix, 0, sizeof (*mix));
+  items = g_strsplit (list, ",", -1);
+
+  for (i = 0; items[i] != NULL; i++) {
+    char *item = g_strstrip (items[i]);
+    char *count = strchr (item, '=');
+    char *end;
+    int type;
+
+    if (*item == '\0')
+      continue;
+
+    if (count != NULL)
+      *count++ = '\0';
+
+    type = strtol (item, &end, 10);
+    if (end == item || *end != '\0') {
+      for (type = PCBLIB_RECORD_TYPE_MAX; type > 0; type--)
+        if (pcblib_record_type_name (type) != NULL &&
+            g_ascii_strcasecmp (pcblib_record_type_name (type), item) == 0)
+          break;
+    }
+
+    if (type <= 0 || type > PCBLIB_RECORD_TYPE_MAX || !synth_pcblib_can_generate (type)) {
+      g_set_error (error, OPENALTIUM_ERROR, OPENALTIUM_ERROR_UNSUPPORTED,
+                   "Can't generate records of type '%s'", item);
+      g_strfreev (items);
+      return false;
+    }
+
+    mix->counts[type] = (count != NULL) ? strtoul (count, NULL, 10) : 1;
+  }
+
+  g_strfreev (items);
+  return true;
+}
+
+static bool
+write_stream (GsfOutfile *dir, const char *name, const guint8 *data, gsize length,
+              GError **error)
+{
+  GsfOutput *stream;
+  bool ok;
+
+  stream = gsf_outfile_new_child (dir, name, FALSE);
+  if (stream == NULL) {
+    g_set_error (error, OPENALTIUM_ERROR, OPENALTIUM_ERROR_OUTPUT,
+                 "Couldn't create stream '%s'", name);
+    return false;
+  }
+
+  ok = gsf_output_write (stream, length, data);
+  ok = gsf_output_close (stream) && ok;
+  g_object_unref (stream);
+
+  if (!ok)
+    g_set_error (error, OPENALTIUM_ERROR, OPENALTIUM_ERROR_OUTPUT,
+                 "Couldn't write stream '%s'", name);
+
+  return ok;
+}
+
+/* A Header stream, which holds the number of records in the Data stream */
+static bool
+write_header (GsfOutfile *dir, guint32 n_records, GError **error)
+{
+  GByteArray *header;
+  bool ok;
+
+  header = g_byte_array_new ();
+  synth_append_uint32 (header, n_records);
+  ok = write_stream (dir, "Header", header->data, header->len, error);
+  g_byte_array_unref (header);
+
+  return ok;
+}
+
+static bool
+close_dir (GsfOutfile *dir, bool ok)
+{
+  ok = gsf_output_close (GSF_OUTPUT (dir)) && ok;
+  g_object_unref (dir);
+
+  return ok;
+}
+
+static GsfOutfile *
+open_compound_file (const char *filename, GError **error)
+{
+  GsfOutput *output;
+  GsfOutfile *outfile;
+
+  output = gsf_output_stdio_new (filename, error);
+  if (output == NULL)
+    return NULL;
+
+  outfile = gsf_outfile_msole_new (output);
+  g_object_unref (output);
+
+  return outfile;
+}
+
+static char *
+resource_name (guint index)
+{
+  /* NB: Compound file names are at most 31 characters */
+  return g_strdup_printf ("SYNTH_%07u", index);
+}
+
+static bool
+write_models (GsfOutfile *library, guint n_models, gsize model_size, GError **error)
+{
+  GsfOutfile *models;
+  GByteArray *data;
+  guint i;
+  bool ok;
+
+  models = GSF_OUTFILE (gsf_outfile_new_child (library, "Models", TRUE));
+  data = g_byte_array_new ();
+
+  for (i = 0; i < n_models; i++) {
+    char *parameters = synth_model_parameters (i);
+    synth_append_dword_prefixed_string (data, parameters);
+    g_free (parameters);
+  }
+
+  ok = write_header (models, n_models, error) &&
+       write_stream (models, "Data", data->data, data->len, error);
+
+  for (i = 0; ok && i < n_models; i++) {
+    char name[16];
+    GBytes *step;
+
+    step = synth_step_model (i, model_size, error);
+    if (step == NULL) {
+      ok = false;
+      break;
+    }
+
+    g_snprintf (name, sizeof (name), "%u", i);
+    ok = write_stream (models, name, g_bytes_get_data (step, NULL), g_bytes_get_size (step), error);
+    g_bytes_unref (step);
+  }
+
+  g_byte_array_unref (data);
+
+  return close_dir (models, ok);
+}
+
+static bool
+write_pcblib (const char *filename, guint count, const synth_record_mix *mix,
+              guint n_models, gsize model_size, GError **error)
+{
+  GsfOutfile *outfile;
+  GsfOutfile *library;
+  GByteArray *data;
+  guint i;
+  bool ok;
+
+  outfile = open_compound_file (filename, error);
+  if (outfile == NULL)
+    return false;
+
+  data = g_byte_array_new ();
+  synth_append_multi_prefixed_string (data, "PCB 6.0 Binary Library File");
+  ok = write_stream (outfile, "FileHeader", data->data, data->len, error);
+
+  /* The library's parameters, then the names of its footprints */
+  library = GSF_OUTFILE (gsf_outfile_new_child (outfile, "Library", TRUE));
+
+  g_byte_array_set_size (data, 0);
+  synth_append_dword_prefixed_string (data, "|FILENAME=synthetic.PcbLib|KIND=Protel_Advanced_PCB_Library"
+                                            "|VERSION=3.00|DATE=|TIME=");
+  synth_append_uint32 (data, count);
+  for (i = 0; i < count; i++) {
+    char *name = resource_name (i);
+    synth_append_multi_prefixed_string (data, name);
+    g_free (name);
+  }
+
+  ok = ok &&
+       write_header (library, 1, error) &&
+       write_stream (library, "Data", data->data, data->len, error) &&
+       write_models (library, n_models, model_size, error);
+  ok = close_dir (library, ok);
+
+  /* Each footprint is a storage of its own */
+  for (i = 0; ok && i < count; i++) {
+    GsfOutfile *footprint;
+    char *name = resource_name (i);
+    char *model_id = NULL;
+    guint n_records;
+
+    if (n_models > 0)
+      model_id = synth_model_id (i % n_models);
+
+    g_byte_array_set_size (data, 0);
+    n_records = synth_pcblib_footprint (data, name, mix, model_id);
+
+    footprint = GSF_OUTFILE (gsf_outfile_new_child (outfile, name, TRUE));
+    ok = write_header (footprint, n_records, error) &&
+         write_stream (footprint, "Data", data->data, data->len, error);
+    ok = close_dir (footprint, ok);
+
+    g_free (model_id);
+    g_free (name);
+  }
+
+  g_byte_array_unref (data);
+
+  if (!close_dir (outfile, true) && ok) {
+    g_set_error (error, OPENALTIUM_ERROR, OPENALTIUM_ERROR_OUTPUT,
+                 "Couldn't finish writing %s", filename);
+    ok = false;
+  }
+
+  return ok;
+}
+
+static bool
+write_schlib (const char *filename, guint count, int partcount, guint pins_per_part,
+              GError **error)
+{
+  GsfOutfile *outfile;
+  GByteArray *data;
+  char **librefs;
+  char *fileheader;
+  guint i;
+  bool ok;
+
+  outfile = open_compound_file (filename, error);
+  if (outfile == NULL)
+    return false;
+
+  librefs = g_new0 (char *, count + 1);
+  for (i = 0; i < count; i++)
+    librefs[i] = resource_name (i);
+
+  data = g_byte_array_new ();
+  fileheader = synth_schlib_fileheader (librefs, partcount);
+  synth_append_dword_prefixed_string (data, fileheader);
+  g_free (fileheader);
+  ok = write_stream (outfile, "FileHeader", data->data, data->len, error);
+
+  /* The symbols' names are short enough to be their own storage's name */
+  for (i = 0; ok && i < count; i++) {
+    GsfOutfile *symbol;
+
+    g_byte_array_set_size (data, 0);
+    synth_schlib_symbol (data, librefs[i], partcount, pins_per_part);
+
+    symbol = GSF_OUTFILE (gsf_outfile_new_child (outfile, librefs[i], TRUE));
+    ok = write_stream (symbol, "Data", data->data, data->len, error);
+    ok = close_dir (symbol, ok);
+  }
+
+  g_byte_array_unref (data);
+  g_strfreev (librefs);
+
+  if (!close_dir (outfile, true) && ok) {
+    g_set_error (error, OPENALTIUM_ERROR, OPENALTIUM_ERROR_OUTPUT,
+                 "Couldn't finish writing %s", filename);
+    ok = false;
+  }
+
+  return ok;
+}
+
+int
+main (int argc, char **argv)
+{
+  char *pcblib = NULL;
+  char *schlib = NULL;
+  guint count = DEFAULT_COUNT;
+  guint n_models = DEFAULT_MODELS;
+  gsize model_kib = DEFAULT_MODEL_KIB;
+  int partcount = DEFAULT_PARTS;
+  guint pins = DEFAULT_PINS;
+  synth_record_mix mix;
+  GError *error = NULL;
+  bool ok = true;
+
+  char *optstring = "p:s:n:r:m:M:P:i:h";
+  int opt;
+  int option_index = 0;
+  struct option long_options[] = {
+    {"pcblib", required_argument, NULL, 'p'},
+    {"schlib", required_argument, NULL, 's'},
+    {"count",  required_argument, NULL, 'n'},
+    {"records", required_argument, NULL, 'r'},
+    {"models", required_argument, NULL, 'm'},
+    {"model-size", required_argument, NULL, 'M'},
+    {"parts",  required_argument, NULL, 'P'},
+    {"pins",   required_argument, NULL, 'i'},
+    {"help",   no_argument,       NULL, 'h'},
+    {NULL,     0,                 NULL, 0}
+  };
+
+  gsf_init ();
+
+  if (!parse_record_mix (DEFAULT_RECORDS, &mix, &error))
+    g_assert_not_reached ();
+
+  while ((opt = getopt_long (argc, argv, optstring,
+                            long_options, &option_index)) != -1) {
+    switch (opt) {
+      case 'p':
+        g_free (pcblib);
+        pcblib = g_strdup (optarg);
+      break;
+
+      case 's':
+        g_free (schlib);
+        schlib = g_strdup (optarg);
+      break;
+
+      case 'n':
+        count = strtoul (optarg, NULL, 10);
+      break;
+
+      case 'r':
+        if (!parse_record_mix (optarg, &mix, &error)) {
+          fprintf (stdout, "%s\n", error->message);
+          exit (EXIT_FAILURE);
+        }
+      break;
+
+      case 'm':
+        n_models = strtoul (optarg, NULL, 10);
+      break;
+
+      case 'M':
+        model_kib = g_ascii_strtoull (optarg, NULL, 10);
+      break;
+
+      case 'P':
+        partcount = atoi (optarg);
+      break;
+
+      case 'i':
+        pins = strtoul (optarg, NULL, 10);
+      break;
+
+      case 'h':
+      default: /* '?' */
+        print_usage (argv[0]);
+        exit (EXIT_FAILURE);
+    }
+  }
+
+  if (pcblib == NULL && schlib == NULL) {
+    fprintf (stdout, "No file to write specified\n");
+    print_usage (argv[0]);
+    exit (EXIT_FAILURE);
+  }
+
+  if (partcount < 1) {
+    fprintf (stdout, "Symbols need at least one part\n");
+    exit (EXIT_FAILURE);
+  }
+
+  if (pcblib != NULL) {
+    ok = write_pcblib (pcblib, count, &mix, n_models, model_kib * 1024, &error);
+    if (ok)
+      fprintf (stdout, "Wrote %u footprint(s) and %u model(s) to '%s'\n", count, n_models, pcblib);
+  }
+
+  if (ok && schlib != NULL) {
+    ok = write_schlib (schlib, count, partcount, pins, &error);
+    if (ok)
+      fprintf (stdout, "Wrote %u symbol(s) of %i part(s) to '%s'\n", count, partcount, schlib);
+  }
+
+  if (error != NULL) {
+    fprintf (stdout, "Error: %s\n", error->message);
+    g_error_free (error);
+  }
+
+  g_free (pcblib);
+  g_free (schlib);
+
+  exit (ok ? EXIT_SUCCESS : EXIT_FAILURE);
+}
@@ -0,0 +1,265 @@
+/*
+ *  openaltium is a set of tools for opening Altium (TM) library files
+ *  Copyright (C) 2016  Peter Clifton <Peter.Clifton@clifton-electronics.co.uk>
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 2.1 of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this library; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <string.h>
+#include <glib.h>
+#include <gio/gio.h>
+#include <gsf/gsf.h>
+#include <gsf/gsf-input-stdio.h>
+#include <gsf/gsf-infile.h>
+#include <gsf/gsf-infile-msole.h>
+
+#include "content-parser.h"
+#include "cfb-reader.h"
+#include "options.h"
+#include "openaltium-error.h"
+#include "pcblib.h"
+#include "schlib.h"
+#include "intlib.h"
+#include "logging.h"
+
+
+/* An IntLib is itself a compound file, holding each of its source
+ * libraries as a stream under the "PCBLib" and "SchLib" storages:
+ *
+ *   PCBLib/0.pcblib, PCBLib/1.pcblib, ...
+ *   SchLib/0.schlib, ...
+ *
+ * Each stream is a single byte header followed by the zlib compressed
+ * library file. Embedded libraries may share footprint and symbol names,
+ * so each is converted into its own subdirectory, e.g. "PCBLib-0".
+ */
+
+#define INTLIB_STREAM_HEADER_SIZE 1
+
+typedef bool (*library_parser) (GBytes *bytes, const conversion_options *options, GError **error);
+
+
+/* Read a whole stream, directly from the mapped file when possible */
+static GBytes *
+read_child_bytes (GsfInfile *dir, GsfInput *input)
+{
+  file_content *content;
+  const guint8 *data;
+  GBytes *bytes;
+
+  content = cfb_content_for_child (dir, gsf_input_name (input));
+  if (content != NULL) {
+    bytes = content->bytes;
+    g_free (content);
+    return bytes;
+  }
+
+  data = gsf_input_read (input, gsf_input_size (input), NULL);
+  if (data == NULL)
+    return NULL;
+
+  return g_bytes_new (data, gsf_input_size (input));
+}
+
+/* Inflate a zlib stream into memory */
+static GBytes *
+inflate_bytes (const guint8 *data, gsize length, GError **error)
+{
+  GZlibDecompressor *decomp;
+  GError *tmp_error = NULL;
+  GByteArray *out;
+  GConverterResult result;
+  gsize bytes_read;
+  gsize bytes_written;
+  gsize used = 0;
+
+  decomp = g_zlib_decompressor_new (G_ZLIB_COMPRESSOR_FORMAT_ZLIB);
+
+  /* Libraries usually compress somewhere around 4:1, start from there */
+  out = g_byte_array_sized_new (length * 4 + 4096);
+  g_byte_array_set_size (out, length * 4 + 4096);
+
+  do {
+    if (used == out->len)
+      g_byte_array_set_size (out, out->len * 2);
+
+    result = g_converter_convert (G_CONVERTER (decomp),
+                                  data, length,
+                                  out->data + used, out->len - used,
+                                  G_CONVERTER_INPUT_AT_END,
+                                  &bytes_read, &bytes_written, &tmp_error);
+    if (result == G_CONVERTER_ERROR) {
+      /* Not enough room to make progress, so grow and try again */
+      if (g_error_matches (tmp_error, G_IO_ERROR, G_IO_ERROR_NO_SPACE)) {
+        g_clear_error (&tmp_error);
+        g_byte_array_set_size (out, out->len * 2);
+        continue;
+      }
+      g_propagate_error (error, tmp_error);
+      g_byte_array_unref (out);
+      g_object_unref (decomp);
+      return NULL;
+    }
+
+    data += bytes_read;
+    length -= bytes_read;
+    used += bytes_written;
+  } while (result != G_CONVERTER_FINISHED);
+
+  g_object_unref (decomp);
+
+  g_byte_array_set_size (out, used);
+  return g_byte_array_free_to_bytes (out);
+}
+
+/* Convert one unpacked library into its subdirectory of the output */
+static bool
+convert_embedded_library (GBytes *library, library_parser parser, const char *subdir,
+                          const conversion_options *options, GError **error)
+{
+  conversion_options embedded = *options;
+  bool ok;
+
+  embedded.output_dir = conversion_output_path (options, subdir);
+  embedded.raw_dump_prefix = (options->raw_dump_prefix != NULL) ?
+    g_strconcat (options->raw_dump_prefix, "/", subdir, NULL) : g_strdup (subdir);
+
+  if (g_mkdir_with_parents (embedded.output_dir, 0755) != 0) {
+    g_set_error (error, OPENALTIUM_ERROR, OPENALTIUM_ERROR_OUTPUT,
+                 "Couldn't create output directory %s", embedded.output_dir);
+    ok = false;
+  } else if (!conversion_open_manifest (&embedded, subdir, error)) {
+    ok = false;
+  } else {
+    ok = parser (library, &embedded, error);
+    if (!conversion_close_manifest (&embedded, ok ? error : NULL))
+      ok = false;
+  }
+
+  g_free (embedded.raw_dump_prefix);
+  g_free (embedded.output_dir);
+
+  return ok;
+}
+
+/* Unpack and convert every library stream in one of the IntLib's storages */
+static bool
+parse_embedded_libraries (GsfInfile *root, const char *storage_name,
+                          library_parser parser,
+                          const conversion_options *options, GError **error)
+{
+  GsfInfile *storage;
+  int children;
+  int i;
+  bool ok = true;
+
+  storage = GSF_INFILE (gsf_infile_child_by_name (root, storage_name));
+  if (storage == NULL) {
+    fprintf (stdout, "No %s storage in IntLib\n", storage_name);
+    return true;
+  }
+
+  children = gsf_infile_num_children (storage);
+  for (i = 0; ok && i < children; i++) {
+    GsfInput *input = gsf_infile_child_by_index (storage, i);
+    GError *tmp_error = NULL;
+    GBytes *packed;
+    GBytes *library;
+    char *subdir;
+    const guint8 *data;
+    gsize length;
+
+    log_info ("Unpacking embedded library '%s/%s'\n", storage_name, gsf_input_name (input));
+
+    packed = read_child_bytes (storage, input);
+    if (packed == NULL) {
+      g_set_error (error, OPENALTIUM_ERROR, OPENALTIUM_ERROR_FORMAT,
+                   "Read error grabbing '%s/%s'", storage_name, gsf_input_name (input));
+      g_object_unref (input);
+      ok = false;
+      break;
+    }
+
+    data = g_bytes_get_data (packed, &length);
+    if (length <= INTLIB_STREAM_HEADER_SIZE) {
+      g_set_error (error, OPENALTIUM_ERROR, OPENALTIUM_ERROR_FORMAT,
+                   "Embedded library '%s/%s' is truncated", storage_name, gsf_input_name (input));
+      g_bytes_unref (packed);
+      g_object_unref (input);
+      ok = false;
+      break;
+    }
+
+    library = inflate_bytes (data + INTLIB_STREAM_HEADER_SIZE,
+                             length - INTLIB_STREAM_HEADER_SIZE, &tmp_error);
+    g_bytes_unref (packed);
+
+    if (library == NULL) {
+      g_propagate_prefixed_error (error, tmp_error, "Couldn't inflate '%s/%s': ",
+                                  storage_name, gsf_input_name (input));
+      g_object_unref (input);
+      ok = false;
+      break;
+    }
+
+    subdir = g_strdup_printf ("%s-%d", storage_name, i);
+    ok = convert_embedded_library (library, parser, subdir, options, error);
+    g_free (subdir);
+
+    g_bytes_unref (library);
+    g_object_unref (input);
+  }
+
+  g_object_unref (storage);
+
+  return ok;
+}
+
+bool
+parse_intlib_file (const char *filename, const conversion_options *options, GError **error)
+{
+  GError *mmap_error = NULL;
+  GsfInput *input;
+  GsfInfile *root;
+  cfb_file *cfb = NULL;
+  bool ok;
+
+  input = gsf_input_stdio_new (filename, error);
+  if (input == NULL)
+    return false;
+
+  root = gsf_infile_msole_new (input, error);
+  g_object_unref (input);
+  if (root == NULL)
+    return false;
+
+  if (options->use_mmap) {
+    cfb = cfb_file_open (filename, &mmap_error);
+    if (check_gerror (mmap_error))
+      cfb_file_attach (cfb, root);
+    else
+      log_info ("Falling back to reading streams through libgsf\n");
+  }
+
+  ok = parse_embedded_libraries (root, "PCBLib", parse_pcblib_bytes, options, error) &&
+       parse_embedded_libraries (root, "SchLib", parse_schlib_bytes, options, error);
+
+  g_object_unref (root);
+
+  return ok;
+}
@@ -0,0 +1,679 @@
+/*
+ *  openaltium is a set of tools for opening Altium (TM) library files
+ *  Copyright (C) 2016  Peter Clifton <Peter.Clifton@clifton-electronics.co.uk>
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 2.1 of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this library; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <errno.h>
+#include <string.h>
+#include <glib.h>
+#include <glib/gstdio.h>
+
+#include "content-parser.h"
+#include "arena.h"
+#include "output-writer.h"
+#include "footprint.h"
+#include "library-cache.h"
+#include "openaltium-error.h"
+#include "logging.h"
+
+
+/* Everything is little endian. Bump the version whenever the layout,
+ * what the decoders put in the footprint tables, or content_fingerprint ()
+ * changes.
+ */
+#define LIBRARY_CACHE_MAGIC   "OALCACHE"
+#define LIBRARY_CACHE_VERSION 2
+#define LIBRARY_CACHE_SUFFIX  ".oalc"
+
+#define HEADER_SIZE           64
+#define DIRECTORY_ENTRY_SIZE  48
+#define COLUMN_ALIGNMENT      8
+
+/* Header, at offset 0 */
+#define HEADER_MAGIC             0      /* 8 bytes */
+#define HEADER_VERSION           8
+#define HEADER_RECORD_TYPES      12
+#define HEADER_SOURCE_SIZE       16     /* 64 bit */
+#define HEADER_SOURCE_MTIME      24     /* 64 bit */
+#define HEADER_SOURCE_HASH       32     /* 64 bit */
+#define HEADER_N_FOOTPRINTS      40
+#define HEADER_DIRECTORY_OFFSET  44
+#define HEADER_TABLES_OFFSET     48
+#define HEADER_TABLES_LENGTH     52
+#define HEADER_STRINGS_OFFSET    56
+#define HEADER_STRINGS_LENGTH    60
+
+/* Directory entry, one per footprint. The table counts follow, in the
+ * order of table_layouts. Table offsets are from the start of the tables.
+ */
+#define ENTRY_NAME               0      /* Offset into the string pool */
+#define ENTRY_TABLES             4
+#define ENTRY_FINGERPRINT        8      /* 64 bit */
+#define ENTRY_COUNTS             16
+
+typedef enum {
+  COLUMN_BYTE,
+  COLUMN_INT32,         /* Also unsigned */
+  COLUMN_DOUBLE,
+  COLUMN_STRING,        /* Offset into the string pool */
+} column_type;
+
+typedef struct {
+  goffset offset;       /* Of the column pointer within its table */
+  column_type type;
+} column_layout;
+
+#define COLUMN(table, field, type) { G_STRUCT_OFFSET (table, field), type }
+
+static const column_layout arc_columns[] = {
+  COLUMN (footprint_arcs, layer,         COLUMN_BYTE),
+  COLUMN (footprint_arcs, x,             COLUMN_INT32),
+  COLUMN (footprint_arcs, y,             COLUMN_INT32),
+  COLUMN (footprint_arcs, radius,        COLUMN_INT32),
+  COLUMN (footprint_arcs, start_angle,   COLUMN_DOUBLE),
+  COLUMN (footprint_arcs, delta_angle,   COLUMN_DOUBLE),
+  COLUMN (footprint_arcs, thickness,     COLUMN_INT32),
+};
+
+static const column_layout pad_columns[] = {
+  COLUMN (footprint_pads, layer,         COLUMN_BYTE),
+  COLUMN (footprint_pads, x1,            COLUMN_INT32),
+  COLUMN (footprint_pads, y1,            COLUMN_INT32),
+  COLUMN (footprint_pads, x2,            COLUMN_INT32),
+  COLUMN (footprint_pads, y2,            COLUMN_INT32),
+  COLUMN (footprint_pads, thickness,     COLUMN_INT32),
+  COLUMN (footprint_pads, clearance,     COLUMN_INT32),
+  COLUMN (footprint_pads, mask,          COLUMN_INT32),
+  COLUMN (footprint_pads, drill,         COLUMN_INT32),
+  COLUMN (footprint_pads, flags,         COLUMN_BYTE),
+  COLUMN (footprint_pads, name,          COLUMN_STRING),
+};
+
+static const column_layout line_columns[] = {
+  COLUMN (footprint_lines, layer,        COLUMN_BYTE),
+  COLUMN (footprint_lines, x1,           COLUMN_INT32),
+  COLUMN (footprint_lines, y1,           COLUMN_INT32),
+  COLUMN (footprint_lines, x2,           COLUMN_INT32),
+  COLUMN (footprint_lines, y2,           COLUMN_INT32),
+  COLUMN (footprint_lines, width,        COLUMN_INT32),
+};
+
+static const column_layout text_columns[] = {
+  COLUMN (footprint_texts, layer,        COLUMN_BYTE),
+  COLUMN (footprint_texts, x,            COLUMN_INT32),
+  COLUMN (footprint_texts, y,            COLUMN_INT32),
+  COLUMN (footprint_texts, height,       COLUMN_INT32),
+  COLUMN (footprint_texts, angle,        COLUMN_DOUBLE),
+  COLUMN (footprint_texts, text,         COLUMN_STRING),
+};
+
+static const column_layout rectangle_columns[] = {
+  COLUMN (footprint_rectangles, layer,   COLUMN_BYTE),
+  COLUMN (footprint_rectangles, x1,      COLUMN_INT32),
+  COLUMN (footprint_rectangles, y1,      COLUMN_INT32),
+  COLUMN (footprint_rectangles, x2,      COLUMN_INT32),
+  COLUMN (footprint_rectangles, y2,      COLUMN_INT32),
+};
+
+static const column_layout polygon_columns[] = {
+  COLUMN (footprint_polygons, layer,        COLUMN_BYTE),
+  COLUMN (footprint_polygons, first_vertex, COLUMN_INT32),
+  COLUMN (footprint_polygons, n_vertices,   COLUMN_INT32),
+};
+
+static const column_layout vertex_columns[] = {
+  COLUMN (footprint_vertices, x,         COLUMN_DOUBLE),
+  COLUMN (footprint_vertices, y,         COLUMN_DOUBLE),
+};
+
+static const column_layout model_columns[] = {
+  COLUMN (footprint_models, filename,    COLUMN_STRING),
+  COLUMN (footprint_models, origin_x,    COLUMN_DOUBLE),
+  COLUMN (footprint_models, origin_y,    COLUMN_DOUBLE),
+  COLUMN (footprint_models, origin_z,    COLUMN_DOUBLE),
+  COLUMN (footprint_models, axis_x,      COLUMN_DOUBLE),
+  COLUMN (footprint_models, axis_y,      COLUMN_DOUBLE),
+  COLUMN (footprint_models, axis_z,      COLUMN_DOUBLE),
+  COLUMN (footprint_models, ref_x,       COLUMN_DOUBLE),
+  COLUMN (footprint_models, ref_y,       COLUMN_DOUBLE),
+  COLUMN (footprint_models, ref_z,       COLUMN_DOUBLE),
+};
+
+typedef struct {
+  goffset offset;       /* Of the table within the footprint */
+  const column_layout *columns;
+  int n_columns;
+} table_layout;
+
+#define TABLE(field, columns) { G_STRUCT_OFFSET (footprint, field), columns, G_N_ELEMENTS (columns) }
+
+static const table_layout table_layouts[] = {
+  TABLE (arcs,       arc_columns),
+  TABLE (pads,       pad_columns),
+  TABLE (lines,      line_columns),
+  TABLE (texts,      text_columns),
+  TABLE (rectangles, rectangle_columns),
+  TABLE (polygons,   polygon_columns),
+  TABLE (vertices,   vertex_columns),
+  TABLE (models,     model_columns),
+};
+
+#define N_TABLES G_N_ELEMENTS (table_layouts)
+
+G_STATIC_ASSERT (ENTRY_COUNTS + 4 * N_TABLES == DIRECTORY_ENTRY_SIZE);
+
+/* NB: Every footprint table starts with its len and allocated counts */
+typedef struct {
+  guint len;
+  guint allocated;
+} table_header;
+
+static gsize
+column_type_size (column_type type)
+{
+  switch (type) {
+    case COLUMN_BYTE:   return 1;
+    case COLUMN_INT32:  return 4;
+    case COLUMN_DOUBLE: return 8;
+    case COLUMN_STRING: return 4;
+  }
+  return 0;
+}
+
+static gsize
+column_in_memory_size (column_type type)
+{
+  return (type == COLUMN_STRING) ? sizeof (const char *) : column_type_size (type);
+}
+
+static inline gpointer *
+column_pointer (gconstpointer table, const column_layout *column)
+{
+  return (gpointer *)((char *)table + column->offset);
+}
+
+static gsize
+align_column (gsize offset)
+{
+  return (offset + COLUMN_ALIGNMENT - 1) & ~(gsize)(COLUMN_ALIGNMENT - 1);
+}
+
+
+/* Where the cache for converting source goes. */
+char *
+library_cache_path (const char *cache_dir, const char *source)
+{
+  char *source_path;
+  char *digest;
+  char *filename;
+  char *path;
+
+  source_path = g_canonicalize_filename (source, NULL);
+  digest = g_compute_checksum_for_string (G_CHECKSUM_SHA1, source_path, -1);
+  filename = g_strconcat (digest, LIBRARY_CACHE_SUFFIX, NULL);
+  path = g_build_filename (cache_dir, filename, NULL);
+
+  g_free (filename);
+  g_free (digest);
+  g_free (source_path);
+
+  return path;
+}
+
+static bool
+stat_source (const char *source, guint64 *size, gint64 *mtime)
+{
+  GStatBuf buf;
+
+  if (g_stat (source, &buf) != 0)
+    return false;
+
+  *size = buf.st_size;
+  *mtime = buf.st_mtime;
+  return true;
+}
+
+static bool
+hash_source (const char *source, guint64 *hash)
+{
+  GMappedFile *mapped;
+  file_content content = {0};
+
+  mapped = g_mapped_file_new (source, FALSE, NULL);
+  if (mapped == NULL)
+    return false;
+
+  content.data = g_mapped_file_get_contents (mapped);
+  content.length = g_mapped_file_get_length (mapped);
+  *hash = content_fingerprint (&content, 0);
+
+  g_mapped_file_unref (mapped);
+  return true;
+}
+
+
+struct library_cache {
+  GMappedFile *mapped;
+  const char *data;
+  gsize length;
+  guint n_footprints;
+  const char *directory;
+  const char *tables;
+  guint32 tables_length;
+  const char *strings;
+  guint32 strings_length;
+};
+
+/* Whether [offset, offset + length) lies within a section of section_length */
+static bool
+span_fits (guint64 offset, guint64 length, guint64 section_length)
+{
+  return offset <= section_length && length <= section_length - offset;
+}
+
+/* Map the cache at path, if it is still good for source. Returns NULL if
+ * there is no cache, or it is stale or damaged, so must be made again.
+ */
+library_cache *
+library_cache_open (const char *path, const char *source, guint32 record_types)
+{
+  library_cache *cache;
+  GMappedFile *mapped;
+  const char *data;
+  gsize length;
+  guint64 source_size;
+  gint64 source_mtime;
+  guint64 source_hash;
+  guint32 directory_offset;
+  guint32 tables_offset;
+  guint32 strings_offset;
+
+  mapped = g_mapped_file_new (path, FALSE, NULL);
+  if (mapped == NULL)
+    return NULL;
+
+  data = g_mapped_file_get_contents (mapped);
+  length = g_mapped_file_get_length (mapped);
+
+  if (length < HEADER_SIZE ||
+      memcmp (data + HEADER_MAGIC, LIBRARY_CACHE_MAGIC, 8) != 0 ||
+      content_load_uint32 (data + HEADER_VERSION) != LIBRARY_CACHE_VERSION) {
+    log_info ("Ignoring library cache %s, it isn't one this version can read\n", path);
+    g_mapped_file_unref (mapped);
+    return NULL;
+  }
+
+  if (content_load_uint32 (data + HEADER_RECORD_TYPES) != record_types ||
+      !stat_source (source, &source_size, &source_mtime) ||
+      content_load_uint64 (data + HEADER_SOURCE_SIZE) != source_size) {
+    g_mapped_file_unref (mapped);
+    return NULL;
+  }
+
+  /* A library which was only touched, or copied, is still the same */
+  if ((gint64) content_load_uint64 (data + HEADER_SOURCE_MTIME) != source_mtime &&
+      (!hash_source (source, &source_hash) ||
+       content_load_uint64 (data + HEADER_SOURCE_HASH) != source_hash)) {
+    g_mapped_file_unref (mapped);
+    return NULL;
+  }
+
+  cache = g_slice_new0 (library_cache);
+  cache->mapped = mapped;
+  cache->data = data;
+  cache->length = length;
+  cache->n_footprints = content_load_uint32 (data + HEADER_N_FOOTPRINTS);
+  directory_offset = content_load_uint32 (data + HEADER_DIRECTORY_OFFSET);
+  tables_offset = content_load_uint32 (data + HEADER_TABLES_OFFSET);
+  cache->tables_length = content_load_uint32 (data + HEADER_TABLES_LENGTH);
+  strings_offset = content_load_uint32 (data + HEADER_STRINGS_OFFSET);
+  cache->strings_length = content_load_uint32 (data + HEADER_STRINGS_LENGTH);
+
+  /* The string pool always ends with a NUL, so no string runs off its end */
+  if (!span_fits (directory_offset, (guint64) cache->n_footprints * DIRECTORY_ENTRY_SIZE, length) ||
+      !span_fits (tables_offset, cache->tables_length, length) ||
+      !span_fits (strings_offset, cache->strings_length, length) ||
+      cache->strings_length == 0 ||
+      data[strings_offset + cache->strings_length - 1] != '\0') {
+    log_info ("Ignoring damaged library cache %s\n", path);
+    library_cache_close (cache);
+    return NULL;
+  }
+
+  cache->directory = data + directory_offset;
+  cache->tables = data + tables_offset;
+  cache->strings = data + strings_offset;
+
+  return cache;
+}
+
+void
+library_cache_close (library_cache *cache)
+{
+  if (cache == NULL)
+    return;
+
+  g_mapped_file_unref (cache->mapped);
+  g_slice_free (library_cache, cache);
+}
+
+guint
+library_cache_n_footprints (const library_cache *cache)
+{
+  return cache->n_footprints;
+}
+
+static const char *
+cache_string (const library_cache *cache, guint32 offset)
+{
+  return (offset < cache->strings_length) ? cache->strings + offset : NULL;
+}
+
+const char *
+library_cache_footprint_name (const library_cache *cache, guint index)
+{
+  const char *entry = cache->directory + index * DIRECTORY_ENTRY_SIZE;
+
+  return cache_string (cache, content_load_uint32 (entry + ENTRY_NAME));
+}
+
+guint64
+library_cache_footprint_fingerprint (const library_cache *cache, guint index)
+{
+  const char *entry = cache->directory + index * DIRECTORY_ENTRY_SIZE;
+
+  return content_load_uint64 (entry + ENTRY_FINGERPRINT);
+}
+
+static bool
+load_column (const library_cache *cache, const column_layout *column, gpointer table,
+             guint n_rows, guint64 *offset)
+{
+  gsize size = column_type_size (column->type);
+  gpointer *pointer = column_pointer (table, column);
+  const char *data;
+  guint i;
+
+  if (!span_fits (*offset, (guint64) n_rows * size, cache->tables_length))
+    return false;
+
+  data = cache->tables + *offset;
+  *offset = align_column (*offset + (guint64) n_rows * size);
+
+  *pointer = g_realloc_n (*pointer, n_rows, column_in_memory_size (column->type));
+
+  for (i = 0; i < n_rows; i++) {
+    switch (column->type) {
+      case COLUMN_BYTE:
+        ((uint8_t *) *pointer)[i] = content_load_byte (data + i);
+        break;
+      case COLUMN_INT32:
+        ((uint32_t *) *pointer)[i] = content_load_uint32 (data + 4 * i);
+        break;
+      case COLUMN_DOUBLE:
+        ((double *) *pointer)[i] = content_load_double (data + 8 * i);
+        break;
+      case COLUMN_STRING:
+        ((const char **) *pointer)[i] = cache_string (cache, content_load_uint32 (data + 4 * i));
+        if (((const char **) *pointer)[i] == NULL)
+          return false;
+        break;
+    }
+  }
+
+  return true;
+}
+
+/* Returns a newly allocated footprint, or NULL if its tables are damaged.
+ * NB: Its strings point into the cache, so it mustn't outlive the cache.
+ */
+footprint *
+library_cache_load_footprint (const library_cache *cache, guint index)
+{
+  const char *entry = cache->directory + index * DIRECTORY_ENTRY_SIZE;
+  guint64 offset;
+  footprint *fp;
+  guint t, i;
+  int c;
+
+  fp = footprint_new ();
+  offset = content_load_uint32 (entry + ENTRY_TABLES);
+
+  for (t = 0; t < N_TABLES; t++) {
+    const table_layout *layout = &table_layouts[t];
+    table_header *table = (table_header *)((char *)fp + layout->offset);
+    guint n_rows = content_load_uint32 (entry + ENTRY_COUNTS + 4 * t);
+
+    for (c = 0; c < layout->n_columns; c++) {
+      if (!load_column (cache, &layout->columns[c], table, n_rows, &offset)) {
+        footprint_free (fp);
+        return NULL;
+      }
+    }
+
+    table->len = n_rows;
+    table->allocated = n_rows;
+  }
+
+  /* The polygons' vertex ranges are trusted by whoever uses them */
+  for (i = 0; i < fp->polygons.len; i++) {
+    if (fp->polygons.first_vertex[i] > fp->vertices.len ||
+        fp->polygons.n_vertices[i] > fp->vertices.len - fp->polygons.first_vertex[i]) {
+      footprint_free (fp);
+      return NULL;
+    }
+  }
+
+  return fp;
+}
+
+
+struct library_cache_writer {
+  GByteArray *directory;
+  GByteArray *tables;
+  GByteArray *strings;
+  GHashTable *string_offsets;   /* String -> its offset in the pool, plus 1 */
+  guint n_footprints;
+};
+
+library_cache_writer *
+library_cache_writer_new (void)
+{
+  library_cache_writer *writer;
+
+  writer = g_slice_new0 (library_cache_writer);
+  writer->directory = g_byte_array_new ();
+  writer->tables = g_byte_array_new ();
+  writer->strings = g_byte_array_new ();
+  writer->string_offsets = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
+
+  return writer;
+}
+
+void
+library_cache_writer_free (library_cache_writer *writer)
+{
+  if (writer == NULL)
+    return;
+
+  g_byte_array_unref (writer->directory);
+  g_byte_array_unref (writer->tables);
+  g_byte_array_unref (writer->strings);
+  g_hash_table_unref (writer->string_offsets);
+  g_slice_free (library_cache_writer, writer);
+}
+
+static void
+append_uint32 (GByteArray *array, guint32 value)
+{
+  guint8 bytes[4];
+  int i;
+
+  for (i = 0; i < 4; i++)
+    bytes[i] = value >> (8 * i);
+
+  g_byte_array_append (array, bytes, 4);
+}
+
+static void
+append_uint64 (GByteArray *array, guint64 value)
+{
+  append_uint32 (array, value);
+  append_uint32 (array, value >> 32);
+}
+
+static void
+append_double (GByteArray *array, double value)
+{
+  guint64 bits;
+
+  memcpy (&bits, &value, sizeof (bits));
+  append_uint64 (array, bits);
+}
+
+/* Strings are pooled, so each distinct one is only stored once */
+static guint32
+intern_string (library_cache_writer *writer, const char *string)
+{
+  gpointer offset;
+
+  offset = g_hash_table_lookup (writer->string_offsets, string);
+  if (offset != NULL)
+    return GPOINTER_TO_UINT (offset) - 1;
+
+  offset = GUINT_TO_POINTER (writer->strings->len + 1);
+  g_hash_table_insert (writer->string_offsets, g_strdup (string), offset);
+  g_byte_array_append (writer->strings, (const guint8 *) string, strlen (string) + 1);
+
+  return GPOINTER_TO_UINT (offset) - 1;
+}
+
+static void
+write_column (library_cache_writer *writer, const column_layout *column,
+              gconstpointer table, guint n_rows)
+{
+  gconstpointer values = *column_pointer (table, column);
+  static const guint8 padding[COLUMN_ALIGNMENT] = {0};
+  guint i;
+
+  for (i = 0; i < n_rows; i++) {
+    switch (column->type) {
+      case COLUMN_BYTE:
+        g_byte_array_append (writer->tables, (const guint8 *) values + i, 1);
+        break;
+      case COLUMN_INT32:
+        append_uint32 (writer->tables, ((const uint32_t *) values)[i]);
+        break;
+      case COLUMN_DOUBLE:
+        append_double (writer->tables, ((const double *) values)[i]);
+        break;
+      case COLUMN_STRING:
+        append_uint32 (writer->tables, intern_string (writer, ((const char * const *) values)[i]));
+        break;
+    }
+  }
+
+  g_byte_array_append (writer->tables, padding,
+                       align_column (writer->tables->len) - writer->tables->len);
+}
+
+/* Add a decoded footprint to the cache. Everything needed is copied, so fp
+ * can be freed straight after.
+ */
+void
+library_cache_writer_add (library_cache_writer *writer, const char *name,
+                          guint64 fingerprint, const footprint *fp)
+{
+  guint t;
+  int c;
+
+  append_uint32 (writer->directory, intern_string (writer, name));
+  append_uint32 (writer->directory, writer->tables->len);
+  append_uint64 (writer->directory, fingerprint);
+
+  for (t = 0; t < N_TABLES; t++) {
+    const table_layout *layout = &table_layouts[t];
+    const table_header *table = (const table_header *)((const char *)fp + layout->offset);
+
+    append_uint32 (writer->directory, table->len);
+
+    for (c = 0; c < layout->n_columns; c++)
+      write_column (writer, &layout->columns[c], table, table->len);
+  }
+
+  writer->n_footprints++;
+}
+
+/* Write the cache of source's footprints out to path, replacing any which
+ * is already there.
+ */
+bool
+library_cache_writer_save (library_cache_writer *writer, const char *path, const char *source,
+                           guint32 record_types, GError **error)
+{
+  GByteArray *file;
+  guint64 source_size = 0;
+  gint64 source_mtime = 0;
+  guint64 source_hash = 0;
+  guint32 tables_offset;
+  guint32 strings_offset;
+  char *dir;
+  bool ok;
+
+  if (!stat_source (source, &source_size, &source_mtime) ||
+      !hash_source (source, &source_hash)) {
+    g_set_error (error, OPENALTIUM_ERROR, OPENALTIUM_ERROR_OPEN,
+                 "Couldn't read %s to stamp its library cache", source);
+    return false;
+  }
+
+  /* The pool is never empty, so the NUL it ends with can be checked for */
+  intern_string (writer, "");
+
+  tables_offset = HEADER_SIZE + writer->directory->len;
+  strings_offset = tables_offset + writer->tables->len;
+
+  file = g_byte_array_sized_new (strings_offset + writer->strings->len);
+  g_byte_array_append (file, (const guint8 *) LIBRARY_CACHE_MAGIC, 8);
+  append_uint32 (file, LIBRARY_CACHE_VERSION);
+  append_uint32 (file, record_types);
+  append_uint64 (file, source_size);
+  append_uint64 (file, source_mtime);
+  append_uint64 (file, source_hash);
+  append_uint32 (file, writer->n_footprints);
+  append_uint32 (file, HEADER_SIZE);
+  append_uint32 (file, tables_offset);
+  append_uint32 (file, writer->tables->len);
+  append_uint32 (file, strings_offset);
+  append_uint32 (file, writer->strings->len);
+  g_assert (file->len == HEADER_SIZE);
+
+  g_byte_array_append (file, writer->directory->data, writer->directory->len);
+  g_byte_array_append (file, writer->tables->data, writer->tables->len);
+  g_byte_array_append (file, writer->strings->data, writer->strings->len);
+
+  dir = g_path_get_dirname (path);
+  g_mkdir_with_parents (dir, 0755);
+  g_free (dir);
+
+  ok = g_file_set_contents (path, (const char *) file->data, file->len, error);
+  g_byte_array_unref (file);
+
+  return ok;
+}
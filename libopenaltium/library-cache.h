@@ -0,0 +1,48 @@
+/*
+ *  openaltium is a set of tools for opening Altium (TM) library files
+ *  Copyright (C) 2016  Peter Clifton <Peter.Clifton@clifton-electronics.co.uk>
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 2.1 of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this library; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+
+/* Decoded libraries saved in a compact binary form, so converting the same
+ * library again needn't open, inflate or decode anything. A cache file is
+ * a header, a directory of footprints, each footprint's primitive tables
+ * (column after column, as in memory) and a pool of the strings they use.
+ *
+ * A cache is only used while its library's size and mtime, or failing
+ * that the hash of its content, still match what it was made from.
+ */
+
+typedef struct library_cache library_cache;
+typedef struct library_cache_writer library_cache_writer;
+
+char *library_cache_path (const char *cache_dir, const char *source);
+
+library_cache *library_cache_open (const char *path, const char *source, guint32 record_types);
+void library_cache_close (library_cache *cache);
+
+guint library_cache_n_footprints (const library_cache *cache);
+const char *library_cache_footprint_name (const library_cache *cache, guint index);
+guint64 library_cache_footprint_fingerprint (const library_cache *cache, guint index);
+footprint *library_cache_load_footprint (const library_cache *cache, guint index);
+
+library_cache_writer *library_cache_writer_new (void);
+void library_cache_writer_free (library_cache_writer *writer);
+void library_cache_writer_add (library_cache_writer *writer, const char *name,
+                               guint64 fingerprint, const footprint *fp);
+bool library_cache_writer_save (library_cache_writer *writer, const char *path, const char *source,
+                                guint32 record_types, GError **error);
@@ -0,0 +1,56 @@
+/*
+ *  openaltium is a set of tools for opening Altium (TM) library files
+ *  Copyright (C) 2016  Peter Clifton <Peter.Clifton@clifton-electronics.co.uk>
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 2.1 of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this library; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include <stdbool.h>
+#include <stdio.h>
+#include <glib.h>
+
+#include "logging.h"
+
+
+/* NB: Only set while parsing the command line, before any threads start */
+log_level openaltium_log_level = LOG_LEVEL_INFO;
+
+void
+log_set_level (log_level level)
+{
+  openaltium_log_level = level;
+}
+
+/* Report and free an error, if there was one. Returns whether there wasn't. */
+int
+check_gerror (GError *error) {
+  if (error != NULL) {
+    fprintf (stdout, "Error: %s\n", error->message);
+    g_error_free (error);
+    return 0;
+  }
+  return 1;
+}
+
+/* Whether this build can trace at all */
+bool
+log_trace_available (void)
+{
+#ifdef OPENALTIUM_ENABLE_TRACE
+  return true;
+#else
+  return false;
+#endif
+}
@@ -0,0 +1,52 @@
+/*
+ *  openaltium is a set of tools for opening Altium (TM) library files
+ *  Copyright (C) 2016  Peter Clifton <Peter.Clifton@clifton-electronics.co.uk>
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 2.1 of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this library; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+
+/* How much the converter reports on stdout. Errors are always printed.
+ *
+ * Tracing of every decoded field is compiled out entirely when configured
+ * with --disable-trace, otherwise it costs one test per call site unless
+ * enabled at run time.
+ */
+
+typedef enum {
+  LOG_LEVEL_QUIET,      /* Errors only */
+  LOG_LEVEL_INFO,       /* Progress through each library */
+  LOG_LEVEL_TRACE,      /* Every record and field decoded */
+} log_level;
+
+extern log_level openaltium_log_level;
+
+void log_set_level (log_level level);
+bool log_trace_available (void);
+int check_gerror (GError *error);
+
+#define log_enabled(level) (openaltium_log_level >= (level))
+
+#ifdef OPENALTIUM_ENABLE_TRACE
+#define log_trace_enabled() log_enabled (LOG_LEVEL_TRACE)
+#else
+#define log_trace_enabled() 0
+#endif
+
+#define log_info(...) \
+  G_STMT_START { if (log_enabled (LOG_LEVEL_INFO)) printf (__VA_ARGS__); } G_STMT_END
+
+#define log_trace(...) \
+  G_STMT_START { if (log_trace_enabled ()) printf (__VA_ARGS__); } G_STMT_END
@@ -24,6 +24,7 @@
 #include <string.h>
 #include <getopt.h>
 #include <glib.h>
+#include <glib/gstdio.h>
 #include <gio/gio.h>
 #include <gsf/gsf.h>
 #include <gsf/gsf-input-stdio.h>
@@ -31,23 +32,51 @@
 #include <gsf/gsf-infile-msole.h>
 
 #include "content-parser.h"
+#include "options.h"
 #include "pcblib.h"
 #include "schlib.h"
+#include "intlib.h"
+#include "batch.h"
+#include "model-cache.h"
+#include "logging.h"
+#include "stats.h"
 
 
+#define DEFAULT_MODEL_CACHE_MB 2048
+
 static void
 print_usage (char *program)
 {
   fprintf (stdout, "Usage: %s [OPTIONS] -f [datafile]\n", program);
+  fprintf (stdout, "       %s [OPTIONS] -b [directory]\n", program);
   fprintf (stdout, "OPTIONS: -p, --pcblib PCBLib file\n");
   fprintf (stdout, "         -s, --schlib SchLib file\n");
+  fprintf (stdout, "         -i, --intlib IntLib file\n");
+  fprintf (stdout, "         -b, --batch  Convert all the libraries found under a directory\n");
+  fprintf (stdout, "         -j, --jobs   Number of libraries (batch mode) or footprints to convert at once\n");
+  fprintf (stdout, "         -o, --output Directory to write converted files into\n");
+  fprintf (stdout, "         -r, --record-types Only convert these footprint records, e.g. \"pad,track\"\n");
+  fprintf (stdout, "         -a, --all-models Extract every embedded model, not just those footprints use\n");
+  fprintf (stdout, "         -I, --incremental Only convert what changed since the last run into the output directory\n");
+  fprintf (stdout, "         -c, --model-cache Keep inflated models in a directory, to reuse in later runs\n");
+  fprintf (stdout, "         -C, --model-cache-size Most MiB the model cache may use (default %i)\n",
+           DEFAULT_MODEL_CACHE_MB);
+  fprintf (stdout, "         -D, --decode-cache Keep decoded footprints in a directory, to reuse in later runs\n");
+  fprintf (stdout, "         -d, --dump-raw Archive each library's raw streams into a directory\n");
+  fprintf (stdout, "         -m, --mmap   Read SchLib and IntLib streams in place from a memory-mapped file (PcbLibs always are)\n");
+  fprintf (stdout, "         -q, --quiet  Only report errors\n");
+  fprintf (stdout, "         -t, --trace  Trace every record and field decoded\n");
+  fprintf (stdout, "         -S, --stats  Print where the time went and what was decoded\n");
+  fprintf (stdout, "         -J, --stats-json Write the --stats summary to a JSON file\n");
   fprintf (stdout, "         -h, --help   Display usage\n");
 }
 
 enum mode_e {
   MODE_NONE,
   MODE_PCBLIB,
-  MODE_SCHLIB
+  MODE_SCHLIB,
+  MODE_INTLIB,
+  MODE_BATCH
 };
 
 int
@@ -56,14 +85,38 @@ main (int argc, char **argv)
   extern char *optarg;
   extern int optind, opterr, optopt;
   enum mode_e mode = MODE_NONE;
+  conversion_options options = {0};
+  GError *error = NULL;
+  bool ok = true;
+  int jobs = 0;
+  char *model_cache_dir = NULL;
+  guint64 model_cache_mb = DEFAULT_MODEL_CACHE_MB;
+  bool print_stats = false;
+  char *stats_json = NULL;
 
-  char *optstring = "f:psh";
+  char *optstring = "f:psib:j:o:r:aIc:C:D:d:mqtSJ:h";
   int opt;
   int option_index = 0;
   struct option long_options[] = {
     {"file",   required_argument, NULL, 'f'},
     {"pcblib", no_argument,       NULL, 'p'},
     {"schlib", no_argument,       NULL, 's'},
+    {"intlib", no_argument,       NULL, 'i'},
+    {"batch",  required_argument, NULL, 'b'},
+    {"jobs",   required_argument, NULL, 'j'},
+    {"output", required_argument, NULL, 'o'},
+    {"record-types", required_argument, NULL, 'r'},
+    {"all-models", no_argument,     NULL, 'a'},
+    {"incremental", no_argument,    NULL, 'I'},
+    {"model-cache", required_argument, NULL, 'c'},
+    {"model-cache-size", required_argument, NULL, 'C'},
+    {"decode-cache", required_argument, NULL, 'D'},
+    {"dump-raw", required_argument, NULL, 'd'},
+    {"mmap",   no_argument,       NULL, 'm'},
+    {"quiet",  no_argument,       NULL, 'q'},
+    {"trace",  no_argument,       NULL, 't'},
+    {"stats",  no_argument,       NULL, 'S'},
+    {"stats-json", required_argument, NULL, 'J'},
     {"help",   no_argument,       NULL, 'h'},
     {NULL,     0,                 NULL, 0}
   };
@@ -94,6 +147,93 @@ main (int argc, char **argv)
         mode = MODE_SCHLIB;
       break;
 
+      case 'i':
+        if (mode != MODE_NONE) {
+          fprintf (stdout, "More than one file mode specified\n");
+          print_usage (argv[0]);
+          exit (EXIT_FAILURE);
+        }
+        mode = MODE_INTLIB;
+      break;
+
+      case 'b':
+        if (mode != MODE_NONE) {
+          fprintf (stdout, "More than one file mode specified\n");
+          print_usage (argv[0]);
+          exit (EXIT_FAILURE);
+        }
+        mode = MODE_BATCH;
+        filename = g_strdup (optarg);
+      break;
+
+      case 'j':
+        jobs = atoi (optarg);
+      break;
+
+      case 'o':
+        g_free (options.output_dir);
+        options.output_dir = g_strdup (optarg);
+      break;
+
+      case 'r':
+        if (!pcblib_parse_record_types (optarg, &options.record_types, &error)) {
+          fprintf (stdout, "%s\n", error->message);
+          exit (EXIT_FAILURE);
+        }
+      break;
+
+      case 'a':
+        options.all_models = true;
+      break;
+
+      case 'I':
+        options.incremental = true;
+      break;
+
+      case 'c':
+        g_free (model_cache_dir);
+        model_cache_dir = g_strdup (optarg);
+      break;
+
+      case 'C':
+        model_cache_mb = g_ascii_strtoull (optarg, NULL, 10);
+      break;
+
+      case 'D':
+        g_free (options.decode_cache_dir);
+        options.decode_cache_dir = g_strdup (optarg);
+      break;
+
+      case 'd':
+        g_free (options.dump_raw_dir);
+        options.dump_raw_dir = g_strdup (optarg);
+      break;
+
+      case 'm':
+        options.use_mmap = true;
+      break;
+
+      case 'q':
+        log_set_level (LOG_LEVEL_QUIET);
+      break;
+
+      case 't':
+        if (!log_trace_available ())
+          fprintf (stdout, "Tracing was disabled when this program was built\n");
+        log_set_level (LOG_LEVEL_TRACE);
+      break;
+
+      case 'S':
+        print_stats = true;
+        stats_enable ();
+      break;
+
+      case 'J':
+        g_free (stats_json);
+        stats_json = g_strdup (optarg);
+        stats_enable ();
+      break;
+
       case 'h':
       default: /* '?' */
         print_usage (argv[0]);
@@ -118,7 +258,32 @@ main (int argc, char **argv)
     print_usage (argv[0]);
     exit (EXIT_FAILURE);
   } else {
-    fprintf (stdout, "Loading from file '%s'\n", filename);
+    log_info ("Loading from file '%s'\n", filename);
+  }
+
+  if (mode != MODE_BATCH && options.output_dir != NULL &&
+      g_mkdir_with_parents (options.output_dir, 0755) != 0) {
+    fprintf (stdout, "Couldn't create output directory '%s'\n", options.output_dir);
+    exit (EXIT_FAILURE);
+  }
+
+  if (model_cache_dir != NULL) {
+    options.model_cache = model_cache_new (model_cache_dir, model_cache_mb * 1024 * 1024, &error);
+    if (options.model_cache == NULL) {
+      fprintf (stdout, "Error: %s\n", error->message);
+      exit (EXIT_FAILURE);
+    }
+  }
+
+  if (mode != MODE_BATCH) {
+    char *library_name = g_path_get_basename (filename);
+    bool opened = conversion_open_manifest (&options, library_name, &error) &&
+                  conversion_open_raw_dump (&options, library_name, &error);
+    g_free (library_name);
+    if (!opened) {
+      fprintf (stdout, "Error: %s\n", error->message);
+      exit (EXIT_FAILURE);
+    }
   }
 
   switch (mode) {
@@ -128,16 +293,59 @@ main (int argc, char **argv)
       break;
 
     case MODE_PCBLIB:
-      parse_pcblib_file (filename);
+      options.library_jobs = jobs;
+      ok = parse_pcblib_file (filename, &options, &error);
       break;
 
     case MODE_SCHLIB:
-      parse_schlib_file (filename);
+      ok = parse_schlib_file (filename, &options, &error);
       break;
 
+    case MODE_INTLIB:
+      options.library_jobs = jobs;
+      ok = parse_intlib_file (filename, &options, &error);
+      break;
+
+    case MODE_BATCH:
+      if (options.output_dir == NULL)
+        options.output_dir = g_strdup ("converted");
+      ok = (convert_directory (filename, &options, jobs) == 0);
+      break;
+
+  }
+
+  if (!conversion_close_raw_dump (&options, error == NULL ? &error : NULL))
+    ok = false;
+
+  if (!conversion_close_manifest (&options, error == NULL ? &error : NULL))
+    ok = false;
+
+  if (error != NULL) {
+    fprintf (stdout, "Error: %s\n", error->message);
+    g_error_free (error);
+    error = NULL;
+  }
+
+  if (print_stats)
+    stats_print (stdout);
+
+  if (stats_json != NULL && !stats_write_json (stats_json, &error)) {
+    fprintf (stdout, "Error: %s\n", error->message);
+    g_error_free (error);
+    ok = false;
+  }
+
+  if (options.model_cache != NULL) {
+    model_cache_trim (options.model_cache);
+    model_cache_free (options.model_cache);
   }
 
+  g_free (stats_json);
+  g_free (model_cache_dir);
+  g_free (options.decode_cache_dir);
+  g_free (options.dump_raw_dir);
+  g_free (options.output_dir);
   g_free (filename);
 
-  exit (EXIT_SUCCESS);
+  exit (ok ? EXIT_SUCCESS : EXIT_FAILURE);
 }
@@ -0,0 +1,294 @@
+/*
+ *  openaltium is a set of tools for opening Altium (TM) library files
+ *  Copyright (C) 2016  Peter Clifton <Peter.Clifton@clifton-electronics.co.uk>
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 2.1 of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this library; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <string.h>
+#include <glib.h>
+#include <glib/gstdio.h>
+
+#include "openaltium-error.h"
+#include "manifest.h"
+#include "logging.h"
+
+
+#define MANIFEST_PREFIX ".openaltium-manifest-"
+#define MANIFEST_VERSION "openaltium-manifest 2"
+
+typedef struct {
+  guint64 fingerprint;
+  char **files;         /* Relative to the output directory */
+  bool seen;            /* The resource is still in the library this run */
+} manifest_entry;
+
+struct conversion_manifest {
+  GMutex lock;          /* Resources may be recorded from several threads */
+  char *output_dir;
+  char *path;
+  GHashTable *entries;  /* Resource name -> manifest_entry */
+  bool dirty;
+};
+
+
+static void
+manifest_entry_free (manifest_entry *entry)
+{
+  g_strfreev (entry->files);
+  g_slice_free (manifest_entry, entry);
+}
+
+/* Each line holds the fingerprint in hex, the resource name and the files
+ * written for it, separated by tabs. Fields are escaped as C strings, so
+ * odd characters in resource names survive the round trip.
+ */
+static void
+parse_manifest_line (conversion_manifest *manifest, const char *line)
+{
+  manifest_entry *entry;
+  char **fields;
+  int n_fields;
+  int i;
+
+  fields = g_strsplit (line, "\t", -1);
+  n_fields = g_strv_length (fields);
+
+  if (n_fields < 2) {
+    g_strfreev (fields);
+    return;
+  }
+
+  entry = g_slice_new0 (manifest_entry);
+  entry->fingerprint = g_ascii_strtoull (fields[0], NULL, 16);
+  entry->files = g_new0 (char *, n_fields - 1);
+  for (i = 2; i < n_fields; i++)
+    entry->files[i - 2] = g_strcompress (fields[i]);
+
+  g_hash_table_replace (manifest->entries, g_strcompress (fields[1]), entry);
+  g_strfreev (fields);
+}
+
+/* Load the manifest of a library from an output directory. Each library
+ * converted into the directory has its own, named after it, so libraries
+ * sharing a directory don't overwrite each other's. A library which hasn't
+ * been converted there before just gets an empty one.
+ */
+conversion_manifest *
+conversion_manifest_open (const char *output_dir, const char *library_name, GError **error)
+{
+  conversion_manifest *manifest;
+  GError *tmp_error = NULL;
+  char *filename;
+  char *contents;
+  char **lines;
+  int i;
+
+  manifest = g_slice_new0 (conversion_manifest);
+  g_mutex_init (&manifest->lock);
+  manifest->output_dir = g_strdup (output_dir != NULL ? output_dir : ".");
+  filename = g_strconcat (MANIFEST_PREFIX, library_name, NULL);
+  manifest->path = g_build_filename (manifest->output_dir, filename, NULL);
+  g_free (filename);
+  manifest->entries = g_hash_table_new_full (g_str_hash, g_str_equal, g_free,
+                                             (GDestroyNotify) manifest_entry_free);
+
+  if (!g_file_get_contents (manifest->path, &contents, NULL, &tmp_error)) {
+    if (g_error_matches (tmp_error, G_FILE_ERROR, G_FILE_ERROR_NOENT)) {
+      g_error_free (tmp_error);
+      return manifest;
+    }
+    g_propagate_error (error, tmp_error);
+    conversion_manifest_close (manifest, NULL);
+    return NULL;
+  }
+
+  lines = g_strsplit (contents, "\n", -1);
+  g_free (contents);
+
+  /* A manifest from some other version is ignored, and rewritten */
+  if (lines[0] != NULL && strcmp (lines[0], MANIFEST_VERSION) == 0)
+    for (i = 1; lines[i] != NULL; i++)
+      parse_manifest_line (manifest, lines[i]);
+
+  g_strfreev (lines);
+
+  return manifest;
+}
+
+/* Whether the resource was converted from an identical stream last time,
+ * and all the files it was converted into are still there.
+ */
+bool
+conversion_manifest_is_current (conversion_manifest *manifest, const char *resource, guint64 fingerprint)
+{
+  manifest_entry *entry;
+  bool current;
+  int i;
+
+  g_mutex_lock (&manifest->lock);
+
+  entry = g_hash_table_lookup (manifest->entries, resource);
+  if (entry != NULL)
+    entry->seen = true;
+  current = (entry != NULL && entry->fingerprint == fingerprint);
+
+  for (i = 0; current && entry->files[i] != NULL; i++) {
+    char *path = g_build_filename (manifest->output_dir, entry->files[i], NULL);
+    current = g_file_test (path, G_FILE_TEST_EXISTS);
+    g_free (path);
+  }
+
+  g_mutex_unlock (&manifest->lock);
+
+  return current;
+}
+
+/* Note the files a resource has just been converted into */
+void
+conversion_manifest_record (conversion_manifest *manifest, const char *resource, guint64 fingerprint,
+                            char **files)
+{
+  manifest_entry *entry;
+
+  entry = g_slice_new0 (manifest_entry);
+  entry->fingerprint = fingerprint;
+  entry->files = g_strdupv (files);
+  entry->seen = true;
+
+  g_mutex_lock (&manifest->lock);
+  g_hash_table_replace (manifest->entries, g_strdup (resource), entry);
+  manifest->dirty = true;
+  g_mutex_unlock (&manifest->lock);
+}
+
+/* Forget the resources which weren't seen this run, as they have gone
+ * from the library, and remove the files they were converted into. Only
+ * call this once the whole library has been converted, or the resources
+ * which merely failed this time would be lost too.
+ */
+void
+conversion_manifest_prune (conversion_manifest *manifest)
+{
+  GHashTableIter iter;
+  gpointer key, value;
+  GHashTable *kept;
+  int i;
+
+  g_mutex_lock (&manifest->lock);
+
+  /* Don't remove a file which something still there was converted into */
+  kept = g_hash_table_new (g_str_hash, g_str_equal);
+  g_hash_table_iter_init (&iter, manifest->entries);
+  while (g_hash_table_iter_next (&iter, &key, &value)) {
+    manifest_entry *entry = value;
+
+    if (entry->seen)
+      for (i = 0; entry->files[i] != NULL; i++)
+        g_hash_table_add (kept, entry->files[i]);
+  }
+
+  g_hash_table_iter_init (&iter, manifest->entries);
+  while (g_hash_table_iter_next (&iter, &key, &value)) {
+    manifest_entry *entry = value;
+
+    if (entry->seen)
+      continue;
+
+    log_info ("'%s' is no longer in the library, removing its output\n", (char *)key);
+
+    for (i = 0; entry->files[i] != NULL; i++) {
+      char *path;
+
+      if (g_hash_table_contains (kept, entry->files[i]))
+        continue;
+
+      path = g_build_filename (manifest->output_dir, entry->files[i], NULL);
+      g_unlink (path);
+      g_free (path);
+    }
+
+    g_hash_table_iter_remove (&iter);
+    manifest->dirty = true;
+  }
+
+  g_hash_table_unref (kept);
+
+  g_mutex_unlock (&manifest->lock);
+}
+
+static void
+append_escaped (GString *string, const char *field)
+{
+  char *escaped = g_strescape (field, NULL);
+  g_string_append_c (string, '\t');
+  g_string_append (string, escaped);
+  g_free (escaped);
+}
+
+static bool
+manifest_save (conversion_manifest *manifest, GError **error)
+{
+  GHashTableIter iter;
+  gpointer key, value;
+  GString *string;
+  bool ok;
+
+  string = g_string_new (MANIFEST_VERSION "\n");
+
+  g_hash_table_iter_init (&iter, manifest->entries);
+  while (g_hash_table_iter_next (&iter, &key, &value)) {
+    manifest_entry *entry = value;
+    int i;
+
+    g_string_append_printf (string, "%016" G_GINT64_MODIFIER "x", entry->fingerprint);
+    append_escaped (string, key);
+    for (i = 0; entry->files[i] != NULL; i++)
+      append_escaped (string, entry->files[i]);
+    g_string_append_c (string, '\n');
+  }
+
+  /* Written to a temporary file and renamed, so a run which is killed
+   * part way through can't leave a truncated manifest behind.
+   */
+  ok = g_file_set_contents (manifest->path, string->str, string->len, error);
+  g_string_free (string, TRUE);
+
+  return ok;
+}
+
+/* Write the manifest back out if anything was converted, and free it */
+bool
+conversion_manifest_close (conversion_manifest *manifest, GError **error)
+{
+  bool ok = true;
+
+  if (manifest == NULL)
+    return true;
+
+  if (manifest->dirty)
+    ok = manifest_save (manifest, error);
+
+  g_hash_table_unref (manifest->entries);
+  g_free (manifest->path);
+  g_free (manifest->output_dir);
+  g_mutex_clear (&manifest->lock);
+  g_slice_free (conversion_manifest, manifest);
+
+  return ok;
+}
@@ -0,0 +1,33 @@
+/*
+ *  openaltium is a set of tools for opening Altium (TM) library files
+ *  Copyright (C) 2016  Peter Clifton <Peter.Clifton@clifton-electronics.co.uk>
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 2.1 of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this library; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+
+/* Records which files each library resource was converted into, and a
+ * fingerprint of the stream they came from, so a later run into the same
+ * output directory can skip the resources which haven't changed.
+ */
+
+typedef struct conversion_manifest conversion_manifest;
+
+conversion_manifest *conversion_manifest_open (const char *output_dir, const char *library_name, GError **error);
+bool conversion_manifest_is_current (conversion_manifest *manifest, const char *resource, guint64 fingerprint);
+void conversion_manifest_record (conversion_manifest *manifest, const char *resource, guint64 fingerprint,
+                                 char **files);
+void conversion_manifest_prune (conversion_manifest *manifest);
+bool conversion_manifest_close (conversion_manifest *manifest, GError **error);
@@ -0,0 +1,211 @@
+/*
+ *  openaltium is a set of tools for opening Altium (TM) library files
+ *  Copyright (C) 2016  Peter Clifton <Peter.Clifton@clifton-electronics.co.uk>
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 2.1 of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this library; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <errno.h>
+#include <stdio.h>
+#include <string.h>
+#include <glib.h>
+#include <glib/gstdio.h>
+
+#include "openaltium-error.h"
+#include "model-cache.h"
+#include "logging.h"
+
+
+#define MODEL_CACHE_SUFFIX ".step"
+
+struct model_cache {
+  char *dir;
+  guint64 max_size;
+};
+
+typedef struct {
+  char *path;
+  guint64 size;
+  time_t mtime;
+} cache_entry;
+
+
+model_cache *
+model_cache_new (const char *dir, guint64 max_size, GError **error)
+{
+  model_cache *cache;
+
+  if (g_mkdir_with_parents (dir, 0755) != 0) {
+    int saved_errno = errno;
+    g_set_error (error, OPENALTIUM_ERROR, OPENALTIUM_ERROR_OUTPUT,
+                 "Couldn't create model cache %s: %s", dir, g_strerror (saved_errno));
+    return NULL;
+  }
+
+  cache = g_slice_new0 (model_cache);
+  cache->dir = g_strdup (dir);
+  cache->max_size = max_size;
+
+  return cache;
+}
+
+void
+model_cache_free (model_cache *cache)
+{
+  if (cache == NULL)
+    return;
+
+  g_free (cache->dir);
+  g_slice_free (model_cache, cache);
+}
+
+static char *
+cache_path (model_cache *cache, const char *digest)
+{
+  char *filename;
+  char *path;
+
+  filename = g_strconcat (digest, MODEL_CACHE_SUFFIX, NULL);
+  path = g_build_filename (cache->dir, filename, NULL);
+  g_free (filename);
+
+  return path;
+}
+
+/* Returns the path of the cached model, or NULL if it isn't cached. A hit
+ * refreshes the file's modification time, which is what eviction goes by.
+ */
+char *
+model_cache_lookup (model_cache *cache, const char *digest)
+{
+  char *path;
+
+  path = cache_path (cache, digest);
+
+  if (g_utime (path, NULL) != 0) {
+    g_free (path);
+    return NULL;
+  }
+
+  log_trace ("Model cache hit %s\n", path);
+  return path;
+}
+
+/* Create an empty file in the cache to inflate a model into, before it is
+ * committed. Being in the same directory, committing is an atomic rename.
+ */
+char *
+model_cache_new_temp (model_cache *cache, GError **error)
+{
+  char *path;
+  int fd;
+
+  path = g_build_filename (cache->dir, "incoming-XXXXXX", NULL);
+  fd = g_mkstemp (path);
+  if (fd < 0) {
+    int saved_errno = errno;
+    g_set_error (error, OPENALTIUM_ERROR, OPENALTIUM_ERROR_OUTPUT,
+                 "Couldn't create file in model cache %s: %s", cache->dir, g_strerror (saved_errno));
+    g_free (path);
+    return NULL;
+  }
+  g_close (fd, NULL);
+
+  return path;
+}
+
+/* File a newly inflated model under its digest, returning its cache path */
+char *
+model_cache_commit (model_cache *cache, const char *temp_path, const char *digest, GError **error)
+{
+  char *path;
+
+  path = cache_path (cache, digest);
+
+  if (g_rename (temp_path, path) != 0) {
+    int saved_errno = errno;
+    g_set_error (error, OPENALTIUM_ERROR, OPENALTIUM_ERROR_OUTPUT,
+                 "Couldn't add %s to model cache: %s", path, g_strerror (saved_errno));
+    g_unlink (temp_path);
+    g_free (path);
+    return NULL;
+  }
+
+  return path;
+}
+
+static gint
+compare_entry_mtime (gconstpointer a, gconstpointer b)
+{
+  const cache_entry *entry_a = a;
+  const cache_entry *entry_b = b;
+
+  return (entry_a->mtime > entry_b->mtime) - (entry_a->mtime < entry_b->mtime);
+}
+
+/* Evict the least recently used models until the cache fits its limit */
+void
+model_cache_trim (model_cache *cache)
+{
+  GArray *entries;
+  const char *name;
+  guint64 total = 0;
+  GDir *dir;
+  int i;
+
+  dir = g_dir_open (cache->dir, 0, NULL);
+  if (dir == NULL)
+    return;
+
+  entries = g_array_new (FALSE, FALSE, sizeof (cache_entry));
+
+  while ((name = g_dir_read_name (dir)) != NULL) {
+    cache_entry entry;
+    GStatBuf buf;
+
+    if (!g_str_has_suffix (name, MODEL_CACHE_SUFFIX))
+      continue;
+
+    entry.path = g_build_filename (cache->dir, name, NULL);
+    if (g_stat (entry.path, &buf) != 0) {
+      g_free (entry.path);
+      continue;
+    }
+
+    entry.size = buf.st_size;
+    entry.mtime = buf.st_mtime;
+    total += entry.size;
+    g_array_append_val (entries, entry);
+  }
+
+  g_dir_close (dir);
+
+  g_array_sort (entries, compare_entry_mtime);
+
+  for (i = 0; i < entries->len; i++) {
+    cache_entry *entry = &g_array_index (entries, cache_entry, i);
+
+    if (total > cache->max_size && g_unlink (entry->path) == 0) {
+      log_trace ("Evicted %s from model cache\n", entry->path);
+      total -= entry->size;
+    }
+
+    g_free (entry->path);
+  }
+
+  g_array_free (entries, TRUE);
+}
@@ -0,0 +1,37 @@
+/*
+ *  openaltium is a set of tools for opening Altium (TM) library files
+ *  Copyright (C) 2016  Peter Clifton <Peter.Clifton@clifton-electronics.co.uk>
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 2.1 of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this library; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+
+/* On-disk cache of inflated models, shared between conversion runs. Models
+ * are filed under a hash of their compressed stream, and the least
+ * recently used are evicted to keep the cache under its size limit.
+ *
+ * All the state lives in the filesystem, so a cache may be used from
+ * several threads (or processes) at once.
+ */
+
+typedef struct model_cache model_cache;
+
+model_cache *model_cache_new (const char *dir, guint64 max_size, GError **error);
+void model_cache_free (model_cache *cache);
+
+char *model_cache_lookup (model_cache *cache, const char *digest);
+char *model_cache_new_temp (model_cache *cache, GError **error);
+char *model_cache_commit (model_cache *cache, const char *temp_path, const char *digest, GError **error);
+void model_cache_trim (model_cache *cache);
@@ -0,0 +1,387 @@
+/*
+ *  openaltium is a set of tools for opening Altium (TM) library files
+ *  Copyright (C) 2016  Peter Clifton <Peter.Clifton@clifton-electronics.co.uk>
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 2.1 of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this library; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <string.h>
+#include <glib.h>
+#include <glib/gstdio.h>
+#include <gio/gio.h>
+#ifdef G_OS_UNIX
+#include <unistd.h>
+#endif
+
+#include "arena.h"
+#include "parameters.h"
+#include "models.h"
+#include "model-cache.h"
+#include "model-extract.h"
+#include "logging.h"
+#include "stats.h"
+
+
+/* One distinct compressed model, possibly shared by several models */
+typedef struct {
+  GBytes *step;
+  char *digest;                 /* Hash of the stream, only computed when needed */
+  model_cache *cache;           /* Shared cache of inflated models, or NULL */
+  GMutex lock;                  /* Held while the body is being written out */
+  char *written_path;           /* Where it was first inflated to, NULL until then */
+} model_body;
+
+typedef struct extract_job extract_job;
+struct extract_job {
+  model_info *info;
+  model_body *body;
+  extract_job *claimant;        /* Job for another body which owns our path, or NULL */
+  bool done;                    /* Protected by body->lock */
+  GError *error;
+};
+
+struct model_extractor {
+  bool lazy;                    /* Only extract models when they are referenced */
+  model_cache *cache;           /* Shared cache of inflated models, or NULL */
+  GThreadPool *pool;            /* NULL to inflate on the calling thread */
+  GPtrArray *jobs;
+  GPtrArray *bodies;
+  GHashTable *by_info;          /* model_info -> job, read only once models are added */
+  GHashTable *by_checksum;      /* CHECKSUM -> GSList of bodies */
+  GHashTable *by_path;          /* Output path -> job writing it */
+};
+
+
+static bool
+inflate_to_file (GBytes *step, const char *file, GError **error)
+{
+  GZlibDecompressor *decomp;
+  GFile *gfile;
+  GFileOutputStream *file_os;
+  GOutputStream *decomp_os;
+  gsize bytes_written;
+  gconstpointer data;
+  gsize length;
+  gint64 start = stats_begin ();
+  bool ok;
+
+  gfile = g_file_new_for_path (file);
+  file_os = g_file_replace (gfile, NULL, FALSE, G_FILE_CREATE_NONE, NULL, error);
+  g_object_unref (gfile);
+  if (file_os == NULL)
+    return false;
+
+  decomp = g_zlib_decompressor_new (G_ZLIB_COMPRESSOR_FORMAT_ZLIB);
+  decomp_os = g_converter_output_stream_new (G_OUTPUT_STREAM (file_os), G_CONVERTER (decomp));
+
+  data = g_bytes_get_data (step, &length);
+  ok = g_output_stream_write_all (decomp_os, data, length, &bytes_written, NULL, error) &&
+       g_output_stream_close (decomp_os, NULL, error);
+  g_output_stream_close (G_OUTPUT_STREAM (file_os), NULL, NULL);
+
+  g_object_unref (decomp_os);
+  g_object_unref (file_os);
+  g_object_unref (decomp);
+
+  stats_end (STATS_INFLATE, start, length);
+
+  return ok;
+}
+
+static const char *
+model_body_digest (model_body *body)
+{
+  if (body->digest == NULL)
+    body->digest = g_compute_checksum_for_bytes (G_CHECKSUM_SHA256, body->step);
+
+  return body->digest;
+}
+
+/* Fetch the model from the cache, inflating it into the cache first if
+ * no earlier run has.
+ */
+static bool
+inflate_through_cache (model_body *body, const char *file, GError **error)
+{
+  char *cached;
+  bool ok;
+
+  cached = model_cache_lookup (body->cache, model_body_digest (body));
+
+  if (cached == NULL) {
+    char *temp = model_cache_new_temp (body->cache, error);
+    if (temp == NULL)
+      return false;
+
+    if (!inflate_to_file (body->step, temp, error)) {
+      g_unlink (temp);
+      g_free (temp);
+      return false;
+    }
+
+    cached = model_cache_commit (body->cache, temp, model_body_digest (body), error);
+    g_free (temp);
+    if (cached == NULL)
+      return false;
+  }
+
+  ok = model_link_or_copy (cached, file, error);
+  g_free (cached);
+
+  return ok;
+}
+
+/* Put a model's file in place, if that hasn't been done already. The
+ * first model needing a body inflates it, later ones link to that file.
+ */
+static bool
+extract_job_run (extract_job *job)
+{
+  model_body *body = job->body;
+  bool ok;
+
+  if (job->claimant != NULL)
+    return extract_job_run (job->claimant);
+
+  g_mutex_lock (&body->lock);
+
+  if (!job->done) {
+    if (body->written_path == NULL) {
+      log_trace ("Inflating model '%s' to %s\n", job->info->id, job->info->path);
+      if (body->cache != NULL)
+        ok = inflate_through_cache (body, job->info->path, &job->error);
+      else
+        ok = inflate_to_file (body->step, job->info->path, &job->error);
+      if (ok)
+        body->written_path = job->info->path;
+    } else if (strcmp (body->written_path, job->info->path) != 0) {
+      log_trace ("Linking duplicate model '%s' to %s\n", job->info->id, body->written_path);
+      model_link_or_copy (body->written_path, job->info->path, &job->error);
+    }
+    job->done = true;
+  }
+
+  ok = (job->error == NULL);
+
+  g_mutex_unlock (&body->lock);
+
+  return ok;
+}
+
+static void
+extract_job_pool_func (gpointer data, gpointer user_data)
+{
+  extract_job_run (data);
+}
+
+static void
+extract_job_free (extract_job *job)
+{
+  if (job->error != NULL)
+    g_error_free (job->error);
+  g_slice_free (extract_job, job);
+}
+
+static void
+model_body_free (model_body *body)
+{
+  g_bytes_unref (body->step);
+  g_free (body->digest);
+  g_mutex_clear (&body->lock);
+  g_slice_free (model_body, body);
+}
+
+static bool
+same_stream (model_body *a, model_body *b)
+{
+  return g_bytes_get_size (a->step) == g_bytes_get_size (b->step) &&
+         strcmp (model_body_digest (a), model_body_digest (b)) == 0;
+}
+
+/* With lazy set, models are only inflated when model_extractor_require ()
+ * asks for them, otherwise all of them are, on a pool of jobs threads.
+ */
+model_extractor *
+model_extractor_new (int jobs, bool lazy, model_cache *cache, GError **error)
+{
+  model_extractor *extractor;
+
+  extractor = g_slice_new0 (model_extractor);
+  extractor->lazy = lazy;
+  extractor->cache = cache;
+
+  if (!lazy && jobs > 1) {
+    extractor->pool = g_thread_pool_new (extract_job_pool_func, NULL, jobs, TRUE, error);
+    if (extractor->pool == NULL) {
+      g_slice_free (model_extractor, extractor);
+      return NULL;
+    }
+  }
+
+  extractor->jobs = g_ptr_array_new_with_free_func ((GDestroyNotify) extract_job_free);
+  extractor->bodies = g_ptr_array_new_with_free_func ((GDestroyNotify) model_body_free);
+  extractor->by_info = g_hash_table_new (g_direct_hash, g_direct_equal);
+  extractor->by_checksum = g_hash_table_new_full (g_direct_hash, g_direct_equal,
+                                                  NULL, (GDestroyNotify) g_slist_free);
+  extractor->by_path = g_hash_table_new (g_str_hash, g_str_equal);
+
+  return extractor;
+}
+
+/* Register a model to be extracted to info->path. The CHECKSUM recorded
+ * for each model picks out likely duplicates, which are then confirmed by
+ * hashing the compressed streams.
+ */
+void
+model_extractor_add (model_extractor *extractor, model_info *info, GBytes *step)
+{
+  gpointer key = GINT_TO_POINTER (info->checksum);
+  model_body *body = NULL;
+  model_body *candidate;
+  extract_job *job;
+  GSList *candidates;
+  GSList *iter;
+
+  candidate = g_slice_new0 (model_body);
+  candidate->step = g_bytes_ref (step);
+  candidate->cache = extractor->cache;
+
+  candidates = g_hash_table_lookup (extractor->by_checksum, key);
+  for (iter = candidates; iter != NULL; iter = g_slist_next (iter)) {
+    if (same_stream (candidate, iter->data)) {
+      body = iter->data;
+      log_trace ("Model '%s' has the same body as an earlier model\n", info->id);
+      break;
+    }
+  }
+
+  if (body == NULL) {
+    body = candidate;
+    g_mutex_init (&body->lock);
+    /* Hash now, so worker threads never race to fill it in */
+    if (body->cache != NULL)
+      model_body_digest (body);
+    g_ptr_array_add (extractor->bodies, body);
+    g_hash_table_steal (extractor->by_checksum, key);
+    g_hash_table_insert (extractor->by_checksum, key, g_slist_prepend (candidates, body));
+  } else {
+    g_bytes_unref (candidate->step);
+    g_free (candidate->digest);
+    g_slice_free (model_body, candidate);
+  }
+
+  job = g_slice_new0 (extract_job);
+  job->info = info;
+  job->body = body;
+  g_ptr_array_add (extractor->jobs, job);
+  g_hash_table_insert (extractor->by_info, info, job);
+
+  job->claimant = g_hash_table_lookup (extractor->by_path, info->path);
+  if (job->claimant != NULL && job->claimant->body != body) {
+    fprintf (stdout, "Warning: More than one model extracts to %s, keeping the first\n", info->path);
+    return;
+  }
+  job->claimant = NULL;
+
+  if (!g_hash_table_contains (extractor->by_path, info->path))
+    g_hash_table_insert (extractor->by_path, info->path, job);
+
+  if (extractor->lazy)
+    return;
+
+  if (extractor->pool != NULL)
+    g_thread_pool_push (extractor->pool, job, NULL);
+  else
+    extract_job_run (job);
+}
+
+/* Make sure a model's file exists, extracting it if need be. Safe to call
+ * from several threads at once, once all the models have been added.
+ */
+bool
+model_extractor_require (model_extractor *extractor, model_info *info)
+{
+  extract_job *job;
+
+  job = g_hash_table_lookup (extractor->by_info, info);
+  if (job == NULL)
+    return false;
+
+  return extract_job_run (job);
+}
+
+/* Wait for any queued models, and report the first which failed */
+bool
+model_extractor_finish (model_extractor *extractor, GError **error)
+{
+  bool ok = true;
+  int i;
+
+  if (extractor->pool != NULL)
+    g_thread_pool_free (extractor->pool, FALSE, TRUE);
+
+  for (i = 0; i < extractor->jobs->len; i++) {
+    extract_job *job = g_ptr_array_index (extractor->jobs, i);
+
+    if (job->error == NULL)
+      continue;
+
+    if (ok) {
+      g_propagate_error (error, job->error);
+      job->error = NULL;
+      ok = false;
+    } else {
+      fprintf (stdout, "Error: %s\n", job->error->message);
+    }
+  }
+
+  g_hash_table_unref (extractor->by_path);
+  g_hash_table_unref (extractor->by_checksum);
+  g_hash_table_unref (extractor->by_info);
+  g_ptr_array_unref (extractor->jobs);
+  g_ptr_array_unref (extractor->bodies);
+  g_slice_free (model_extractor, extractor);
+
+  return ok;
+}
+
+/* Make dest a hard link to source, falling back to a copy where links
+ * aren't possible, e.g. across filesystems.
+ */
+bool
+model_link_or_copy (const char *source, const char *dest, GError **error)
+{
+  GFile *from;
+  GFile *to;
+  bool ok;
+
+  g_unlink (dest);
+
+#ifdef G_OS_UNIX
+  if (link (source, dest) == 0)
+    return true;
+#endif
+
+  from = g_file_new_for_path (source);
+  to = g_file_new_for_path (dest);
+  ok = g_file_copy (from, to, G_FILE_COPY_OVERWRITE, NULL, NULL, NULL, error);
+  g_object_unref (from);
+  g_object_unref (to);
+
+  return ok;
+}
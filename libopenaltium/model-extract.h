@@ -0,0 +1,34 @@
+/*
+ *  openaltium is a set of tools for opening Altium (TM) library files
+ *  Copyright (C) 2016  Peter Clifton <Peter.Clifton@clifton-electronics.co.uk>
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 2.1 of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this library; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+
+/* Inflates a library's embedded STEP models to disk, either all up front
+ * or lazily as footprints reference them. Models whose compressed streams
+ * are identical are only inflated once, the other copies being hard links
+ * to (or copies of) the first.
+ */
+
+/* NB: model_extractor is declared in models.h */
+
+model_extractor *model_extractor_new (int jobs, bool lazy, model_cache *cache, GError **error);
+void model_extractor_add (model_extractor *extractor, model_info *info, GBytes *step);
+bool model_extractor_require (model_extractor *extractor, model_info *info);
+bool model_extractor_finish (model_extractor *extractor, GError **error);
+
+bool model_link_or_copy (const char *source, const char *dest, GError **error);
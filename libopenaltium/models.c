@@ -21,26 +21,32 @@
 #include <stdbool.h>
 #include <glib.h>
 #include <math.h>
+#include <string.h>
 
+#include "arena.h"
 #include "parameters.h"
 #include "models.h"
+#include "model-cache.h"
+#include "model-extract.h"
 
 
 struct model_map {
   GHashTable *hash;
+  model_extractor *extractor;   /* Extracts models as they are found, or NULL */
 };
 
 
+/* The model's strings are copied into arena, along with the model */
 model_info *
-model_info_new_from_parameters (const parameter_list *list)
+model_info_new_from_parameters (arena *arena, const parameter_list *list)
 {
   model_info *info;
-  char **path_parts;
-  int i;
+  const char *name;
+  const char *basename;
 
-  info = g_slice_new0 (model_info);
+  info = arena_new_struct (arena, model_info);
 
-  info->id =       parameter_list_get_string (list, "ID");
+  info->id =       arena_strdup (arena, parameter_list_peek_string (list, "ID"));
   info->rotx =     parameter_list_get_double (list, "ROTX");
   info->roty =     parameter_list_get_double (list, "ROTY");
   info->rotz =     parameter_list_get_double (list, "ROTZ");
@@ -52,7 +58,6 @@ model_info_new_from_parameters (const parameter_list *list)
   info->dz =    parameter_list_get_int (list, "DZ"); /* XXX: FIX dimension routine */
   info->checksum =    parameter_list_get_int (list, "CHECKSUM");
   info->embed =      parameter_list_get_bool (list, "EMBED");
-  info->filename = parameter_list_get_string (list, "NAME");
 
   /* To assist debugigng with multiple rotation angles - help to pick them out! */
   if (fabs (info->rotx - 360.) < 0.01) info->rotx = 0.;
@@ -60,25 +65,13 @@ model_info_new_from_parameters (const parameter_list *list)
   if (fabs (info->rotz - 360.) < 0.01) info->rotz = 0.;
 
   /* Rationalise filenames which are absolute (windows) paths! */
-  path_parts = g_strsplit (info->filename, "\\", 0);
-  g_free (info->filename);
-
-  for (i = 0; path_parts[i + 1] != NULL; i++); /* i will be the last index when this completes */
-  info->filename = g_strdup (path_parts[i]);
-
-  g_strfreev (path_parts);
+  name = parameter_list_peek_string (list, "NAME");
+  basename = strrchr (name, '\\');
+  info->filename = arena_strdup (arena, (basename != NULL) ? basename + 1 : name);
 
   return info;
 }
 
-void
-model_info_free (model_info *info)
-{
-  g_free (info->id);
-  g_free (info->filename);
-  g_slice_free (model_info, info);
-}
-
 model_map *
 model_map_new ()
 {
@@ -87,8 +80,8 @@ model_map_new ()
   map = g_slice_new0 (model_map);
   map->hash = g_hash_table_new_full ((GHashFunc) g_str_hash,
                                      (GEqualFunc) g_str_equal,
-                                     NULL, /* NB: DONT FREE THE KEY, SINCE IT IS PART OF THE VALUE */
-                                     NULL); // XXX: STILL NOT GOOD ENOUGH, IT USE-AFTER-FREE's THE KEY (GDestroyNotify) model_info_free);
+                                     NULL,  /* NB: The models and their ids */
+                                     NULL); /*     belong to the library's arena */
 
   return map;
 }
@@ -103,6 +96,13 @@ model_map_free (model_map *map)
   g_slice_free (model_map, map);
 }
 
+/* Have model files put in place the first time each model is looked up */
+void
+model_map_set_extractor (model_map *map, model_extractor *extractor)
+{
+  map->extractor = extractor;
+}
+
 void
 model_map_insert (model_map *map, model_info *info)
 {
@@ -111,8 +111,22 @@ model_map_insert (model_map *map, model_info *info)
   g_hash_table_insert (map->hash, info->id, info);
 }
 
+/* NB: Lookups don't modify the map, so once it is fully populated any
+ *     number of threads may search it at once. The model's file is
+ *     extracted before it is returned, if that hasn't happened yet.
+ */
 model_info *
-model_map_find_by_id (model_map *map, char *id)
+model_map_find_by_id (const model_map *map, const char *id)
 {
-  return g_hash_table_lookup (map->hash, id);
+  model_info *info;
+
+  if (map == NULL)
+    return NULL;
+
+  info = g_hash_table_lookup (map->hash, id);
+
+  if (info != NULL && map->extractor != NULL)
+    model_extractor_require (map->extractor, info);
+
+  return info;
 }
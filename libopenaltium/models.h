@@ -30,14 +30,16 @@ struct model_info {
   int checksum;
   bool embed;
   char *filename;
+  char *path;           /* Where the model is extracted to, or NULL */
 };
 
 
-model_info *model_info_new_from_parameters (const parameter_list *parameters);
-void model_info_free (model_info *info);
+model_info *model_info_new_from_parameters (arena *arena, const parameter_list *parameters);
 
 typedef struct model_map  model_map;
+typedef struct model_extractor model_extractor;
 model_map *model_map_new ();
 void model_map_insert (model_map *map, model_info *info);
 void model_map_free (model_map *map);
-model_info *model_map_find_by_id (model_map *map, char *id);
+void model_map_set_extractor (model_map *map, model_extractor *extractor);
+model_info *model_map_find_by_id (const model_map *map, const char *id);
@@ -0,0 +1,30 @@
+/*
+ *  openaltium is a set of tools for opening Altium (TM) library files
+ *  Copyright (C) 2016  Peter Clifton <Peter.Clifton@clifton-electronics.co.uk>
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 2.1 of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this library; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+
+#define OPENALTIUM_ERROR openaltium_error_quark ()
+
+typedef enum {
+  OPENALTIUM_ERROR_OPEN,        /* The library file could not be opened */
+  OPENALTIUM_ERROR_FORMAT,      /* The library contents were missing or malformed */
+  OPENALTIUM_ERROR_OUTPUT,      /* A converted file could not be written */
+  OPENALTIUM_ERROR_UNSUPPORTED, /* The file type is not (yet) handled */
+} openaltium_error;
+
+GQuark openaltium_error_quark (void);
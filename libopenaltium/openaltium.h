@@ -0,0 +1,50 @@
+/*
+ *  openaltium is a set of tools for opening Altium (TM) library files
+ *  Copyright (C) 2016  Peter Clifton <Peter.Clifton@clifton-electronics.co.uk>
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 2.1 of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this library; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+
+/* The public interface of libopenaltium. The library's other headers
+ * expect their dependencies to be included first, so applications
+ * include this one instead.
+ *
+ * Conversions report failure through their return value and a GError in
+ * the OPENALTIUM_ERROR domain, and never exit the process. A footprint or
+ * symbol which can't be decoded is skipped and reported, the rest of its
+ * library is still converted. Independent conversions may run on
+ * different threads at once.
+ */
+
+#ifndef OPENALTIUM_H
+#define OPENALTIUM_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <glib.h>
+
+G_BEGIN_DECLS
+
+#include "openaltium-error.h"
+#include "options.h"
+#include "pcblib.h"
+#include "schlib.h"
+#include "intlib.h"
+#include "batch.h"
+
+G_END_DECLS
+
+#endif /* OPENALTIUM_H */
@@ -0,0 +1,145 @@
+/*
+ *  openaltium is a set of tools for opening Altium (TM) library files
+ *  Copyright (C) 2016  Peter Clifton <Peter.Clifton@clifton-electronics.co.uk>
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 2.1 of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this library; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include <stdbool.h>
+#include <stdio.h>
+#include <glib.h>
+
+#include "raw-archive.h"
+#include "manifest.h"
+#include "output-writer.h"
+#include "options.h"
+#include "openaltium-error.h"
+
+
+/* Returns the newly allocated path a converted file should be written to.
+ * NB: Conversions never chdir (), so they can run side by side in threads.
+ */
+char *
+conversion_output_path (const conversion_options *options, const char *filename)
+{
+  if (options == NULL || options->output_dir == NULL)
+    return g_strdup (filename);
+
+  return g_build_filename (options->output_dir, filename, NULL);
+}
+
+/* Open a converted file for writing in the output directory */
+output_writer *
+conversion_open_writer (const conversion_options *options, const char *filename, GError **error)
+{
+  output_writer *writer;
+  char *path;
+
+  path = conversion_output_path (options, filename);
+  writer = output_writer_open (path, error);
+  g_free (path);
+
+  return writer;
+}
+
+/* Start the raw stream archive for a library, if raw dumps were asked for.
+ * The archive is named after the library, e.g. "foo/bar" -> "foo/bar.tar".
+ */
+bool
+conversion_open_raw_dump (conversion_options *options, const char *library_name, GError **error)
+{
+  char *filename;
+  char *path;
+  char *dir;
+
+  options->raw_dump = NULL;
+  if (options->dump_raw_dir == NULL)
+    return true;
+
+  filename = g_strdup_printf ("%s.tar", library_name);
+  path = g_build_filename (options->dump_raw_dir, filename, NULL);
+  g_free (filename);
+
+  dir = g_path_get_dirname (path);
+  g_mkdir_with_parents (dir, 0755);
+  g_free (dir);
+
+  options->raw_dump = raw_archive_open (path, error);
+  g_free (path);
+
+  return options->raw_dump != NULL;
+}
+
+bool
+conversion_close_raw_dump (conversion_options *options, GError **error)
+{
+  raw_archive *archive = options->raw_dump;
+
+  options->raw_dump = NULL;
+  if (archive == NULL)
+    return true;
+
+  return raw_archive_close (archive, error);
+}
+
+/* Load the library's manifest in the output directory, if converting
+ * incrementally. It is named after the library's filename, e.g.
+ * "foo/Bar.PcbLib" -> ".openaltium-manifest-Bar.PcbLib".
+ */
+bool
+conversion_open_manifest (conversion_options *options, const char *library_name, GError **error)
+{
+  char *basename;
+
+  options->manifest = NULL;
+  if (!options->incremental)
+    return true;
+
+  basename = g_path_get_basename (library_name);
+  options->manifest = conversion_manifest_open (options->output_dir, basename, error);
+  g_free (basename);
+
+  return options->manifest != NULL;
+}
+
+bool
+conversion_close_manifest (conversion_options *options, GError **error)
+{
+  conversion_manifest *manifest = options->manifest;
+
+  options->manifest = NULL;
+
+  return conversion_manifest_close (manifest, error);
+}
+
+/* Save a raw stream for debugging, if raw dumps were asked for */
+void
+conversion_dump_raw (const conversion_options *options, const char *name,
+                     const char *data, gsize length)
+{
+  char *path;
+
+  if (options->raw_dump == NULL)
+    return;
+
+  if (options->raw_dump_prefix == NULL) {
+    raw_archive_add (options->raw_dump, name, data, length);
+    return;
+  }
+
+  path = g_strconcat (options->raw_dump_prefix, "/", name, NULL);
+  raw_archive_add (options->raw_dump, path, data, length);
+  g_free (path);
+}
@@ -0,0 +1,44 @@
+/*
+ *  openaltium is a set of tools for opening Altium (TM) library files
+ *  Copyright (C) 2016  Peter Clifton <Peter.Clifton@clifton-electronics.co.uk>
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 2.1 of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this library; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+
+/* Settings shared by everything involved in converting one library */
+typedef struct {
+  bool use_mmap;        /* Read SchLib and IntLib streams in place from a memory-mapped file */
+  char *output_dir;     /* Where converted files are written, NULL for the current directory */
+  bool all_models;      /* Extract every embedded model, not just those footprints use */
+  guint32 record_types; /* Mask of the footprint record types to convert, 0 for all */
+  int library_jobs;     /* Threads working within one library (footprints, models), 0 or 1 for none */
+  char *dump_raw_dir;   /* Where to archive each library's raw streams, NULL to not dump them */
+  struct raw_archive *raw_dump; /* The archive for the library being converted */
+  char *raw_dump_prefix; /* Directory within the archive its streams go in, NULL for the top */
+  struct model_cache *model_cache; /* Inflated models kept between runs, NULL for none */
+  bool incremental;     /* Skip resources unchanged since the last conversion into output_dir */
+  struct conversion_manifest *manifest; /* What output_dir was last converted from, for this library */
+  char *decode_cache_dir; /* Where decoded libraries are cached between runs, NULL for none */
+} conversion_options;
+
+char *conversion_output_path (const conversion_options *options, const char *filename);
+struct output_writer *conversion_open_writer (const conversion_options *options, const char *filename, GError **error);
+bool conversion_open_raw_dump (conversion_options *options, const char *library_name, GError **error);
+bool conversion_close_raw_dump (conversion_options *options, GError **error);
+bool conversion_open_manifest (conversion_options *options, const char *library_name, GError **error);
+bool conversion_close_manifest (conversion_options *options, GError **error);
+void conversion_dump_raw (const conversion_options *options, const char *name,
+                          const char *data, gsize length);
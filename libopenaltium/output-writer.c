@@ -0,0 +1,224 @@
+/*
+ *  openaltium is a set of tools for opening Altium (TM) library files
+ *  Copyright (C) 2016  Peter Clifton <Peter.Clifton@clifton-electronics.co.uk>
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 2.1 of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this library; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <errno.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <string.h>
+#include <glib.h>
+#include <glib/gstdio.h>
+
+#include "openaltium-error.h"
+#include "output-writer.h"
+
+
+#define OUTPUT_WRITER_BUFFER_SIZE (64 * 1024)
+
+/* Longest formatted coordinate, "-214748.36mil" */
+#define COORD_MAX_LENGTH 16
+
+struct output_writer {
+  FILE *file;
+  char *filename;
+  gsize used;
+  bool write_failed;
+  char buffer[OUTPUT_WRITER_BUFFER_SIZE];
+};
+
+
+output_writer *
+output_writer_open (const char *filename, GError **error)
+{
+  output_writer *writer;
+  FILE *file;
+
+  file = g_fopen (filename, "w");
+  if (file == NULL) {
+    int saved_errno = errno;
+    g_set_error (error, OPENALTIUM_ERROR, OPENALTIUM_ERROR_OUTPUT,
+                 "Error opening output file %s: %s", filename, g_strerror (saved_errno));
+    return NULL;
+  }
+
+  /* We do our own buffering */
+  setvbuf (file, NULL, _IONBF, 0);
+
+  writer = g_new (output_writer, 1);
+  writer->file = file;
+  writer->filename = g_strdup (filename);
+  writer->used = 0;
+  writer->write_failed = false;
+
+  return writer;
+}
+
+static void
+output_flush (output_writer *writer)
+{
+  if (writer->used == 0)
+    return;
+
+  if (fwrite (writer->buffer, 1, writer->used, writer->file) != writer->used)
+    writer->write_failed = true;
+
+  writer->used = 0;
+}
+
+bool
+output_writer_close (output_writer *writer, GError **error)
+{
+  bool ok;
+
+  output_flush (writer);
+  ok = (fclose (writer->file) == 0) && !writer->write_failed;
+
+  if (!ok)
+    g_set_error (error, OPENALTIUM_ERROR, OPENALTIUM_ERROR_OUTPUT,
+                 "Error writing output file %s", writer->filename);
+
+  g_free (writer->filename);
+  g_free (writer);
+
+  return ok;
+}
+
+void
+output_write (output_writer *writer, const char *data, gsize length)
+{
+  if (writer->used + length > OUTPUT_WRITER_BUFFER_SIZE) {
+    output_flush (writer);
+
+    /* Too big to be worth buffering */
+    if (length > OUTPUT_WRITER_BUFFER_SIZE) {
+      if (fwrite (data, 1, length, writer->file) != length)
+        writer->write_failed = true;
+      return;
+    }
+  }
+
+  memcpy (writer->buffer + writer->used, data, length);
+  writer->used += length;
+}
+
+void
+output_puts (output_writer *writer, const char *string)
+{
+  output_write (writer, string, strlen (string));
+}
+
+void
+output_putc (output_writer *writer, char c)
+{
+  if (writer->used == OUTPUT_WRITER_BUFFER_SIZE)
+    output_flush (writer);
+
+  writer->buffer[writer->used++] = c;
+}
+
+void
+output_printf (output_writer *writer, const char *format, ...)
+{
+  gsize space = OUTPUT_WRITER_BUFFER_SIZE - writer->used;
+  va_list args;
+  int length;
+
+  /* Format straight into the buffer, and only if it didn't fit, make room */
+  va_start (args, format);
+  length = g_vsnprintf (writer->buffer + writer->used, space, format, args);
+  va_end (args);
+
+  if (length < 0)
+    return;
+
+  if (length < space) {
+    writer->used += length;
+    return;
+  }
+
+  output_flush (writer);
+
+  va_start (args, format);
+  if (length < OUTPUT_WRITER_BUFFER_SIZE) {
+    g_vsnprintf (writer->buffer, OUTPUT_WRITER_BUFFER_SIZE, format, args);
+    writer->used = length;
+  } else {
+    char *string = g_strdup_vprintf (format, args);
+    output_write (writer, string, length);
+    g_free (string);
+  }
+  va_end (args);
+}
+
+/* Format an Altium coordinate (1/10000 mil) to two decimal places of a
+ * mil, returning the length written (no terminator). This matches the
+ * old fprintf ("%.2fmil", coord / 10000.) output, including "-0.00mil"
+ * for small negative values.
+ */
+int
+format_coord (char *buffer, int32_t coord)
+{
+  char digits[12];
+  uint32_t magnitude;
+  uint32_t hundredths;
+  uint32_t whole;
+  uint32_t fraction;
+  char *p = buffer;
+  int n = 0;
+
+  magnitude = (coord < 0) ? -(uint32_t)coord : (uint32_t)coord;
+
+  /* Exact ties round according to the nearest double, leave them to libc */
+  if (magnitude % 100 == 50)
+    return g_snprintf (buffer, COORD_MAX_LENGTH, "%.2fmil", (double)coord / 10000.);
+
+  hundredths = (magnitude + 50) / 100;
+  whole = hundredths / 100;
+  fraction = hundredths % 100;
+
+  if (coord < 0)
+    *p++ = '-';
+
+  do {
+    digits[n++] = '0' + whole % 10;
+    whole /= 10;
+  } while (whole != 0);
+
+  while (n > 0)
+    *p++ = digits[--n];
+
+  *p++ = '.';
+  *p++ = '0' + fraction / 10;
+  *p++ = '0' + fraction % 10;
+
+  memcpy (p, "mil", 3);
+  p += 3;
+
+  return p - buffer;
+}
+
+void
+output_coord (output_writer *writer, int32_t coord)
+{
+  if (writer->used + COORD_MAX_LENGTH > OUTPUT_WRITER_BUFFER_SIZE)
+    output_flush (writer);
+
+  writer->used += format_coord (writer->buffer + writer->used, coord);
+}
@@ -0,0 +1,38 @@
+/*
+ *  openaltium is a set of tools for opening Altium (TM) library files
+ *  Copyright (C) 2016  Peter Clifton <Peter.Clifton@clifton-electronics.co.uk>
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 2.1 of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this library; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+
+/* Buffered writer for the converted .fp / .sym files. Output collects in
+ * a large buffer inside the writer and is handed to stdio in big chunks,
+ * so emitting a field is little more than a memcpy.
+ */
+
+typedef struct output_writer output_writer;
+
+output_writer *output_writer_open (const char *filename, GError **error);
+bool output_writer_close (output_writer *writer, GError **error);
+
+void output_write (output_writer *writer, const char *data, gsize length);
+void output_puts (output_writer *writer, const char *string);
+void output_putc (output_writer *writer, char c);
+void output_printf (output_writer *writer, const char *format, ...) G_GNUC_PRINTF (2, 3);
+
+/* Altium 1/10000 mil units, written as "%.2fmil" would */
+void output_coord (output_writer *writer, int32_t coord);
+int format_coord (char *buffer, int32_t coord);
@@ -22,79 +22,231 @@
 #include <stdlib.h>
 #include <string.h>
 #include <glib.h>
+#include <math.h>
 
+#include "arena.h"
 #include "parameters.h"
 
+/* The source string is copied once into the same allocation as an open
+ * addressed hash table of (key, value) pointers into that copy. Separators
+ * in the copy are overwritten with NULs, so every key and value can be
+ * handed out as a plain C string without further allocation. Values are
+ * only checked for valid UTF-8 when they are read.
+ */
+
+typedef struct {
+  const char *name;
+  const char *value;
+  uint32_t hash;
+} parameter;
+
 struct parameter_list {
-  GVariantDict dict;
+  parameter *table;
+  unsigned int mask;
+  unsigned int count;
 };
 
 
-parameter_list *
-parameter_list_new_from_string (const char *string)
+static uint32_t
+hash_name (const char *name)
+{
+  uint32_t hash = 2166136261u; /* FNV-1a */
+
+  for (; *name != '\0'; name++) {
+    hash ^= (uint8_t)*name;
+    hash *= 16777619u;
+  }
+
+  return hash;
+}
+
+static void
+parameter_list_insert (parameter_list *list, const char *name, const char *value)
+{
+  uint32_t hash = hash_name (name);
+  unsigned int i;
+
+  for (i = hash & list->mask;
+       list->table[i].name != NULL;
+       i = (i + 1) & list->mask) {
+    /* Later duplicates replace earlier ones */
+    if (list->table[i].hash == hash &&
+        strcmp (list->table[i].name, name) == 0) {
+      list->table[i].value = value;
+      return;
+    }
+  }
+
+  list->table[i].name = name;
+  list->table[i].value = value;
+  list->table[i].hash = hash;
+  list->count++;
+}
+
+/* Returns the value of the named parameter, or NULL if it is not present */
+static const char *
+parameter_list_lookup (const parameter_list *list, const char *name)
 {
-  parameter_list *list;
-  char **parameters;
-  char **parameter;
-
-  list = g_slice_new0 (parameter_list);
-  g_variant_dict_init (&list->dict, NULL);
-
-  parameters = g_strsplit ((string[0] == '|') ? &string[1] : string, "|", 0);
-
-  for (parameter = parameters; *parameter != NULL; parameter++) {
-    char **nv;
-    nv = g_strsplit (*parameter, "=", 2);
-    if (nv[0] != NULL &&
-        nv[1] != NULL)
-      if (g_utf8_validate (nv[1], -1, NULL)) {
-//        printf ("%s=%s\n", nv[0], nv[1]);
-        g_variant_dict_insert (&list->dict, nv[0], "s", nv[1]);
-      } else {
-//        printf ("Non UTF8 encoding found in parameter %s\n", nv[0]);
-        g_variant_dict_insert (&list->dict, nv[0], "s", "BAD ENCODING");
-        /* XXX: Should we include this as a byte array in the dictionary? */
+  uint32_t hash = hash_name (name);
+  unsigned int i;
+
+  for (i = hash & list->mask;
+       list->table[i].name != NULL;
+       i = (i + 1) & list->mask) {
+    if (list->table[i].hash == hash &&
+        strcmp (list->table[i].name, name) == 0) {
+      if (!g_utf8_validate (list->table[i].value, -1, NULL)) {
+//        printf ("Non UTF8 encoding found in parameter %s\n", name);
+        return "BAD ENCODING"; /* XXX: Should we expose this as a byte array? */
       }
-//    printf ("LISTING PARAMETER %s (Name='%s', Value='%s')\n", *parameter, nv[0], nv[1]);
-    g_strfreev (nv);
+      return list->table[i].value;
+    }
   }
 
-  g_strfreev (parameters);
+  return NULL;
+}
+
+/* Returns the number of bytes a list parsed from string needs, and the
+ * size of its hash table in table_size.
+ */
+static gsize
+parameter_list_allocation (const char *string, size_t length, unsigned int *table_size)
+{
+  unsigned int n_fields = 1;
+  unsigned int size = 2;
+  size_t i;
+
+  for (i = 0; i < length; i++)
+    if (string[i] == '|')
+      n_fields++;
+
+  /* Keep the table at most half full */
+  while (size < 2 * n_fields)
+    size *= 2;
+
+  *table_size = size;
+  return sizeof (parameter_list) + size * sizeof (parameter) + length + 1;
+}
+
+static parameter_list *
+parameter_list_build (gpointer memory, unsigned int size, const char *string, size_t length)
+{
+  parameter_list *list = memory;
+  char *copy;
+  char *field;
+
+  list->table = (parameter *)&list[1];
+  list->mask = size - 1;
+  list->count = 0;
+  memset (list->table, 0, size * sizeof (parameter));
+
+  copy = (char *)&list->table[size];
+  memcpy (copy, string, length);
+  copy[length] = '\0';
+
+  for (field = copy; field != NULL; ) {
+    char *next = strchr (field, '|');
+    char *equals;
+
+    if (next != NULL)
+      *next++ = '\0';
+
+    /* Fields without a '=' are ignored */
+    equals = strchr (field, '=');
+    if (equals != NULL) {
+      *equals = '\0';
+      parameter_list_insert (list, field, equals + 1);
+    }
+
+    field = next;
+  }
 
   return list;
 }
 
+/* Parse the first length bytes of string, which needn't be NUL terminated,
+ * e.g. a parameter string read straight out of a mapped stream. The list
+ * keeps its own copy, so the string needn't outlive it.
+ */
+parameter_list *
+parameter_list_new_from_view (const char *string, size_t length)
+{
+  unsigned int size;
+  gsize allocation;
+
+  allocation = parameter_list_allocation (string, length, &size);
+
+  return parameter_list_build (g_malloc (allocation), size, string, length);
+}
+
+/* As parameter_list_new_from_view, but the list is allocated from arena
+ * and lives as long as it does. It mustn't be freed with parameter_list_free.
+ */
+parameter_list *
+parameter_list_new_in_arena (arena *arena, const char *string, size_t length)
+{
+  unsigned int size;
+  gsize allocation;
+
+  allocation = parameter_list_allocation (string, length, &size);
+
+  return parameter_list_build (arena_alloc (arena, allocation), size, string, length);
+}
+
+parameter_list *
+parameter_list_new_from_string (const char *string)
+{
+  return parameter_list_new_from_view (string, strlen (string));
+}
+
 void
 parameter_list_free (parameter_list *list)
 {
-  /* NB:We don't unref the GVariantDict list->dict, as it is in-place */
+  g_free (list);
+}
+
+/* Dimensions are written like "10mil" or "0.254mm", and are returned in
+ * Altium's internal units of 1/10000 mil. Anything unparsable gives 0.
+ */
+static int32_t
+parse_dimension (const char *string)
+{
+  char *unit;
+  double value;
 
-  g_slice_free (parameter_list, list);
+  value = g_ascii_strtod (string, &unit);
+  if (unit == string)
+    return 0;
+
+  if (g_ascii_strcasecmp (unit, "mm") == 0)
+    value = value / 0.0254 * 10000.;
+  else /* "mil", or no unit at all */
+    value = value * 10000.;
+
+  return (int32_t) CLAMP (round (value), G_MININT32, G_MAXINT32);
 }
 
 int32_t
 parameter_list_get_dimension (const parameter_list *list, const char *name)
 {
-  char *string = NULL;
+  const char *string;
   int32_t value = 0; /* Default return value for not found */
 
-  if (!g_variant_dict_lookup ((/* not const */GVariantDict *)&list->dict, name, "s", &string))
+  string = parameter_list_lookup (list, name);
+  if (string == NULL)
     return value;
 
-  exit (-1);
-  /* XXX: Need to parse the string */
-  value = -1;
-
-  return value;
+  return parse_dimension (string);
 }
 
 double
 parameter_list_get_double (const parameter_list *list, const char *name)
 {
-  char *string = NULL;
+  const char *string;
   double value = 0.0; /* Default return value for not found */
 
-  if (!g_variant_dict_lookup ((/* not const */GVariantDict *)&list->dict, name, "s", &string))
+  string = parameter_list_lookup (list, name);
+  if (string == NULL)
     return value;
 
   value = atof (string);
@@ -105,10 +257,11 @@ parameter_list_get_double (const parameter_list *list, const char *name)
 unsigned int
 parameter_list_get_unsigned_int (const parameter_list *list, const char *name)
 {
-  char *string = NULL;
+  const char *string;
   unsigned int value = 0; /* Default return value for not found */
 
-  if (!g_variant_dict_lookup ((/* not const */GVariantDict *)&list->dict, name, "s", &string))
+  string = parameter_list_lookup (list, name);
+  if (string == NULL)
     return value;
 
   value = strtoul (string, NULL, 0); /* XXX: NO OVERFLOW HANDLING ETC */
@@ -119,10 +272,11 @@ parameter_list_get_unsigned_int (const parameter_list *list, const char *name)
 int
 parameter_list_get_int (const parameter_list *list, const char *name)
 {
-  char *string = NULL;
+  const char *string;
   int value = 0; /* Default return value for not found */
 
-  if (!g_variant_dict_lookup ((/* not const */GVariantDict *)&list->dict, name, "s", &string))
+  string = parameter_list_lookup (list, name);
+  if (string == NULL)
     return value;
 
   value = atoi (string);
@@ -133,10 +287,11 @@ parameter_list_get_int (const parameter_list *list, const char *name)
 bool
 parameter_list_get_bool (const parameter_list *list, const char *name)
 {
-  char *string = NULL;
+  const char *string;
   bool value = false; /* Default return value for not found */
 
-  if (!g_variant_dict_lookup ((/* not const */GVariantDict *)&list->dict, name, "s", &string))
+  string = parameter_list_lookup (list, name);
+  if (string == NULL)
     return value;
 
 //  if (strcmp (string, "TRUE") == 0)
@@ -148,13 +303,21 @@ parameter_list_get_bool (const parameter_list *list, const char *name)
   return value;
 }
 
-char *
-parameter_list_get_string (const parameter_list *list, const char *name)
+/* NB: The string belongs to the list, and goes when it does */
+const char *
+parameter_list_peek_string (const parameter_list *list, const char *name)
 {
-  char *string;
+  const char *string;
 
-  if (!g_variant_dict_lookup ((/* not const */GVariantDict *)&list->dict, name, "s", &string))
-    return g_strdup ("");
+  string = parameter_list_lookup (list, name);
+  if (string == NULL)
+    return "";
+
+  return string;
+}
 
-  return g_strdup (string);
+char *
+parameter_list_get_string (const parameter_list *list, const char *name)
+{
+  return g_strdup (parameter_list_peek_string (list, name));
 }
@@ -20,10 +20,13 @@
 typedef struct parameter_list parameter_list;
 
 parameter_list *parameter_list_new_from_string (const char *string);
+parameter_list *parameter_list_new_from_view (const char *string, size_t length);
+parameter_list *parameter_list_new_in_arena (arena *arena, const char *string, size_t length);
 void parameter_list_free (parameter_list *list);
 int32_t parameter_list_get_dimension (const parameter_list *list, const char *name);
 double parameter_list_get_double (const parameter_list *list, const char *name);
 unsigned int parameter_list_get_unsigned_int (const parameter_list *list, const char *name);
 int parameter_list_get_int (const parameter_list *list, const char *name);
 bool parameter_list_get_bool (const parameter_list *list, const char *name);
+const char *parameter_list_peek_string (const parameter_list *list, const char *name);
 char *parameter_list_get_string (const parameter_list *list, const char *name);
@@ -26,21 +26,40 @@
 #include <string.h>
 
 #include "content-parser.h"
+#include "arena.h"
 #include "parameters.h"
 #include "models.h"
-
-
-static void
-fprint_coord (FILE *file, int32_t coord)
-{
-//  fprintf (file, "%.2fmm", (double)coord / 1000000. * 2.54);
-  fprintf (file, "%.2fmil", (double)coord / 10000.);
-}
+#include "output-writer.h"
+#include "footprint.h"
+#include "options.h"
+#include "pcblib.h"
+#include "pcblib-data.h"
+#include "openaltium-error.h"
+#include "logging.h"
+#include "stats.h"
+
+
+/* Give up on a record which doesn't look the way we expect, rather than
+ * taking the whole process down. decode_pcblib_data () reports where.
+ */
+#define RECORD_CHECK(expr) \
+  G_STMT_START { \
+    if (!(expr)) { \
+      log_info ("Unexpected record data, failed check: %s\n", #expr); \
+      return 0; \
+    } \
+  } G_STMT_END
 
 static void
 print_coord (int32_t coord)
 {
-  fprint_coord (stdout, coord);
+  char buffer[16];
+
+  if (!log_trace_enabled ())
+    return;
+
+  buffer[format_coord (buffer, coord)] = '\0';
+  fputs (buffer, stdout);
 }
 
 static int
@@ -49,32 +68,31 @@ skip_10x_ff (file_content *content)
   uint16_t word;
   int i;
 
-  printf ("  SKIPPING FFFF FFFF FFFF FFFF FFFF\n");
+  log_trace ("  SKIPPING FFFF FFFF FFFF FFFF FFFF\n");
 
   for (i = 0; i < 5; i++) {
     if (!content_get_uint16 (content, &word)) return 0;
-    g_assert (word == 0xFFFF);
+    RECORD_CHECK (word == 0xFFFF);
   }
 
   return 1;
 }
 
 static int
-decode_name (FILE *file, file_content *content)
+decode_name (footprint *fp, file_content *content)
 {
-  char *string;
+  content_string string;
 
-  printf ("Decoding name header\n");
+  log_trace ("Decoding name header\n");
 
-  if ((string = content_get_length_multi_prefixed_string (content)) == NULL) return 0;
-  printf ("  String is '%s'\n", string);
+  if (!content_get_length_multi_prefixed_string_view (content, &string)) return 0;
+  log_trace ("  String is '%.*s'\n", string.length, string.str);
 
-  g_free (string);
   return 1;
 }
 
 static int
-decode_arc_record (FILE *file, file_content *content)
+decode_arc_record (footprint *fp, file_content *content)
 {
   uint32_t record_length;
   uint16_t w1, w2;
@@ -85,74 +103,69 @@ decode_arc_record (FILE *file, file_content *content)
   double start_angle, end_angle, delta_angle;
   uint32_t dw1, dw2;
 
-  printf ("arc\n");
+  log_trace ("arc\n");
 
   if (!content_get_uint32 (content, &record_length)) return 0;
-  printf ("  DWORD %i (record length)\n", record_length);
+  log_trace ("  DWORD %i (record length)\n", record_length);
 
   if (!content_get_byte (content, &layer)) return 0;
-  printf ("  BYTE %i (layer)\n", layer);
+  log_trace ("  BYTE %i (layer)\n", layer);
 
   if (!content_get_uint16 (content, &w1)) return 0;
-  printf ("  WORD %i\n", w1);
+  log_trace ("  WORD %i\n", w1);
 
   if (!skip_10x_ff (content)) return 0;
 
   if (!content_get_int32 (content, &x)) return 0;
   if (!content_get_int32 (content, &y)) return 0;
   if (!content_get_int32 (content, &radius)) return 0;
-  printf ("  Center location (");
-  print_coord (x); printf (", ");
-  print_coord (y); printf (") Radius?: ");
-  print_coord (radius); printf ("\n");
+  log_trace ("  Center location (");
+  print_coord (x); log_trace (", ");
+  print_coord (y); log_trace (") Radius?: ");
+  print_coord (radius); log_trace ("\n");
 
   if (!content_get_double (content, &start_angle)) return 0;
   if (!content_get_double (content, &end_angle)) return 0;
-  printf ("  Angle %f°-%f°\n", start_angle, end_angle);
+  log_trace ("  Angle %f°-%f°\n", start_angle, end_angle);
 
   if (!content_get_uint32 (content, &thickness)) return 0;
-  printf ("  Thickness: "); print_coord (thickness); printf ("\n");
+  log_trace ("  Thickness: "); print_coord (thickness); log_trace ("\n");
 
   /* XXX: Assume inserting this here for larger records, gives the ordering? (small variant discovered last) */
   if (record_length >= 52) {
     if (!content_get_uint32 (content, &dw2)) return 0;
-    printf ("  Unknown dimension: "); print_coord (dw2); printf ("\n");
+    log_trace ("  Unknown dimension: "); print_coord (dw2); log_trace ("\n");
   }
 
   if (!content_get_uint16 (content, &w2)) return 0;
-  printf ("  WORD %i\n", w2);
+  log_trace ("  WORD %i\n", w2);
 
   if (!content_get_byte (content, &byte)) return 0;
-  printf ("  BYTE %i\n", byte);
+  log_trace ("  BYTE %i\n", byte);
 
   if (record_length >= 56) {
     if (!content_get_uint32 (content, &dw1)) return 0;
-    printf ("  DWORD %i (layer cache / layer number?)\n", dw1);
+    log_trace ("  DWORD %i (layer cache / layer number?)\n", dw1);
   }
 
   if (record_length != 56 &&
       record_length != 52 &&
-      record_length != 48)
-    g_error ("Bad record length %i\n", record_length);
+      record_length != 48) {
+    log_info ("Bad record length %i\n", record_length);
+    return 0;
+  }
 
   delta_angle = end_angle - start_angle;
   if (delta_angle < 0.) /* XXX: What invariants do Altium arcs have? */
     delta_angle += 360;
 
-  /* XXX: GOODNESS KNOWS WHAT THE ANGLE CONVENTION IS... EXAMPLES SO FAR ARE FULL CIRCLE ARCS!!! */
-  fprintf (file, "\tElementArc[");
-  fprint_coord (file, x);      fprintf (file, " ");
-  fprint_coord (file, -y);     fprintf (file, " ");
-  fprint_coord (file, radius);  fprintf (file, " ");
-  fprint_coord (file, radius); fprintf (file, " ");
-  fprintf (file, "%f %f ", 180 + start_angle, delta_angle);
-  fprint_coord (file, thickness); fprintf (file, "]\n");
+  footprint_add_arc (fp, layer, x, y, radius, start_angle, delta_angle, thickness);
 
   return 1;
 }
 
 static int
-decode_record_3 (FILE *file, file_content *content)
+decode_record_3 (footprint *fp, file_content *content)
 {
   uint32_t record_length;
   uint8_t layer;
@@ -161,105 +174,99 @@ decode_record_3 (FILE *file, file_content *content)
   uint16_t w1, w2;
   int32_t x, y;
   int32_t c[12];
-  int32_t dim;
+  int32_t n[32];
   uint32_t dw1;
   int i;
 
-  printf ("type 3 (unknown meaning) - could be paste deposition / thermal via / ...?\n");
+  log_trace ("type 3 (unknown meaning) - could be paste deposition / thermal via / ...?\n");
 
   if (!content_get_uint32 (content, &record_length)) return 0;
-  printf ("  DWORD %i (record length)\n", record_length);
+  log_trace ("  DWORD %i (record length)\n", record_length);
 
   if (!content_get_byte (content, &layer)) return 0;
-  printf ("  BYTE %i (layer)\n", layer);
+  log_trace ("  BYTE %i (layer)\n", layer);
 
   if (!content_get_uint16 (content, &w1)) return 0;
-  printf ("  WORD %i\n", w1);
+  log_trace ("  WORD %i\n", w1);
 
   if (!skip_10x_ff (content)) return 0;
 
   if (!content_get_int32 (content, &x)) return 0;
   if (!content_get_int32 (content, &y)) return 0;
-  printf ("  Position (");
-  print_coord (x); printf (", ");
-  print_coord (y); printf (")\n");
+  log_trace ("  Position (");
+  print_coord (x); log_trace (", ");
+  print_coord (y); log_trace (")\n");
 
-  if (!content_get_int32 (content, &c[0])) return 0;
-  if (!content_get_int32 (content, &c[1])) return 0;
-  printf ("  c[0]: "); print_coord (c[0]);
-  printf (" c[1]: "); print_coord (c[1]); printf ("\n");
+  if (!content_get_int32_array (content, &c[0], 2)) return 0;
+  log_trace ("  c[0]: "); print_coord (c[0]);
+  log_trace (" c[1]: "); print_coord (c[1]); log_trace ("\n");
 
   if (!content_get_byte (content, &b1)) return 0;
   if (!content_get_byte (content, &b2)) return 0;
   if (!content_get_byte (content, &b3)) return 0;
-  printf ("BYTES %i, %i, %i\n", b1, b2, b3);
+  log_trace ("BYTES %i, %i, %i\n", b1, b2, b3);
 
   if (!content_get_int32 (content, &c[2])) return 0;
-  printf ("  c[2]: "); print_coord (c[2]); printf ("\n");
+  log_trace ("  c[2]: "); print_coord (c[2]); log_trace ("\n");
 
   if (!content_get_uint16 (content, &w2)) return 0;
-  printf ("  WORD %i\n", w2);
-
-  if (!content_get_int32 (content, &c[3])) return 0;
-  if (!content_get_int32 (content, &c[4])) return 0;
-  if (!content_get_int32 (content, &c[5])) return 0;
-  if (!content_get_int32 (content, &c[6])) return 0;
-  if (!content_get_int32 (content, &c[7])) return 0;
-  if (!content_get_int32 (content, &c[8])) return 0;
-  if (!content_get_int32 (content, &c[9])) return 0;
-
-  printf ("  c[3]: "); print_coord (c[3]);
-  printf (" c[4]: "); print_coord (c[4]);
-  printf (" c[5]: "); print_coord (c[5]);
-  printf (" c[6]: "); print_coord (c[6]);
-  printf (" c[7]: "); print_coord (c[7]); printf ("\n");
-  printf ("  c[8]: "); print_coord (c[8]);
-  printf (" c[9]: "); print_coord (c[9]); printf ("\n");
+  log_trace ("  WORD %i\n", w2);
+
+  if (!content_get_int32_array (content, &c[3], 7)) return 0;
+
+  log_trace ("  c[3]: "); print_coord (c[3]);
+  log_trace (" c[4]: "); print_coord (c[4]);
+  log_trace (" c[5]: "); print_coord (c[5]);
+  log_trace (" c[6]: "); print_coord (c[6]);
+  log_trace (" c[7]: "); print_coord (c[7]); log_trace ("\n");
+  log_trace ("  c[8]: "); print_coord (c[8]);
+  log_trace (" c[9]: "); print_coord (c[9]); log_trace ("\n");
 
   if (record_length >= 203) {
     if (!content_get_byte (content, &b[0])) return 0;
-    printf ("  BYTE %i\n", b[0]);
+    log_trace ("  BYTE %i\n", b[0]);
   }
 
-  if (!content_get_int32 (content, &c[10])) return 0;
-  if (!content_get_int32 (content, &c[11])) return 0;
+  if (!content_get_int32_array (content, &c[10], 2)) return 0;
 
 
-  printf (" c[10]: "); print_coord (c[10]);
-  printf (" c[11]: "); print_coord (c[11]); printf ("\n");
+  log_trace (" c[10]: "); print_coord (c[10]);
+  log_trace (" c[11]: "); print_coord (c[11]); log_trace ("\n");
 
   if (record_length >= 203) {
 
 //    if (!content_get_byte (content, &b[0])) return 0;
-//    printf ("  BYTE %i\n", b[0]);
+//    log_trace ("  BYTE %i\n", b[0]);
 
     /* XXX: SUSPECTED PAD / ANTIPAD SIZES ON APPROX 32 LAYERS? */
 
+    if (!content_get_int32_array (content, n, 32)) return 0;
     for (i = 0; i < 32; i++) {
-      if (!content_get_int32 (content, &dim)) return 0;
-      printf ("  n[%i]: ", i); print_coord (dim); printf ("\n");
+      log_trace ("  n[%i]: ", i); print_coord (n[i]); log_trace ("\n");
     }
   }
 
   if (record_length >= 209) {
     if (!content_get_uint32 (content, &dw1)) return 0;
-    printf ("  DWORD %i\n", dw1);
+    log_trace ("  DWORD %i\n", dw1);
 
     if (!content_get_byte (content, &b[1])) return 0;
     if (!content_get_byte (content, &b[2])) return 0;
-    printf ("  BYTES %i, %i\n", b[1], b[2]);
+    log_trace ("  BYTES %i, %i\n", b[1], b[2]);
   }
 
   if (record_length >= 241) {
     content_skip_bytes (content, 32);
-    printf ("  Skipped 32 bytes\n");
+    log_trace ("  Skipped 32 bytes\n");
   }
 
   if (record_length != 241 &&
       record_length != 209 &&
       record_length != 203 &&
-      record_length != 74)
-    g_error ("Bad record length %i\n", record_length);
+      record_length != 74) {
+    log_info ("Bad record length %i\n", record_length);
+    return 0;
+  }
 
   /* XXX: DEBUG OUTPUT */
   if (1) {
@@ -299,23 +306,15 @@ decode_record_3 (FILE *file, file_content *content)
     x2 = x - tx;
     y2 = y - ty;
 
-
-    fprintf (file, "\tPad[");
-    fprint_coord (file, x1);     fprintf (file, " ");
-    fprint_coord (file, -y1);     fprintf (file, " ");
-    fprint_coord (file, x2);     fprintf (file, " ");
-    fprint_coord (file, -y2);     fprintf (file, " ");
-    fprint_coord (file, pad);   fprintf (file, " ");
-    fprint_coord (file, clear); fprintf (file, " ");
-    fprint_coord (file, mask);  fprintf (file, " ");
-    fprintf (file, "\"\" \"%s\" \"%s\"]\n", "debug", "square,onsolder");
+    footprint_add_pad (fp, layer, x1, y1, x2, y2, pad, clear, mask, 0,
+                       FOOTPRINT_PAD_SQUARE | FOOTPRINT_PAD_ONSOLDER, "debug", -1);
   }
 
   return 1;
 }
 
 static int
-decode_silkline (FILE *file, file_content *content)
+decode_silkline (footprint *fp, file_content *content)
 {
   uint32_t record_length;
   uint8_t layer;
@@ -325,13 +324,13 @@ decode_silkline (FILE *file, file_content *content)
   int32_t x1, y1, x2, y2, width;
   uint32_t dw1;
 
-  printf ("silkline\n");
+  log_trace ("silkline\n");
 
   if (!content_get_uint32 (content, &record_length)) return 0; /* Some kind of length? */
-  printf ("  DWORD %i (record length)\n", record_length);
+  log_trace ("  DWORD %i (record length)\n", record_length);
 
   if (!content_get_byte (content, &layer)) return 0;
-  printf ("  BYTE %i (layer)\n", layer);
+  log_trace ("  BYTE %i (layer)\n", layer);
 
   /* From: http://beta.ivc.no/wiki/index.php/Altium_Designer
    * 33: Top Overlay
@@ -340,7 +339,7 @@ decode_silkline (FILE *file, file_content *content)
    */
 
   if (!content_get_uint16 (content, &w1)) return 0;
-  printf ("  WORD %i\n", w1);
+  log_trace ("  WORD %i\n", w1);
 
   if (!skip_10x_ff (content)) return 0;
 
@@ -349,48 +348,44 @@ decode_silkline (FILE *file, file_content *content)
   if (!content_get_int32 (content, &x2)) return 0;
   if (!content_get_int32 (content, &y2)) return 0;
   if (!content_get_int32 (content, &width)) return 0;
-  printf ("  Silk line (");
-  print_coord (x1); printf (", ");
-  print_coord (y1); printf (")-(");
-  print_coord (x2); printf (", ");
-  print_coord (y2); printf (") Width: ");
-  print_coord (width); printf ("\n");
+  log_trace ("  Silk line (");
+  print_coord (x1); log_trace (", ");
+  print_coord (y1); log_trace (")-(");
+  print_coord (x2); log_trace (", ");
+  print_coord (y2); log_trace (") Width: ");
+  print_coord (width); log_trace ("\n");
 
   if (!content_get_byte (content, &b1)) return 0;
   if (!content_get_byte (content, &b2)) return 0;
   if (!content_get_byte (content, &b3)) return 0;
-  printf ("  BYTES %i, %i, %i\n", b1, b2, b3);
+  log_trace ("  BYTES %i, %i, %i\n", b1, b2, b3);
 
   if (record_length >= 41) {
     if (!content_get_byte (content, &byte)) return 0;
-    printf ("  BYTE %i\n", byte);
+    log_trace ("  BYTE %i\n", byte);
     if (!content_get_uint32 (content, &dw1)) return 0;
-    printf ("  DWORD %i\n", dw1);
+    log_trace ("  DWORD %i\n", dw1);
   }
 
   if (record_length >= 45) {
     if (!content_get_uint32 (content, &dw1)) return 0;
-    printf ("  DWORD %i (layer cache / layer number?)\n", dw1);
+    log_trace ("  DWORD %i (layer cache / layer number?)\n", dw1);
   }
 
   if (record_length != 45 &&
       record_length != 41 &&
-      record_length != 36)
-    g_error ("Bad record length %i\n", record_length);
-
+      record_length != 36) {
+    log_info ("Bad record length %i\n", record_length);
+    return 0;
+  }
 
-  fprintf (file, "\tElementLine[");
-  fprint_coord (file, x1);    fprintf (file, " ");
-  fprint_coord (file, -y1);    fprintf (file, " ");
-  fprint_coord (file, x2);    fprintf (file, " ");
-  fprint_coord (file, -y2);    fprintf (file, " ");
-  fprint_coord (file, width); fprintf (file, "]\n");
+  footprint_add_line (fp, layer, x1, y1, x2, y2, width);
 
   return 1;
 }
 
 static int
-decode_text_record (FILE *file, file_content *content)
+decode_text_record (footprint *fp, file_content *content)
 {
   uint32_t record_length;
   uint8_t layer;
@@ -399,19 +394,19 @@ decode_text_record (FILE *file, file_content *content)
   int32_t x, y, height;
   double angle;
   uint32_t dw1, dw2, dw3, dw4, dw5, dw6, dw7;
-  char *text;
+  content_string text;
   char *font = NULL;
 
-  printf ("text\n");
+  log_trace ("text\n");
 
   if (!content_get_uint32 (content, &record_length)) return 0; /* NB: Excludes string */
-  printf ("  DWORD %i\n", record_length);
+  log_trace ("  DWORD %i\n", record_length);
 
   if (!content_get_byte (content, &layer)) return 0;
-  printf ("  BYTE %i (layer)\n", layer);
+  log_trace ("  BYTE %i (layer)\n", layer);
 
   if (!content_get_uint16 (content, &w3)) return 0;
-  printf ("  WORD %i\n", w3);
+  log_trace ("  WORD %i\n", w3);
 
   if (!skip_10x_ff (content)) return 0;                 /* 30 Bytes left in super-small format */
 
@@ -421,40 +416,40 @@ decode_text_record (FILE *file, file_content *content)
   if (!content_get_uint16 (content, &w1)) return 0;    /* 16 Bytes left in super-small format */
   if (!content_get_double (content, &angle)) return 0; /*  8 Bytes left in super-small format */
 
-  printf ("  Text position (");
-  print_coord (x); printf (", ");
-  print_coord (y); printf (") Height: ");
-  print_coord (height); printf ("\n");
-  printf ("  WORD %i\n", w1);
-  printf ("  Rotation angle %f\n", angle);
+  log_trace ("  Text position (");
+  print_coord (x); log_trace (", ");
+  print_coord (y); log_trace (") Height: ");
+  print_coord (height); log_trace ("\n");
+  log_trace ("  WORD %i\n", w1);
+  log_trace ("  Rotation angle %f\n", angle);
 
   if (!content_get_uint32 (content, &dw1)) return 0;  /* 4 Bytes left in super-small format */
   if (!content_get_uint32 (content, &dw2)) return 0;  /* 0 Bytes left in super-small format */
-  printf (" DWORDS %i, %i\n", dw1, dw2);
+  log_trace (" DWORDS %i, %i\n", dw1, dw2);
 
   if (record_length >= 123) {
 
     if (!content_get_uint16 (content, &w2)) return 0;
-    printf (" WORD %i\n", w2);
+    log_trace (" WORD %i\n", w2);
 
     if (!content_get_byte (content, &byte)) return 0;
-    printf ("  BYTE %i\n", byte);
+    log_trace ("  BYTE %i\n", byte);
 
     font = content_get_n_wchars (content, 32);
     if (font == NULL) return 0;
-    printf ("  Font is %s\n", font);
+    log_trace ("  Font is %s\n", font);
     g_free (font);
 
     if (!content_get_byte (content, &byte)) return 0;
-    printf ("  BYTE %i\n", byte);
+    log_trace ("  BYTE %i\n", byte);
 
     if (!content_get_uint32 (content, &dw1)) return 0;
-    printf ("  DWORD %i\n", dw1);
+    log_trace ("  DWORD %i\n", dw1);
 
     if (!content_get_uint32 (content, &dw1)) return 0;
-    printf ("  DWORD %i\n", dw1);
+    log_trace ("  DWORD %i\n", dw1);
     if (!content_get_uint32 (content, &dw1)) return 0;
-    printf ("  DWORD %i\n", dw1);
+    log_trace ("  DWORD %i\n", dw1);
 
 
 #if 0
@@ -462,18 +457,18 @@ decode_text_record (FILE *file, file_content *content)
       /* Something else?? */
 
       content_skip_bytes (content, 8);
-      printf ("  Skipped 8 bytes\n");
+      log_trace ("  Skipped 8 bytes\n");
 
     } else if (dw1 == 200000) {
 #endif
     if (record_length >= 226) {
 //      content_skip_bytes (content, 17);
-//      printf ("  Skipped 17 bytes\n");
+//      log_trace ("  Skipped 17 bytes\n");
       content_skip_bytes (content, 9);
-      printf ("  Skipped 9 bytes\n");
+      log_trace ("  Skipped 9 bytes\n");
 
       if (!content_get_byte (content, &byte)) return 0;
-      printf ("  BYTE %i\n", byte);
+      log_trace ("  BYTE %i\n", byte);
 
       if (!content_get_uint32 (content, &dw1)) return 0;
       if (!content_get_uint32 (content, &dw2)) return 0;
@@ -482,56 +477,49 @@ decode_text_record (FILE *file, file_content *content)
       if (!content_get_uint32 (content, &dw5)) return 0;
       if (!content_get_uint32 (content, &dw6)) return 0;
       if (!content_get_uint32 (content, &dw7)) return 0;
-      printf ("  DWORD %i, %i, %i, %i, %i, %i, %i\n", dw1, dw2, dw3, dw4, dw5, dw6, dw7);
+      log_trace ("  DWORD %i, %i, %i, %i, %i, %i, %i\n", dw1, dw2, dw3, dw4, dw5, dw6, dw7);
 
       font = content_get_n_wchars (content, 32);
       if (font == NULL) return 0;
-      printf ("  Font is %s\n", font);
+      log_trace ("  Font is %s\n", font);
       g_free (font);
 
       if (!content_get_byte (content, &byte)) return 0;
-      printf ("  BYTE %i\n", byte);
+      log_trace ("  BYTE %i\n", byte);
     }
 
     if (record_length >= 230) {
       if (!content_get_uint32 (content, &dw1)) return 0;
-      printf ("  DWORD %i\n", dw1);
+      log_trace ("  DWORD %i\n", dw1);
     }
 
     if (record_length != 230 &&
         record_length != 226 &&
-        record_length != 123)
-      g_error ("Bad record length %i\n", record_length);
+        record_length != 123) {
+      log_info ("Bad record length %i\n", record_length);
+      return 0;
+    }
 
 //    } else {
 //      content->cursor -= 4;
 //    }
   } else {
-    g_assert (record_length == 43);
+    RECORD_CHECK (record_length == 43);
   }
 
-  printf ("Getting text from file offset %#x\n", content->cursor);
-
-  if ((text = content_get_length_multi_prefixed_string (content)) == NULL) return 0;
+  log_trace ("Getting text from file offset %#x\n", content->cursor);
 
-  printf ("  Text is '%s'\n", text);
+  if (!content_get_length_multi_prefixed_string_view (content, &text)) return 0;
 
-#if 0 /* PCB DOESN'T SUPPORT TEXT IN ELEMENTS! */
-  fprintf (file, "\tText[");
-  fprint_coord (file, x);     fprintf (file, " ");
-  fprint_coord (file, -y);     fprintf (file, " ");
-  fprintf (file, "0 "); /* Rotation */
-  fprintf (file, "%f ", height / 400.); /* scale is in percentage of the "default", which is about 40mil high */
-  fprintf (file, "\"%s\" \"\"]\n", text);
-#endif
+  log_trace ("  Text is '%.*s'\n", text.length, text.str);
 
-  g_free (text);
+  footprint_add_text (fp, layer, x, y, height, angle, text.str, text.length);
 
   return 1;
 }
 
 static int
-decode_rectangle_record (FILE *file, file_content *content)
+decode_rectangle_record (footprint *fp, file_content *content)
 {
   uint32_t record_length;
   uint8_t layer;
@@ -541,13 +529,13 @@ decode_rectangle_record (FILE *file, file_content *content)
   int32_t x2, y2;
   uint32_t dw1, dw2, dw3, dw4;
 
-  printf ("rectangle\n");
+  log_trace ("rectangle\n");
 
   if (!content_get_uint32 (content, &record_length)) return 0;
-  printf ("  DWORD %i (record length)\n", record_length);
+  log_trace ("  DWORD %i (record length)\n", record_length);
 
   if (!content_get_byte (content, &layer)) return 0;
-  printf ("  BYTE %i (layer)\n", layer);
+  log_trace ("  BYTE %i (layer)\n", layer);
 
   /*
    * 33: Top Overlay
@@ -556,91 +544,51 @@ decode_rectangle_record (FILE *file, file_content *content)
 
 
   if (!content_get_uint16 (content, &w1)) return 0;
-  printf ("  WORD %i\n", w1);
+  log_trace ("  WORD %i\n", w1);
 
   if (!skip_10x_ff (content)) return 0;
 
   if (!content_get_int32 (content, &x1)) return 0;
   if (!content_get_int32 (content, &y1)) return 0;
-  printf ("  Coordinate ("); print_coord (x1); printf (", "); print_coord (y1); printf (")\n");
+  log_trace ("  Coordinate ("); print_coord (x1); log_trace (", "); print_coord (y1); log_trace (")\n");
 
   if (!content_get_int32 (content, &x2)) return 0;
   if (!content_get_int32 (content, &y2)) return 0;
-  printf ("  Coordinate ("); print_coord (x2); printf (", "); print_coord (y2); printf (")\n");
+  log_trace ("  Coordinate ("); print_coord (x2); log_trace (", "); print_coord (y2); log_trace (")\n");
 
 
   if (!content_get_uint32 (content, &dw1)) return 0;
   if (!content_get_uint32 (content, &dw2)) return 0;
-  printf ("  DWORDS %i, %i\n", dw1, dw2);
+  log_trace ("  DWORDS %i, %i\n", dw1, dw2);
 
   /* XXX: Unknown which field is dropped in the small record variant */
   if (record_length >= 42) {
     if (!content_get_uint32 (content, &dw3)) return 0;
-    printf ("  DWORD %i\n", dw3);
+    log_trace ("  DWORD %i\n", dw3);
   }
 
   if (!content_get_byte (content, &byte)) return 0;
-  printf ("  BYTE %i\n", byte);
+  log_trace ("  BYTE %i\n", byte);
 
   if (record_length >= 46) {
     if (!content_get_uint32 (content, &dw4)) return 0;
-    printf ("  DWORD %i (layer cache / layer number?)\n", dw4);
+    log_trace ("  DWORD %i (layer cache / layer number?)\n", dw4);
   }
 
   if (record_length != 46 &&
       record_length != 42 &&
-      record_length != 38)
-    g_error ("Bad record length %i\n", record_length);
-
-  /* XXX: Debug output */
-  if (1) {
-    uint32_t width;
-
-    width  = 50;
-
-    /* XXX: We don't support rectangles in our footprints! */
-    fprintf (file, "\tElementLine[");
-    fprint_coord (file, x1);    fprintf (file, " ");
-    fprint_coord (file, -y1);    fprintf (file, " ");
-    fprint_coord (file, x1);    fprintf (file, " ");
-    fprint_coord (file, -y2);    fprintf (file, " ");
-    fprint_coord (file, width); fprintf (file, "]\n");
-    fprintf (file, "\tElementLine[");
-    fprint_coord (file, x2);    fprintf (file, " ");
-    fprint_coord (file, -y1);    fprintf (file, " ");
-    fprint_coord (file, x2);    fprintf (file, " ");
-    fprint_coord (file, -y2);    fprintf (file, " ");
-    fprint_coord (file, width); fprintf (file, "]\n");
-    fprintf (file, "\tElementLine[");
-    fprint_coord (file, x1);    fprintf (file, " ");
-    fprint_coord (file, -y1);    fprintf (file, " ");
-    fprint_coord (file, x2);    fprintf (file, " ");
-    fprint_coord (file, -y1);    fprintf (file, " ");
-    fprint_coord (file, width); fprintf (file, "]\n");
-    fprintf (file, "\tElementLine[");
-    fprint_coord (file, x1);    fprintf (file, " ");
-    fprint_coord (file, -y2);    fprintf (file, " ");
-    fprint_coord (file, x2);    fprintf (file, " ");
-    fprint_coord (file, -y2);    fprintf (file, " ");
-    fprint_coord (file, width); fprintf (file, "]\n");
-    fprintf (file, "\tElementLine[");
-    fprint_coord (file, x1);    fprintf (file, " ");
-    fprint_coord (file, -y1);    fprintf (file, " ");
-    fprint_coord (file, x2);    fprintf (file, " ");
-    fprint_coord (file, -y2);    fprintf (file, " ");
-    fprint_coord (file, width); fprintf (file, "]\n");
-    fprintf (file, "\tElementLine[");
-    fprint_coord (file, x1);    fprintf (file, " ");
-    fprint_coord (file, -y2);    fprintf (file, " ");
-    fprint_coord (file, x2);    fprintf (file, " ");
-    fprint_coord (file, -y1);    fprintf (file, " ");
-    fprint_coord (file, width); fprintf (file, "]\n");
+      record_length != 38) {
+    log_info ("Bad record length %i\n", record_length);
+    return 0;
   }
+
+  footprint_add_rectangle (fp, layer, x1, y1, x2, y2);
+
   return 1;
 }
 
 static int
-decode_polygon_record (FILE *file, file_content *content)
+decode_polygon_record (footprint *fp, file_content *content)
 {
   uint32_t record_length;
   uint32_t fields_length;
@@ -649,64 +597,68 @@ decode_polygon_record (FILE *file, file_content *content)
   uint16_t w1;
   uint32_t dw1;
   int32_t something;
-  char *attributes;
+  content_string attributes;
   size_t string_length;
   uint32_t count;
+  const char *vertices;
+  double *vertex_x, *vertex_y;
   int i;
 
-  printf ("polygon\n");
+  log_trace ("polygon\n");
 
   if (!content_get_uint32 (content, &record_length)) return 0;
-  printf ("  DWORD %i (record length)\n", record_length);
+  log_trace ("  DWORD %i (record length)\n", record_length);
 
   if (!content_get_byte (content, &layer)) return 0;
-  printf ("  BYTE %i (layer)\n", layer);
+  log_trace ("  BYTE %i (layer)\n", layer);
 
   if (!content_get_uint16 (content, &w1)) return 0;
-  printf ("  WORD %i\n", w1);
+  log_trace ("  WORD %i\n", w1);
 
   if (!skip_10x_ff (content)) return 0;
 
   if (!content_get_int32 (content, &something)) return 0;
-  printf ("  Something: ");
-  print_coord (something); printf ("\n");
+  log_trace ("  Something: ");
+  print_coord (something); log_trace ("\n");
 
   if (!content_get_byte (content, &byte)) return 0;
-  printf ("  BYTE %i\n", byte);
+  log_trace ("  BYTE %i\n", byte);
 
-  attributes = content_get_length_dword_prefixed_string (content);
-  if (attributes == NULL)
-    return 0;
-  string_length = strlen (attributes);
+  if (!content_get_length_dword_prefixed_string_view (content, &attributes)) return 0;
+  string_length = attributes.length;
 
-  printf ("  Polygon attributes: %s\n", attributes);
-  g_free (attributes);
+  log_trace ("  Polygon attributes: %.*s\n", attributes.length, attributes.str);
 
   if (!content_get_uint32 (content, &count)) return 0;
 
-  printf ("  Polygon outline: ");
+  log_trace ("  Polygon outline: ");
+
+  if ((vertices = content_take_array (content, count, 16)) == NULL) return 0;
+
+  footprint_add_polygon (fp, layer, count, &vertex_x, &vertex_y);
 
   for (i = 0; i < count; i++) {
-    double x, y;
-    if (!content_get_double (content, &x)) return 0;
-    if (!content_get_double (content, &y)) return 0;
-    printf ("("); print_coord (x);
-    printf (","); print_coord (y);  printf (")");
+    double x = vertex_x[i] = content_load_double (vertices + 16 * i);
+    double y = vertex_y[i] = content_load_double (vertices + 16 * i + 8);
+    log_trace ("("); print_coord (x);
+    log_trace (","); print_coord (y);  log_trace (")");
     if (i + 1 < count)
-      printf ("-");
+      log_trace ("-");
   }
-  printf ("\n");
+  log_trace ("\n");
 
   fields_length = record_length - string_length - 16 * count;
 
   if (fields_length >= 31) {
       if (!content_get_uint32 (content, &dw1)) return 0;
-      printf ("  DWORD %i\n", dw1);
+      log_trace ("  DWORD %i\n", dw1);
   }
 
   if (fields_length != 31 &&
-      fields_length != 27)
-    g_error ("Bad fields length %i\n", fields_length);
+      fields_length != 27) {
+    log_info ("Bad fields length %i\n", fields_length);
+    return 0;
+  }
 
   return 1;
 }
@@ -726,7 +678,7 @@ rotate_vector_backwards_degrees (double *x, double *y, double angle)
 
 
 static int
-decode_model_record (FILE *file, file_content *content, model_map *map)
+decode_model_record (footprint *fp, file_content *content, const model_map *map)
 {
   uint32_t record_length;
   uint8_t layer;
@@ -735,107 +687,104 @@ decode_model_record (FILE *file, file_content *content, model_map *map)
   uint32_t dw1;
   int32_t something;
   uint8_t byte;
-  char *parameter_string;
+  content_string parameter_string;
   size_t string_length;
   parameter_list *parameter_list;
   uint32_t count;
+  const char *vertices;
   int i;
-  char *model_id;
-  model_info *info;
+  const model_info *info;
   double ox, oy, oz;
   double ax, ay, az;
   double rx, ry, rz;
+  double origin[3], axis[3], ref[3];
   bool body_projection;
 
-  printf ("model\n");
+  log_trace ("model\n");
 
   if (!content_get_uint32 (content, &record_length)) return 0;
-  printf ("  Record length is %i\n", record_length);
+  log_trace ("  Record length is %i\n", record_length);
 
   if (!content_get_byte (content, &layer)) return 0;
-  printf ("  BYTE %i (model layer)\n", layer);
+  log_trace ("  BYTE %i (model layer)\n", layer);
 
   /* 57: Mechanical 1  -  Board Outline (along with the Keep-Out Layer, but that can be used for other things also)
    * 69: Mechanical 13 -  Top Layer Component Body Information (3D models and mechanical outlines) <paired with M14>
    */
 
   if (!content_get_uint16 (content, &w1)) return 0;
-  printf ("  WORD %i\n", w1);
+  log_trace ("  WORD %i\n", w1);
 
   if (!skip_10x_ff (content)) return 0;
 
   if (!content_get_int32 (content, &something)) return 0;
-  printf ("  Something: ");
-  print_coord (something); printf ("\n");
+  log_trace ("  Something: ");
+  print_coord (something); log_trace ("\n");
 
   if (!content_get_byte (content, &byte)) return 0;
-  printf ("  BYTE %i\n", byte);
+  log_trace ("  BYTE %i\n", byte);
 
-  parameter_string = content_get_length_dword_prefixed_string (content);
-  if (parameter_string == NULL)
-    return 0;
-  printf ("  Model parameter string: %s\n", parameter_string);
-  string_length = strlen (parameter_string);
+  if (!content_get_length_dword_prefixed_string_view (content, &parameter_string)) return 0;
+  log_trace ("  Model parameter string: %.*s\n", parameter_string.length, parameter_string.str);
+  string_length = parameter_string.length;
 
-  parameter_list = parameter_list_new_from_string (parameter_string);
-  g_free (parameter_string);
+  parameter_list = parameter_list_new_in_arena (fp->arena, parameter_string.str, parameter_string.length);
 
   if (!content_get_uint32 (content, &count)) return 0;
 
-  printf ("  Model outline (%i vertices): ", count);
+  log_trace ("  Model outline (%i vertices): ", count);
+
+  /* Only traced for now, so the vertices are just stepped over otherwise */
+  if ((vertices = content_take_array (content, count, 16)) == NULL) return 0;
 
   for (i = 0; i < count; i++) {
-    double x, y;
-    if (!content_get_double (content, &x)) return 0;
-    if (!content_get_double (content, &y)) return 0;
-    printf ("("); print_coord (x);
-    printf (","); print_coord (y);  printf (")");
+    double x = content_load_double (vertices + 16 * i);
+    double y = content_load_double (vertices + 16 * i + 8);
+    log_trace ("("); print_coord (x);
+    log_trace (","); print_coord (y);  log_trace (")");
     if (i + 1 < count)
-      printf ("-");
+      log_trace ("-");
   }
-  printf ("\n");
+  log_trace ("\n");
 
   fields_length = record_length - string_length - 16 * count;
 
   if (fields_length >= 31) {
     if (!content_get_uint32 (content, &dw1)) return 0;
-    printf ("  DWORD %i\n", dw1);
+    log_trace ("  DWORD %i\n", dw1);
   }
 
 //  if (fields_length >= 123) {
 //    content_skip_bytes (content, 28);
-//    printf ("  Skipped 28 bytes\n");
+//    log_trace ("  Skipped 28 bytes\n");
 //  }
 
   if (fields_length != 31 &&
-      fields_length != 27)
-    g_error ("Bad fields length %i\n", fields_length);
+      fields_length != 27) {
+    log_info ("Bad fields length %i\n", fields_length);
+    return 0;
+  }
 
 #if 0
   if (record_length - string_length == 111) {
     /* GOODNESS KNOWS */
     if (!content_get_uint32 (content, &dw1)) return 0;
-    printf ("  DWORD %i\n", dw1);
+    log_trace ("  DWORD %i\n", dw1);
   } else if (record_length - string_length == 95) {
     if (!content_get_uint32 (content, &dw1)) return 0;
-    printf ("  DWORD %i\n", dw1);
+    log_trace ("  DWORD %i\n", dw1);
   } else {
     g_assert (record_length - string_length == 91);
   }
 #endif
 
-  if (!parameter_list_get_bool (parameter_list, "MODEL.EMBED")) {
-    parameter_list_free (parameter_list);
+  if (!parameter_list_get_bool (parameter_list, "MODEL.EMBED"))
     return 1;
-  }
 
-  model_id = parameter_list_get_string (parameter_list, "MODELID");
-  info = model_map_find_by_id (map, model_id);
-  g_free (model_id);
+  info = model_map_find_by_id (map, parameter_list_peek_string (parameter_list, "MODELID"));
 
   if (info == NULL) {
-    printf ("XXX: DID NOT FIND MODEL ASSOCIATED WITH THIS MODELID\n");
-    parameter_list_free (parameter_list);
+    log_trace ("XXX: DID NOT FIND MODEL ASSOCIATED WITH THIS MODELID\n");
     return 0;
   }
 
@@ -850,11 +799,11 @@ decode_model_record (FILE *file, file_content *content, model_map *map)
 //  oy = -info->dy / 10000.; /* NB: Y doesn't exist in the model store */
 //  oz = -info->dz / 10000.;
 
-  printf ("Initial transform: O(%f,%f,%f) A(%f,%f,%f) R(%f,%f,%f)\n", ox, oy, oz, ax, ay, az, rx, ry, rz);
+  log_trace ("Initial transform: O(%f,%f,%f) A(%f,%f,%f) R(%f,%f,%f)\n", ox, oy, oz, ax, ay, az, rx, ry, rz);
 
-  printf ("rotx = %f\n", info->rotx);
-  printf ("roty = %f\n", info->roty);
-  printf ("rotz = %f\n", info->rotz);
+  log_trace ("rotx = %f\n", info->rotx);
+  log_trace ("roty = %f\n", info->roty);
+  log_trace ("rotz = %f\n", info->rotz);
 
   if (1) {
     int angle_count = ((fabs (info->rotx) > 0.01) ? 1 : 0) +
@@ -862,7 +811,7 @@ decode_model_record (FILE *file, file_content *content, model_map *map)
                       ((fabs (info->rotz) > 0.01) ? 1 : 0);
 
     if (angle_count > 1) {
-      printf ("MULTIPLE ROTATIONS SET  X: %f Y: %f Z: %f - CHECK ME!! %s\n", info->rotx, info->roty, info->rotz, info->filename);
+      log_trace ("MULTIPLE ROTATIONS SET  X: %f Y: %f Z: %f - CHECK ME!! %s\n", info->rotx, info->roty, info->rotz, info->filename);
 //      g_warning ("Multiple rotation angles set... X: %f Y: %f Z: %f erroring out for debug purposes", info->rotx, info->roty, info->rotz);
     }
   }
@@ -882,7 +831,7 @@ decode_model_record (FILE *file, file_content *content, model_map *map)
   rotate_vector_backwards_degrees (&ax, &ay, info->rotz);
   rotate_vector_backwards_degrees (&rx, &ry, info->rotz);
 
-  printf ("Rotated transform: O(%f,%f,%f) A(%f,%f,%f) R(%f,%f,%f)\n", ox, oy, oz, ax, ay, az, rx, ry, rz);
+  log_trace ("Rotated transform: O(%f,%f,%f) A(%f,%f,%f) R(%f,%f,%f)\n", ox, oy, oz, ax, ay, az, rx, ry, rz);
 
   ox += parameter_list_get_double (parameter_list, "MODEL.2D.X");  /* Why X positive? */
   oy -= parameter_list_get_double (parameter_list, "MODEL.2D.Y");  /* Why Y negative? */
@@ -929,53 +878,43 @@ decode_model_record (FILE *file, file_content *content, model_map *map)
 
   /* XXX: 2D rotation??? */
 
-  printf ("2D translated transform: O(%f,%f,%f) A(%f,%f,%f) R(%f,%f,%f)\n", ox, oy, oz, ax, ay, az, rx, ry, rz);
-
-  fprintf (file, "\tAttribute(\"PCB::3d_model::type\" \"%s\")\n", "STEP-AP214"); /* XXX: ASSUMED, BUT MAY NOT BE! */
-  fprintf (file, "\tAttribute(\"PCB::3d_model::filename\" \"%s/%s\")\n", g_get_current_dir(), info->filename); /* XXX: NEED TO FIX PCB SEARCH PATHS!!! */
-  fprintf (file, "\tAttribute(\"PCB::3d_model::origin\" \"%f mil %f mil %f mil\")\n", ox, oy, oz);
-  fprintf (file, "\tAttribute(\"PCB::3d_model::origin::X\" \"%f mil\")\n", ox);
-  fprintf (file, "\tAttribute(\"PCB::3d_model::origin::Y\" \"%f mil\")\n", oy);
-  fprintf (file, "\tAttribute(\"PCB::3d_model::origin::Z\" \"%f mil\")\n", oz);
-  fprintf (file, "\tAttribute(\"PCB::3d_model::axis\" \"%f %f %f\")\n", ax, ay, az);
-  fprintf (file, "\tAttribute(\"PCB::3d_model::axis::X\" \"%f\")\n", ax);
-  fprintf (file, "\tAttribute(\"PCB::3d_model::axis::Y\" \"%f\")\n", ay);
-  fprintf (file, "\tAttribute(\"PCB::3d_model::axis::Z\" \"%f\")\n", az);
-  fprintf (file, "\tAttribute(\"PCB::3d_model::ref_dir\" \"%f %f %f\")\n", rx, ry, rz);
-  fprintf (file, "\tAttribute(\"PCB::3d_model::ref_dir::X\" \"%f\")\n", rx);
-  fprintf (file, "\tAttribute(\"PCB::3d_model::ref_dir::Y\" \"%f\")\n", ry);
-  fprintf (file, "\tAttribute(\"PCB::3d_model::ref_dir::Z\" \"%f\")\n", rz);
-  fprintf (file, "\tAttribute(\"PCB::rotation\" \"0 degrees\")\n");
-
-  parameter_list_free (parameter_list);
+  log_trace ("2D translated transform: O(%f,%f,%f) A(%f,%f,%f) R(%f,%f,%f)\n", ox, oy, oz, ax, ay, az, rx, ry, rz);
+
+  origin[0] = ox; origin[1] = oy; origin[2] = oz;
+  axis[0] = ax;   axis[1] = ay;   axis[2] = az;
+  ref[0] = rx;    ref[1] = ry;    ref[2] = rz;
+
+  footprint_add_model (fp, info->filename, origin, axis, ref);
 
   return 1;
 }
 
 #if 0
 static int
-decode_record_15 (FILE *file, file_content *content)
+decode_record_15 (footprint *fp, file_content *content)
 {
   uint8_t byte;
   uint32_t dw1, dw2;
 
-  printf ("type 15 (unknown meaning)\n");
+  log_trace ("type 15 (unknown meaning)\n");
 
   g_assert_not_reached ();
 
   if (!content_get_byte (content, &byte)) return 0;
-  printf ("  BYTE %i", byte);
+  log_trace ("  BYTE %i", byte);
 
   if (!content_get_uint32 (content, &dw1)) return 0;
   if (!content_get_uint32 (content, &dw2)) return 0;
-  printf ("  DWORDS %i, %i\n", dw1, dw2);
+  log_trace ("  DWORDS %i, %i\n", dw1, dw2);
 
   return 1;
 }
 #endif
 
+#define PIN_GEOMETRY_SIZE 97
+
 static int
-decode_pin_record (FILE *file, file_content *content)
+decode_pin_record (footprint *fp, file_content *content)
 {
   uint8_t b1, b2, b3, b5, b6;
   uint8_t length_bytes;
@@ -987,8 +926,8 @@ decode_pin_record (FILE *file, file_content *content)
   uint8_t style1, style2, style3;
   int32_t pad, clear, mask, drill;
   uint32_t dw1, dw2, dw3, dw4, dw5;
-  char *name;
-  char *string;
+  content_string name;
+  content_string string;
   uint8_t byte;
   uint8_t layer;
   uint8_t to_layer = 0xFF;
@@ -997,103 +936,108 @@ decode_pin_record (FILE *file, file_content *content)
   bool pin_is_hole;
   bool pin_is_smd;
   uint32_t last_section_length;
+  const char *geometry;
 
-  printf ("pin\n");
+  log_trace ("pin\n");
 
-  if ((name = content_get_length_multi_prefixed_string (content)) == NULL) return 0; /* Most use this */
-  printf ("  Pin '%s'\n", name);
+  if (!content_get_length_multi_prefixed_string_view (content, &name)) return 0; /* Most use this */
+  log_trace ("  Pin '%.*s'\n", name.length, name.str);
 
   if (!content_get_byte (content, &b1)) return 0;
-  printf ("  BYTE %i\n", b1);
+  log_trace ("  BYTE %i\n", b1);
   if (!content_get_uint32 (content, &dw1)) return 0;
-  printf ("  DWORD %i\n", dw1);
+  log_trace ("  DWORD %i\n", dw1);
 
-  if ((string = content_get_length_multi_prefixed_string (content)) == NULL) return 0;
-  printf ("  Magic string '%s'\n", string);
-  g_free (string);
+  if (!content_get_length_multi_prefixed_string_view (content, &string)) return 0;
+  log_trace ("  Magic string '%.*s'\n", string.length, string.str);
 
   if (!content_get_uint32 (content, &dw1)) return 0;
-  printf ("  DWORD %i\n", dw1);
+  log_trace ("  DWORD %i\n", dw1);
 
   if (!content_get_byte (content, &b1)) return 0;
   if (!content_get_byte (content, &length_bytes)) return 0;  /* Some kind of length coding? */
-  printf ("  BYTES %i, %i\n", b1, length_bytes);
+  log_trace ("  BYTES %i, %i\n", b1, length_bytes);
 
   if (!content_get_uint16 (content, &w1)) return 0;
-  printf ("  WORD %i\n", w1);
+  log_trace ("  WORD %i\n", w1);
 
   if (!content_get_byte (content, &byte)) return 0;
-  printf ("  BYTE %i\n", byte);
+  log_trace ("  BYTE %i\n", byte);
 
   if (!content_get_byte (content, &layer)) return 0;
-  printf ("  BYTE %i (layer)\n", layer); /* Layer 74 seems to mean MUTLILAYER */
+  log_trace ("  BYTE %i (layer)\n", layer); /* Layer 74 seems to mean MUTLILAYER */
 
 //  if (!content_get_uint16 (content, &flags)) return 0;
-//  printf ("  WORDS %i %i\n", w1, flags);
+//  log_trace ("  WORDS %i %i\n", w1, flags);
 
   if (!content_get_uint16 (content, &type_word)) return 0;
-  printf ("  WORD %i\n", type_word);
+  log_trace ("  WORD %i\n", type_word);
 
   if (!skip_10x_ff (content)) return 0;
 
-  if (!content_get_int32 (content, &x)) return 0;
-  if (!content_get_int32 (content, &y)) return 0;
-  printf ("  Pin position (");
-  print_coord (x); printf (", ");
-  print_coord (y); printf (")\n");
-
-  if (!content_get_int32 (content, &c1)) return 0; /* $pos+44 in altium2kicad */
-  if (!content_get_int32 (content, &c2)) return 0; // 48
-  if (!content_get_int32 (content, &c3)) return 0; // 52
-  if (!content_get_int32 (content, &c4)) return 0; // 56
-  if (!content_get_int32 (content, &c5)) return 0; // 60
-  if (!content_get_int32 (content, &c6)) return 0; // 64
-  if (!content_get_int32 (content, &c7)) return 0; // 68
-
-  printf ("  c1: "); print_coord (c1);
-  printf (" c2: "); print_coord (c2);
-  printf (" c3: "); print_coord (c3);
-  printf (" c4: "); print_coord (c4);
-  printf (" c5: "); print_coord (c5);
-  printf (" c6: "); print_coord (c6);
-  printf (" c7: "); print_coord (c7); printf ("\n");
-
-  if (!content_get_byte (content, &style1)) return 0; // 72
-  if (!content_get_byte (content, &style2)) return 0; // 73
-  if (!content_get_byte (content, &style3)) return 0; // 74
-  printf ("  BYTES %i %i %i (Pad shape styles?)\n", style1, style2, style3);
-
-  if (!content_get_double (content, &angle)) return 0; // 75
-  printf ("  Rotation angle %f\n", angle);
-
-  if (!content_get_uint32 (content, &dw1)) return 0; // 83
-  if (!content_get_uint32 (content, &dw2)) return 0; // 87
-  if (!content_get_uint32 (content, &dw3)) return 0; // 91
-  printf ("  DWORDS %i, %i, %i\n", dw1, dw2, dw3);
-
-  if (!content_get_uint16 (content, &w1)) return 0; // 95
-  printf ("  WORD %i\n", w1);
-
-  if (!content_get_uint32 (content, &dw1)) return 0; // 97
-  if (!content_get_uint32 (content, &dw2)) return 0; // 101
-  if (!content_get_uint32 (content, &dw3)) return 0; // 105
-  if (!content_get_uint32 (content, &dw4)) return 0; // 109
-  if (!content_get_uint32 (content, &dw5)) return 0; // 113
-  printf ("  DWORDS %i, %i, %i, %i, %i\n", dw1, dw2, dw3, dw4, dw5);
-  printf ("  (as coords: ");
-  print_coord (dw1); printf (", ");
-  print_coord (dw2); printf (", ");
-  print_coord (dw3); printf (", ");
-  print_coord (dw4); printf (", ");
-  print_coord (dw5); printf (")\n");
-
-  if (!content_get_uint32 (content, &dw1)) return 0; // 117
-  if (!content_get_uint32 (content, &dw2)) return 0; // 121
-  if (!content_get_uint32 (content, &dw3)) return 0; // 125
-  if (!content_get_uint32 (content, &dw4)) return 0; // 129    **** altium2kicad has double "HOLEROTATION" at offset $pos+129 ****
-  printf ("  DWORDS %i, %i, %i, %i\n", dw1, dw2, dw3, dw4);
-
-  g_assert (dw4 == 0);
+  /* From here to the layer info is a fixed layout, taken in one go. The
+   * comments give offsets as $pos+N in altium2kicad.
+   */
+  if ((geometry = content_take (content, PIN_GEOMETRY_SIZE)) == NULL) return 0;
+
+  x = content_load_int32 (geometry + 0);      // 36
+  y = content_load_int32 (geometry + 4);      // 40
+  log_trace ("  Pin position (");
+  print_coord (x); log_trace (", ");
+  print_coord (y); log_trace (")\n");
+
+  c1 = content_load_int32 (geometry + 8);     // 44
+  c2 = content_load_int32 (geometry + 12);    // 48
+  c3 = content_load_int32 (geometry + 16);    // 52
+  c4 = content_load_int32 (geometry + 20);    // 56
+  c5 = content_load_int32 (geometry + 24);    // 60
+  c6 = content_load_int32 (geometry + 28);    // 64
+  c7 = content_load_int32 (geometry + 32);    // 68
+
+  log_trace ("  c1: "); print_coord (c1);
+  log_trace (" c2: "); print_coord (c2);
+  log_trace (" c3: "); print_coord (c3);
+  log_trace (" c4: "); print_coord (c4);
+  log_trace (" c5: "); print_coord (c5);
+  log_trace (" c6: "); print_coord (c6);
+  log_trace (" c7: "); print_coord (c7); log_trace ("\n");
+
+  style1 = content_load_byte (geometry + 36);  // 72
+  style2 = content_load_byte (geometry + 37);  // 73
+  style3 = content_load_byte (geometry + 38);  // 74
+  log_trace ("  BYTES %i %i %i (Pad shape styles?)\n", style1, style2, style3);
+
+  angle = content_load_double (geometry + 39); // 75
+  log_trace ("  Rotation angle %f\n", angle);
+
+  dw1 = content_load_uint32 (geometry + 47);   // 83
+  dw2 = content_load_uint32 (geometry + 51);   // 87
+  dw3 = content_load_uint32 (geometry + 55);   // 91
+  log_trace ("  DWORDS %i, %i, %i\n", dw1, dw2, dw3);
+
+  w1 = content_load_uint16 (geometry + 59);    // 95
+  log_trace ("  WORD %i\n", w1);
+
+  dw1 = content_load_uint32 (geometry + 61);   // 97
+  dw2 = content_load_uint32 (geometry + 65);   // 101
+  dw3 = content_load_uint32 (geometry + 69);   // 105
+  dw4 = content_load_uint32 (geometry + 73);   // 109
+  dw5 = content_load_uint32 (geometry + 77);   // 113
+  log_trace ("  DWORDS %i, %i, %i, %i, %i\n", dw1, dw2, dw3, dw4, dw5);
+  log_trace ("  (as coords: ");
+  print_coord (dw1); log_trace (", ");
+  print_coord (dw2); log_trace (", ");
+  print_coord (dw3); log_trace (", ");
+  print_coord (dw4); log_trace (", ");
+  print_coord (dw5); log_trace (")\n");
+
+  dw1 = content_load_uint32 (geometry + 81);   // 117
+  dw2 = content_load_uint32 (geometry + 85);   // 121
+  dw3 = content_load_uint32 (geometry + 89);   // 125
+  dw4 = content_load_uint32 (geometry + 93);   // 129    **** altium2kicad has double "HOLEROTATION" at offset $pos+129 ****
+  log_trace ("  DWORDS %i, %i, %i, %i\n", dw1, dw2, dw3, dw4);
+
+  RECORD_CHECK (dw4 == 0);
 
   if (length_bytes > 106) {
 
@@ -1101,7 +1045,7 @@ decode_pin_record (FILE *file, file_content *content)
       {
         /* XXX: Unsure if this should be above the supposed layer infos... */
         if (!content_get_uint32 (content, &dw1)) return 0;
-        printf ("  DWORD %i\n", dw1);
+        log_trace ("  DWORD %i\n", dw1);
 
         if (!content_get_byte (content, &to_layer)) return 0;
         if (!content_get_byte (content, &b2)) return 0;
@@ -1109,22 +1053,25 @@ decode_pin_record (FILE *file, file_content *content)
         if (!content_get_byte (content, &from_layer)) return 0;
         if (!content_get_byte (content, &b5)) return 0;
         if (!content_get_byte (content, &b6)) return 0;
-        printf ("BYTES %i, %i, %i, %i, %i, %i\n", to_layer, b2, b3, from_layer, b5, b6);
+        log_trace ("BYTES %i, %i, %i, %i, %i, %i\n", to_layer, b2, b3, from_layer, b5, b6);
       }
     else if (length_bytes == 114)
       {
         if (!content_get_uint32 (content, &dw1)) return 0;
-        printf ("  EXTRA END DWORD %i\n", dw1);
+        log_trace ("  EXTRA END DWORD %i\n", dw1);
       }
     else
       {
-        g_assert (length_bytes == 110); /* GUESS? */
+        RECORD_CHECK (length_bytes == 110); /* GUESS? */
       }
 
     if (!content_get_uint32 (content, &last_section_length)) return 0;
-      printf ("  DWORD %i (LAST SECTION LENGTH)\n", last_section_length);
+      log_trace ("  DWORD %i (LAST SECTION LENGTH)\n", last_section_length);
 
     if (last_section_length == 596 || last_section_length == 628) {
+      uint32_t stack_widths[29];
+      uint32_t stack_heights[29];
+      uint8_t stack_shapes[29];
       int i;
 
       /* ODD PAD WITH STACK INFO? - SEEMS TO BE MULTIPLES OF 29 RECORDS */
@@ -1140,65 +1087,67 @@ decode_pin_record (FILE *file, file_content *content)
       32x  00
 #endif
 
-      printf ("Remaining layer pad widths\n");
+      if (!content_get_uint32_array (content, stack_widths, 29)) return 0;
+      if (!content_get_uint32_array (content, stack_heights, 29)) return 0;
+      if (!content_get_byte_array (content, stack_shapes, 29)) return 0;
+
+      log_trace ("Remaining layer pad widths\n");
       for (i = 0; i < 29; i++) {
-        if (!content_get_uint32 (content, &dw1)) return 0;
-        printf ("  %i: ", i); print_coord (dw1); printf ("\n");
+        log_trace ("  %i: ", i); print_coord (stack_widths[i]); log_trace ("\n");
       }
-      printf ("Remaining layer pad heights\n");
+      log_trace ("Remaining layer pad heights\n");
       for (i = 0; i < 29; i++) {
-        if (!content_get_uint32 (content, &dw1)) return 0;
-        printf ("  %i: ", i); print_coord (dw1); printf ("\n");
+        log_trace ("  %i: ", i); print_coord (stack_heights[i]); log_trace ("\n");
       }
-      printf ("Remaining layer pad shapes\n");
+      log_trace ("Remaining layer pad shapes\n");
       for (i = 0; i < 29; i++) {
-        if (!content_get_byte (content, &b1)) return 0;
-        printf ("  %i: %i\n", i, b1);
+        log_trace ("  %i: %i\n", i, stack_shapes[i]);
       }
 
       if (!content_get_uint16 (content, &w1)) return 0;
-      printf ("  WORD %i\n", w1);
+      log_trace ("  WORD %i\n", w1);
       if (!content_get_uint32 (content, &dw1)) return 0;
-      printf ("  DWORD %i\n", dw1);
+      log_trace ("  DWORD %i\n", dw1);
       if (!content_get_double (content, &angle)) return 0;
-      printf ("  Rotation angle %f\n", angle);
+      log_trace ("  Rotation angle %f\n", angle);
 
       /* XXX: IS THIS A FIXED LENGTH SKIP, OR SHOULD WE LOOK AT THE LENGTH HEADER */
       content_skip_bytes (content,  257 + 32 + 32);
-      printf ("Skipped %i bytes\n", 2 + 269 + 32 + 32);
+      log_trace ("Skipped %i bytes\n", 2 + 269 + 32 + 32);
     } else if (last_section_length == 256) {
   //    g_warning ("*** NOT HANDLED PROPERLY YET ***");
   //    content_skip_bytes (content, 256);
-  //    printf ("  Skipped 256 bytes\n");
-      g_assert_not_reached ();
+  //    log_trace ("  Skipped 256 bytes\n");
+      log_info ("Pad stack section of length 256 isn't understood yet\n");
+      return 0;
     } else if (last_section_length == 0) {
-      printf ("NO MORE TO READ\n");
+      log_trace ("NO MORE TO READ\n");
     } else {
-      printf ("*** LAST SECTION LENGTH OF %i\n", last_section_length);
+      log_trace ("*** LAST SECTION LENGTH OF %i\n", last_section_length);
   //    g_assert_not_reached ();
     }
 
     if (last_section_length == 628) { /* 32 more bytes than we already read above with the 596 case */
       content_skip_bytes (content, 32);
-      printf ("  Skipped 32 bytes\n");
+      log_trace ("  Skipped 32 bytes\n");
     }
 
   } else {
-    g_assert (length_bytes == 106);
+    RECORD_CHECK (length_bytes == 106);
   }
 
 //  pin_is_round = (type_word & 8) == 0;
   pin_is_hole = (type_word & 8) == 0; /* TOTAL GUESS!! */
   pin_is_round = (style1 == 1); /* GUESS - PERHAPS 3 STYLES ARE FROM - INNER - TO (or some combinartion).. assume all same? */
-  g_assert (style1 == style2);
-  g_assert (style2 == style3);
+  RECORD_CHECK (style1 == style2);
+  RECORD_CHECK (style2 == style3);
 
   pin_is_smd = (to_layer == from_layer); /* GUESS? */
   pin_is_smd = (flags & 256) != 0;
   pin_is_smd = (layer != 74); /* GUESS? */
 
   if (!pin_is_smd) { //(pin_is_round) {
-    printf ("XXX: Assuming pin is round?\n");
+    log_trace ("XXX: Assuming pin is round?\n");
     pad = c1;        /* GUESS THIS IS X DIMENSION */
     clear = c3 - c1; /* GUESS */
     mask = c5;       /* GUESS */
@@ -1211,20 +1160,17 @@ decode_pin_record (FILE *file, file_content *content)
         drill > mask)
       mask = drill;
 
-    fprintf (file, "\tPin[");
-    fprint_coord (file, x);     fprintf (file, " ");
-    fprint_coord (file, -y);     fprintf (file, " ");
-    fprint_coord (file, pad);   fprintf (file, " ");
-    fprint_coord (file, clear); fprintf (file, " ");
-    fprint_coord (file, mask);  fprintf (file, " ");
-    fprint_coord (file, drill); fprintf (file, " ");
-    fprintf (file, "\"\" \"%s\" \"%s\"]\n", name, pin_is_hole ? "hole" : (pin_is_round ? "" : "square"));
+    footprint_add_pad (fp, layer, x, y, x, y, pad, clear, mask, drill,
+                       FOOTPRINT_PAD_PIN |
+                       (pin_is_hole ? FOOTPRINT_PAD_HOLE : 0) |
+                       (pin_is_round ? 0 : FOOTPRINT_PAD_SQUARE),
+                       name.str, name.length);
   } else {
     int32_t x1, y1, x2, y2;
     int32_t w, h;
     int32_t tx, ty;
 
-    printf ("XXX: Assuming \"pin\" is a rectangular pad?\n");
+    log_trace ("XXX: Assuming \"pin\" is a rectangular pad?\n");
 
     if (c1 > c2)
       {
@@ -1253,122 +1199,263 @@ decode_pin_record (FILE *file, file_content *content)
 
     /* XXX: If the pad is square, PCB can't represent its rotation! */
     if (!pin_is_round)
-      printf ("XXX: Assuming the pad is at zero angle!!!\n");
-
-    fprintf (file, "\tPad[");
-    fprint_coord (file, x1);     fprintf (file, " ");
-    fprint_coord (file, -y1);     fprintf (file, " ");
-    fprint_coord (file, x2);     fprintf (file, " ");
-    fprint_coord (file, -y2);     fprintf (file, " ");
-    fprint_coord (file, pad);   fprintf (file, " ");
-    fprint_coord (file, clear); fprintf (file, " ");
-    fprint_coord (file, mask);  fprintf (file, " ");
-    fprintf (file, "\"\" \"%s\" \"%s\"]\n", name, pin_is_round ? "" : "square");
-  }
+      log_trace ("XXX: Assuming the pad is at zero angle!!!\n");
 
-  g_free (name);
+    footprint_add_pad (fp, layer, x1, y1, x2, y2, pad, clear, mask, 0,
+                       pin_is_round ? 0 : FOOTPRINT_PAD_SQUARE,
+                       name.str, name.length);
+  }
 
   return 1;
 }
 
-void
-decode_pcblib_data (FILE *file, file_content *content, int expected_sections, model_map *map)
+/* What is known of each record type. After the type byte, a record is
+ * made of length prefixed blocks, so it can be stepped over without being
+ * understood. Types with no name aren't known to exist, and are assumed
+ * to be a single block, as all but pads and text are.
+ */
+typedef struct {
+  const char *name;
+  int n_blocks;
+} record_type_info;
+
+static const record_type_info record_type_table[PCBLIB_RECORD_TYPE_MAX + 1] = {
+  [1]  = {"arc",       1},
+  [2]  = {"pad",       6},
+  [3]  = {"via",       1},
+  [4]  = {"track",     1},
+  [5]  = {"text",      2},
+  [6]  = {"fill",      1},
+  [8]  = {"net",       1}, /* Never seen decoded, only skipped */
+  [9]  = {"component", 1}, /* Never seen decoded, only skipped */
+  [11] = {"region",    1},
+  [12] = {"body",      1},
+  [15] = {"fromto",    1}, /* Never seen decoded, only skipped */
+};
+
+const char *
+pcblib_record_type_name (int type)
 {
-  uint8_t byte;
-  int section_no = 0;
+  if (type < 0 || type > PCBLIB_RECORD_TYPE_MAX)
+    return NULL;
 
-  printf ("Decoding data stream\n");
+  return record_type_table[type].name;
+}
 
-  /* File starts with a footprint name header */
-  if (!decode_name (file, content))
-    goto error;
+/* Parse a comma separated list of record type names or numbers, e.g.
+ * "pad,track", into a mask with bit n set for type n.
+ */
+bool
+pcblib_parse_record_types (const char *list, guint32 *mask, GError **error)
+{
+  char **names;
+  int i;
+
+  *mask = 0;
+  names = g_strsplit (list, ",", -1);
+
+  for (i = 0; names[i] != NULL; i++) {
+    char *name = g_strstrip (names[i]);
+    char *end;
+    int type;
 
-  while (/*section_no < expected_sections + 1 &&*/ content->cursor < content->length) { /* RE: + 1 should we just pass the correct number? */
+    type = strtol (name, &end, 10);
+    if (end == name || *end != '\0') {
+      for (type = PCBLIB_RECORD_TYPE_MAX; type > 0; type--)
+        if (record_type_table[type].name != NULL &&
+            g_ascii_strcasecmp (record_type_table[type].name, name) == 0)
+          break;
+    }
 
-    uint32_t begin_cursor;
-    uint32_t end_cursor;
+    if (type <= 0 || type > PCBLIB_RECORD_TYPE_MAX ||
+        record_type_table[type].name == NULL) {
+      g_set_error (error, OPENALTIUM_ERROR, OPENALTIUM_ERROR_UNSUPPORTED,
+                   "Unknown record type '%s'", name);
+      g_strfreev (names);
+      return false;
+    }
 
-    if (!content_get_byte (content, &byte))
-      goto error;
+    *mask |= 1u << type;
+  }
 
-    begin_cursor = content->cursor;
+  g_strfreev (names);
+  return true;
+}
 
-    printf ("Decoding record at %#x (%i/%i) - ", begin_cursor - 1, section_no + 1, expected_sections);
-    if (section_no + 1 > expected_sections)
-      printf ("HMM... WHY ARE THERE EXTRA SECTIONS??\n");
+static bool
+skip_block (file_content *content)
+{
+  uint32_t block_length;
 
-    switch (byte) {
+  return content_get_uint32 (content, &block_length) &&
+         content_take (content, block_length) != NULL;
+}
 
-      case 1:
-        if (!decode_arc_record (file, content))
-          goto error;
-        break;
+/* Find where each record of a footprint's data stream lies, by hopping
+ * over their length prefixes; nothing is decoded. Returns a GArray of
+ * pcblib_record, or NULL if a known record runs past the end of the
+ * stream. If an unknown one does, it wasn't really a single block, and
+ * the records found before it are returned.
+ */
+GArray *
+pcblib_index_records (const file_content *content, GError **error)
+{
+  file_content scan = *content;
+  GArray *index;
 
-      case 2: /* Pad object? */
-        if (!decode_pin_record (file, content))
-          goto error;
-        break;
+  scan.cursor = 0;
 
-      case 3:
-        if (!decode_record_3 (file, content))
-          goto error;
-        break;
+  /* The stream starts with the footprint name, which isn't a record */
+  if (!skip_block (&scan)) {
+    g_set_error (error, OPENALTIUM_ERROR, OPENALTIUM_ERROR_FORMAT,
+                 "Footprint name header runs past the end of the data");
+    return NULL;
+  }
 
-      case 4:
-        if (!decode_silkline (file, content))
-          goto error;
-        break;
+  index = g_array_new (FALSE, FALSE, sizeof (pcblib_record));
 
-      case 5:
-        if (!decode_text_record (file, content))
-          goto error;
-        break;
+  while (scan.cursor < scan.length) {
+    pcblib_record record;
+    int i;
 
-      case 6:
-        if (!decode_rectangle_record (file, content))
-          goto error;
-        break;
+    record.offset = scan.cursor;
+    content_get_byte (&scan, &record.type);
 
-      case 11:
-        if (!decode_polygon_record (file, content))
-          goto error;
+    if (pcblib_record_type_name (record.type) == NULL) {
+      if (!skip_block (&scan)) {
+        log_info ("Unknown record type %i at position 0x%x can't be stepped over, "
+                  "ignoring the rest of the data\n", record.type, record.offset);
         break;
+      }
+    } else {
+      for (i = 0; i < record_type_table[record.type].n_blocks; i++) {
+        if (!skip_block (&scan)) {
+          g_set_error (error, OPENALTIUM_ERROR, OPENALTIUM_ERROR_FORMAT,
+                       "Record type %i at position 0x%x runs past the end of the data",
+                       record.type, record.offset);
+          g_array_free (index, TRUE);
+          return NULL;
+        }
+      }
+    }
 
-      case 12:
-        if (!decode_model_record (file, content, map))
-          goto error;
-        break;
+    record.length = scan.cursor - record.offset;
+    g_array_append_val (index, record);
+  }
+
+  return index;
+}
+
+G_STATIC_ASSERT (PCBLIB_RECORD_TYPE_MAX < STATS_RECORD_TYPES);
+
+/* Add a footprint's records to the totals for --stats */
+static void
+count_records (const GArray *index)
+{
+  stats_records records = {{0}};
+  int i;
 
+  for (i = 0; i < index->len; i++) {
+    const pcblib_record *record = &g_array_index (index, pcblib_record, i);
+
+    if (record->type >= STATS_RECORD_TYPES)
+      continue;
+
+    records.count[record->type]++;
+    records.bytes[record->type] += record->length;
+  }
+
+  stats_add_records (STATS_PCBLIB, &records);
+}
+
+/* Returns -1 if there is no decoder for the type */
+static int
+decode_record (footprint *fp, file_content *content, uint8_t type, const model_map *map)
+{
+  switch (type) {
+    case 1:  return decode_arc_record (fp, content);
+    case 2:  return decode_pin_record (fp, content);
+    case 3:  return decode_record_3 (fp, content);
+    case 4:  return decode_silkline (fp, content);
+    case 5:  return decode_text_record (fp, content);
+    case 6:  return decode_rectangle_record (fp, content);
+    case 11: return decode_polygon_record (fp, content);
+    case 12: return decode_model_record (fp, content, map);
 #if 0
-      case 15: /* FromTo object? */
-        if (!decode_record_15 (file, content))
-          goto error;
-        break;
+    case 15: return decode_record_15 (fp, content);
 #endif
+    default: return -1;
+  }
+}
 
-      //case 0: /* Track line segment? */
-      case 8: /* Net object? */
-      case 9: /* Component object? */
-      default:
-        printf ("Unknown section header %i at position 0x%x\n", byte,
-                content->cursor - 1);
-//        fprintf (stderr, "Unknown section header %i at position 0x%x\n", byte,
-//                 content->cursor - 1);
-        goto error;
-    }
+/* Decode a footprint's data stream into fp, adding to what is there. Only
+ * the record types in the record_types mask are decoded (all of them if
+ * it is 0), and types there is no decoder for are skipped.
+ *
+ * Returns false, with error set, at the first record which can't be
+ * decoded; what was added to fp up to then is incomplete.
+ */
+bool
+decode_pcblib_data (footprint *fp, file_content *content, int expected_sections,
+                    const model_map *map, guint32 record_types, GError **error)
+{
+  GArray *index;
+  int i;
+
+  log_trace ("Decoding data stream\n");
+
+  /* File starts with a footprint name header */
+  if (!decode_name (fp, content)) {
+    g_set_error (error, OPENALTIUM_ERROR, OPENALTIUM_ERROR_FORMAT,
+                 "Couldn't decode the footprint name header");
+    return false;
+  }
+
+  index = pcblib_index_records (content, error);
+  if (index == NULL)
+    return false;
 
-    end_cursor = content->cursor;
+  if (stats_enabled ())
+    count_records (index);
 
-    printf ("Section read %i bytes\n", end_cursor - begin_cursor);
+  if (index->len != expected_sections)
+    log_trace ("HMM... FOUND %u SECTIONS, EXPECTED %i\n", index->len, expected_sections);
 
-    section_no ++;
+  for (i = 0; i < index->len; i++) {
+    pcblib_record *record = &g_array_index (index, pcblib_record, i);
+    int decoded;
+
+    if (record_types != 0 &&
+        (record->type > PCBLIB_RECORD_TYPE_MAX || (record_types & (1u << record->type)) == 0))
+      continue;
+
+    log_trace ("Decoding record at %#x (%i/%i) - ", record->offset, i + 1, expected_sections);
+
+    content->cursor = record->offset + 1;
+    decoded = decode_record (fp, content, record->type, map);
+
+    if (decoded < 0) {
+      const char *name = pcblib_record_type_name (record->type);
+
+      log_info ("Skipping %s record (type %i) at position 0x%x, it can't be decoded yet\n",
+                (name != NULL) ? name : "unknown", record->type, record->offset);
+    } else if (!decoded) {
+      g_set_error (error, OPENALTIUM_ERROR, OPENALTIUM_ERROR_FORMAT,
+                   "Couldn't decode record type %i (section %i/%i) at position 0x%x",
+                   record->type, i + 1, expected_sections, record->offset);
+      g_array_free (index, TRUE);
+      return false;
+    } else if (content->cursor != record->offset + record->length) {
+      log_trace ("Section decoder read %i of %i bytes\n",
+                 content->cursor - record->offset, record->length);
+    } else {
+      log_trace ("Section read %i bytes\n", record->length - 1);
+    }
   }
 
-  return;
+  /* Whatever the decoders made of them, records end where their lengths say */
+  content->cursor = content->length;
+  g_array_free (index, TRUE);
 
-error:
-//  fprintf (stderr, "Oops\n");
-  printf ("Oops\n");
-  exit (-1);
-  return;
+  return true;
 }
@@ -18,4 +18,18 @@
  */
 
 
-void decode_pcblib_data (FILE *file, file_content *content, int expected_sections, model_map *map);
+/* Where a record of a footprint's data stream lies */
+typedef struct {
+  uint8_t type;
+  uint32_t offset;      /* Of the record's type byte */
+  uint32_t length;      /* Of the whole record, including the type byte */
+} pcblib_record;
+
+/* Record types are small, so a set of them fits in a guint32 mask */
+#define PCBLIB_RECORD_TYPE_MAX 31
+
+const char *pcblib_record_type_name (int type);
+GArray *pcblib_index_records (const file_content *content, GError **error);
+
+bool decode_pcblib_data (footprint *fp, file_content *content, int expected_sections,
+                         const model_map *map, guint32 record_types, GError **error);
@@ -19,42 +19,50 @@
 
 #include <stdint.h>
 #include <stdbool.h>
+#include <errno.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <getopt.h>
 #include <glib.h>
+#include <glib/gstdio.h>
 #include <gio/gio.h>
 #include <gsf/gsf.h>
 #include <gsf/gsf-input-stdio.h>
+#include <gsf/gsf-input-memory.h>
 #include <gsf/gsf-infile.h>
 #include <gsf/gsf-infile-msole.h>
 
 #include "content-parser.h"
+#include "cfb-reader.h"
+#include "arena.h"
 #include "parameters.h"
 #include "models.h"
+#include "model-cache.h"
+#include "model-extract.h"
+#include "options.h"
+#include "manifest.h"
+#include "openaltium-error.h"
 #include "pcblib.h"
+#include "output-writer.h"
+#include "footprint.h"
+#include "library-cache.h"
 #include "pcblib-data.h"
+#include "logging.h"
+#include "stats.h"
 
 
-/* XXX: DUPLICATE FROM pcblib-data.c */
-static void
-fprint_coord (FILE *file, int32_t coord)
-{
-//  fprintf (file, "%.2fmm", (double)coord / 1000000. * 2.54);
-  fprintf (file, "%.2fmil", (double)coord / 10000.);
-}
-
-
-static int
-check_gerror (GError *error) {
-  if (error != NULL) {
-    fprintf (stdout, "Error: %s\n", error->message);
-    g_error_free (error);
-    return 0;
-  }
-  return 1;
-}
+/* Where a library's streams are read from. The compound file's directory
+ * is indexed once up front, so each stream is found straight from its
+ * path, rather than libgsf comparing against every entry of each storage
+ * on the way. The index holds the whole file, so streams are views of it
+ * rather than copies. Files which can't be indexed are read through libgsf.
+ */
+typedef struct {
+  cfb_file *index;              /* NULL when reading through libgsf */
+  GsfInfile *root;              /* Only without an index */
+  GBytes *bytes;                /* A library in memory, held while libgsf reads it */
+} library_source;
 
 static file_content *
 input_to_content (GsfInput *input)
@@ -71,146 +79,403 @@ input_to_content (GsfInput *input)
     g_free (content);
     return NULL;
   }
+  /* The buffer belongs to the input, so keep that alive as long as the content */
+  content->bytes = g_bytes_new_with_free_func (content->data, content->length,
+                                               (GDestroyNotify) g_object_unref,
+                                               g_object_ref (input));
   return content;
 }
 
 static void
-input_decompress_to_file (GsfInput *input, const char *file)
+free_content (file_content *content)
 {
-  GZlibDecompressor *decomp;
-  GFile *gfile;
-  GFileOutputStream *file_os;
-  GOutputStream *decomp_os;
-  guint8 const *data;
-  gsf_off_t length;
-  gsize bytes_written;
-  GError *error = NULL;
-
-  decomp = g_zlib_decompressor_new (G_ZLIB_COMPRESSOR_FORMAT_ZLIB);
-  gfile = g_file_new_for_path (file);
-  g_file_delete (gfile, NULL, NULL);
-  file_os = g_file_create (gfile, G_FILE_CREATE_NONE, NULL, &error);
-  if (!check_gerror (error)) exit (-1);
-  decomp_os = g_converter_output_stream_new (G_OUTPUT_STREAM (file_os), G_CONVERTER (decomp));
-
-  length = gsf_input_size (input);
-  data = gsf_input_read (input, length, NULL);
-  if (data == NULL) {
-    fprintf (stdout, "Read error grabbing data\n");
-    return;
-  }
+  if (content->bytes != NULL)
+    g_bytes_unref (content->bytes);
+  g_free (content);
+}
+
+/* Index the directory of a library file, or open it through libgsf if
+ * that can't be done.
+ */
+static bool
+library_source_open_file (library_source *source, const char *filename, GError **error)
+{
+  GError *index_error = NULL;
+  GsfInput *input;
+
+  memset (source, 0, sizeof (*source));
+
+  source->index = cfb_file_open (filename, &index_error);
+  if (source->index != NULL)
+    return true;
+
+  log_info ("Couldn't index '%s' (%s), reading it through libgsf\n",
+            filename, index_error->message);
+  g_error_free (index_error);
+
+  input = gsf_input_stdio_new (filename, error);
+  if (input == NULL)
+    return false;
+
+  /* TODO: Check magic header? */
+
+  source->root = gsf_infile_msole_new (input, error);
+  g_object_unref (input);
 
-  g_output_stream_write_all (decomp_os, data, length, &bytes_written, NULL, NULL);
-  g_output_stream_close (decomp_os, NULL, NULL);
-  g_output_stream_close (G_OUTPUT_STREAM (file_os), NULL, NULL);
+  return source->root != NULL;
+}
+
+/* As library_source_open_file, for a library already held in memory */
+static bool
+library_source_open_bytes (library_source *source, GBytes *bytes, GError **error)
+{
+  GError *index_error = NULL;
+  GsfInput *input;
+  gsize length;
+  const guint8 *data;
+
+  memset (source, 0, sizeof (*source));
+
+  source->index = cfb_file_new_from_bytes (bytes, &index_error);
+  if (source->index != NULL)
+    return true;
+
+  log_info ("Couldn't index the library (%s), reading it through libgsf\n",
+            index_error->message);
+  g_error_free (index_error);
 
-  g_object_unref (decomp_os);
-  g_object_unref (file_os);
-  g_object_unref (gfile);
-  g_object_unref (decomp);
+  /* NB: The memory input doesn't own the buffer, we hold it until done */
+  source->bytes = g_bytes_ref (bytes);
+  data = g_bytes_get_data (bytes, &length);
+  input = gsf_input_memory_new (data, length, FALSE);
+
+  source->root = gsf_infile_msole_new (input, error);
+  g_object_unref (input);
+
+  return source->root != NULL;
 }
 
 static void
-free_content (file_content *content)
+library_source_close (library_source *source)
 {
-  g_free (content);
+  if (source->index != NULL)
+    cfb_file_free (source->index);
+  if (source->root != NULL)
+    g_object_unref (source->root);
+  if (source->bytes != NULL)
+    g_bytes_unref (source->bytes);
+}
+
+/* Open a storage or stream through libgsf by its path from the root,
+ * e.g. "Library/Data", NULL if it isn't there.
+ */
+static GsfInput *
+library_source_lookup (const library_source *source, const char *path)
+{
+  GsfInput *input;
+  char **names;
+
+  names = g_strsplit (path, "/", -1);
+  input = gsf_infile_child_by_aname (source->root, (const char **)names);
+  g_strfreev (names);
+
+  return input;
+}
+
+static bool
+library_source_has (const library_source *source, const char *path)
+{
+  GsfInput *input;
+
+  if (source->index != NULL)
+    return cfb_file_has_path (source->index, path);
+
+  input = library_source_lookup (source, path);
+  if (input == NULL)
+    return false;
+
+  g_object_unref (input);
+  return true;
 }
 
-static uint32_t
-parse_header (GsfInfile *dir)
+/* Read a stream by its path from the root, NULL if it isn't there */
+static file_content *
+library_source_read (const library_source *source, const char *path)
 {
-  GsfInput *header;
+  GsfInput *input;
   file_content *content;
-  uint32_t data;
+  gint64 start = stats_begin ();
 
-  header = gsf_infile_child_by_name (dir, "Header");
-  if (header == NULL) {
-    fprintf (stdout, "Error: Couldn't open 'Header' file\n");
-    exit (EXIT_FAILURE);
+  if (source->index != NULL) {
+    content = cfb_file_get_content (source->index, path);
+  } else {
+    input = library_source_lookup (source, path);
+    if (input == NULL)
+      return NULL;
+
+    content = input_to_content (input);
+    g_object_unref (input);
   }
 
-  content = input_to_content (header);
+  if (content != NULL)
+    stats_end (STATS_READ, start, content->length);
 
-  if (!content_get_uint32 (content, &data)) {
-    fprintf (stdout, "Error reading size from header\n");
-    exit (EXIT_FAILURE);
+  return content;
+}
+
+/* Read the record count from the Header stream of the storage at path */
+static bool
+parse_header (const library_source *source, const char *path, uint32_t *data, GError **error)
+{
+  file_content *content;
+  char *header_path;
+
+  header_path = g_strconcat (path, "/Header", NULL);
+  content = library_source_read (source, header_path);
+  g_free (header_path);
+
+  if (content == NULL) {
+    g_set_error (error, OPENALTIUM_ERROR, OPENALTIUM_ERROR_FORMAT,
+                 "Couldn't open '%s/Header' file", path);
+    return false;
+  }
+
+  if (!content_get_uint32 (content, data)) {
+    g_set_error (error, OPENALTIUM_ERROR, OPENALTIUM_ERROR_FORMAT,
+                 "Error reading size from '%s/Header'", path);
+    free_content (content);
+    return false;
   }
 
   free_content (content);
-  g_object_unref (header);
-  return data;
+  return true;
 }
 
+/* Everything needed to write out one footprint. The streams are read from
+ * the file up front on the calling thread (libgsf isn't thread safe), so
+ * the decoding and writing can then happen on any thread. The job itself
+ * is allocated from the library's arena.
+ */
+typedef struct {
+  char *resource_name;
+  uint32_t record_count;
+  file_content *content;        /* NULL if the resource couldn't be read, or once decoded */
+  const model_map *map;         /* Shared, read only */
+  const conversion_options *options;
+  guint64 fingerprint;          /* Of the footprint's data and the models, if needed */
+  bool current;                 /* Output is up to date, only decode it for the cache */
+  bool keep_footprint;          /* Hold on to the decoded footprint, to cache it */
+  footprint *fp;
+  GError *error;
+} footprint_job;
+
 static void
-parse_footprint_resource (FILE *file, GsfInfile *root, const char *resource_name, model_map *map)
+footprint_job_clear (footprint_job *job)
 {
-  GsfInfile *footprint;
-  uint32_t record_count;
-  GsfInput *data;
-  file_content *content;
+  if (job->content != NULL)
+    free_content (job->content);
+  if (job->fp != NULL)
+    footprint_free (job->fp);
+  if (job->error != NULL)
+    g_error_free (job->error);
+}
+
+static bool
+read_footprint_resource (const library_source *source, footprint_job *job, GError **error)
+{
+  char *data_path;
   char *outfile;
 
-  footprint = GSF_INFILE (gsf_infile_child_by_name (root, resource_name));
-  if (footprint == NULL) {
-    fprintf (stdout, "Error: Couldn't open footprint resource '%s' file\n", resource_name);
-    return;
+  if (!library_source_has (source, job->resource_name)) {
+    fprintf (stdout, "Error: Couldn't open footprint resource '%s' file\n", job->resource_name);
+    return true;
   }
 
-  record_count = parse_header (footprint);
-  printf ("Footprint data has %i record(s)\n", record_count);
+  if (!parse_header (source, job->resource_name, &job->record_count, error))
+    return false;
+  log_trace ("Footprint data has %i record(s)\n", job->record_count);
 
-  data = gsf_infile_child_by_name (footprint, "Data");
-  if (data == NULL) {
+  data_path = g_strconcat (job->resource_name, "/Data", NULL);
+  job->content = library_source_read (source, data_path);
+  g_free (data_path);
+
+  if (job->content == NULL) {
     fprintf (stdout, "Error: Couldn't open 'Data' file\n");
-    return;
+    return true;
   }
 
-  content = input_to_content (data);
-
   /* DEBUG */
-  outfile = g_strdup_printf ("%s.raw", resource_name);
-  g_file_set_contents (/*"Data.debug"*/outfile, content->data, content->length, NULL);
+  outfile = g_strdup_printf ("%s.raw", job->resource_name);
+  conversion_dump_raw (job->options, /*"Data.debug"*/outfile, job->content->data, job->content->length);
   g_free (outfile);
 
-  decode_pcblib_data (file, content, record_count, map);
-  free_content (content);
-  g_object_unref (data);
-  g_object_unref (footprint);
+  return true;
+}
+
+/* Write out a decoded footprint, and note it in the manifest */
+static bool
+emit_footprint (const conversion_options *options, const char *resource_name,
+                guint64 fingerprint, const footprint *fp, GError **error)
+{
+  char *outname;
+  output_writer *outfile;
+  gint64 start = stats_begin ();
+  bool ok;
+
+  outname = g_strdup_printf ("%s.fp", resource_name);
+  outfile = conversion_open_writer (options, outname, error);
+
+  if (outfile == NULL) {
+    g_free (outname);
+    return false;
+  }
+
+  footprint_write_pcb (outfile, fp);
+
+  ok = output_writer_close (outfile, error);
+  stats_end (STATS_OUTPUT, start, 0);
+
+  if (ok && options->manifest != NULL) {
+    char *key = g_strconcat ("footprint/", resource_name, NULL);
+    char *files[] = {outname, NULL};
+    conversion_manifest_record (options->manifest, key, fingerprint, files);
+    g_free (key);
+  }
+
+  g_free (outname);
+
+  return ok;
+}
+
+static bool
+write_footprint (footprint_job *job)
+{
+  footprint *fp;
+  gint64 start;
+  bool ok = true;
+
+  fp = footprint_new ();
+
+  if (job->content != NULL) {
+    start = stats_begin ();
+    ok = decode_pcblib_data (fp, job->content, job->record_count, job->map,
+                             job->options->record_types, &job->error);
+    stats_end (STATS_FOOTPRINTS, start, job->content->length);
+
+    /* Only the decoded footprint is kept, the stream is done with */
+    free_content (job->content);
+    job->content = NULL;
+
+    if (!ok) {
+      g_prefix_error (&job->error, "Footprint '%s': ", job->resource_name);
+      footprint_free (fp);
+      return false;
+    }
+  }
+
+  if (!job->current)
+    ok = emit_footprint (job->options, job->resource_name, job->fingerprint, fp, &job->error);
+
+  if (job->keep_footprint)
+    job->fp = fp;
+  else
+    footprint_free (fp);
+
+  return ok;
+}
+
+/* Whether the footprint was converted from the same data last time */
+static bool
+footprint_is_current (footprint_job *job)
+{
+  char *key;
+  bool current;
+
+  if (job->options->manifest == NULL || job->content == NULL)
+    return false;
+
+  key = g_strconcat ("footprint/", job->resource_name, NULL);
+  current = conversion_manifest_is_current (job->options->manifest, key, job->fingerprint);
+  g_free (key);
+
+  return current;
 }
 
+/* Footprints handed to the pool and not yet written. The library's
+ * streams are only read ahead of the threads by a few footprints, so they
+ * aren't all held in memory at once.
+ */
+typedef struct {
+  GMutex lock;
+  GCond done;
+  int pending;
+} footprint_queue;
+
+static void
+write_footprint_job (gpointer data, gpointer user_data)
+{
+  footprint_queue *queue = user_data;
+
+  write_footprint (data);
+
+  g_mutex_lock (&queue->lock);
+  queue->pending--;
+  g_cond_signal (&queue->done);
+  g_mutex_unlock (&queue->lock);
+}
+
+static void
+footprint_queue_push (GThreadPool *pool, footprint_queue *queue, footprint_job *job, int limit)
+{
+  g_mutex_lock (&queue->lock);
+  while (queue->pending >= limit)
+    g_cond_wait (&queue->done, &queue->lock);
+  queue->pending++;
+  g_mutex_unlock (&queue->lock);
+
+  g_thread_pool_push (pool, job, NULL);
+}
+
+/* Returns NULL with no error set if the library simply has no models.
+ * The models' STEP streams are handed to the extractor, which decides
+ * when they are written out. The footprints' output depends on the model
+ * records too, so their fingerprint is returned in models_fingerprint.
+ */
 static model_map *
-parse_library_models (GsfInfile *library)
+parse_library_models (const library_source *source, arena *arena, model_extractor *extractor,
+                      guint64 *models_fingerprint,
+                      const conversion_options *options, GError **error)
 {
   model_map *map;
-  GsfInfile *models;
-  GsfInput *data;
-  GsfInput *step;
   uint32_t record_count;
   file_content *content;
+  file_content *step;
   char *step_resource_string;
+  gint64 parameter_time = 0;
+  guint64 parameter_bytes = 0;
   int i;
 
-  models = GSF_INFILE (gsf_infile_child_by_name (library, "Models"));
-  if (models == NULL) {
+  if (!library_source_has (source, "Library/Models")) {
     fprintf (stdout, "Error: Couldn't open Models dir\n");
     return NULL;
   }
 
-  record_count = parse_header (models);
+  if (!parse_header (source, "Library/Models", &record_count, error))
+    return NULL;
 
-  data = gsf_infile_child_by_name (models, "Data");
-  if (data == NULL) {
+  content = library_source_read (source, "Library/Models/Data");
+  if (content == NULL) {
     fprintf (stdout, "Error: Couldn't open Models/Data file\n");
     return NULL;
   }
 
-  content = input_to_content (data);
+  *models_fingerprint = content_fingerprint (content, 0);
 
   map = model_map_new ();
 
   /* Write out the STEP files */
   for (i = 0; i < record_count; i++) {
-    char *parameter_string;
+    content_string parameter_string;
     parameter_list *parameter_list;
 #if 0
     char *model_filename;
@@ -221,16 +486,19 @@ parse_library_models (GsfInfile *library)
     unsigned int model_checksum;
 #endif
     model_info *info;
+    gint64 start;
+    char *path;
 
     /* XXX: Read each data record into a parameters list */
-    parameter_string = content_get_length_dword_prefixed_string (content);
-    if (parameter_string == NULL)
-      return map;
+    if (!content_get_length_dword_prefixed_string_view (content, &parameter_string))
+      break;
 
-    printf ("  Model %i parameter: %s\n", i, parameter_string);
+    log_trace ("  Model %i parameter: %.*s\n", i, parameter_string.length, parameter_string.str);
 
-    parameter_list = parameter_list_new_from_string (parameter_string);
-    g_free (parameter_string);
+    start = stats_begin ();
+    parameter_list = parameter_list_new_in_arena (arena, parameter_string.str, parameter_string.length);
+    parameter_time += stats_elapsed (start);
+    parameter_bytes += parameter_string.length;
 
 #if 0
     model_id =       parameter_list_get_string (parameter_list, "MODELID");
@@ -245,176 +513,442 @@ parse_library_models (GsfInfile *library)
     model_filename = parameter_list_get_string (parameter_list, "NAME");
 #endif
 
-    info = model_info_new_from_parameters (parameter_list);
-    parameter_list_free (parameter_list);
+    info = model_info_new_from_parameters (arena, parameter_list);
 
     model_map_insert (map, info);
 
-    step_resource_string = g_strdup_printf ("%i", i);
-    step = gsf_infile_child_by_name (GSF_INFILE (models), step_resource_string);
+    step_resource_string = g_strdup_printf ("Library/Models/%i", i);
+    step = library_source_read (source, step_resource_string);
     if (step == NULL) {
-      fprintf (stdout, "Error: Couldn't open STEP model %s\n", step_resource_string);
+      fprintf (stdout, "Error: Couldn't open STEP model %i\n", i);
       g_free (step_resource_string);
       continue;
     }
     g_free (step_resource_string);
-    input_decompress_to_file (step, info->filename);
-    g_object_unref (step);
+
+    /* The model is extracted next to the footprints, which refer to it
+     * by its bare filename.
+     */
+    path = conversion_output_path (options, info->filename);
+    info->path = arena_strdup (arena, path);
+    g_free (path);
+
+    model_extractor_add (extractor, info, step->bytes);
+    free_content (step);
   }
 
-  g_object_unref (data);
+  if (stats_enabled ())
+    stats_add (STATS_PARAMETERS, i, parameter_time, parameter_bytes);
+
+  free_content (content);
 
   return map;
 }
 
 /* Convert an Altium footprint name to the name of its resource in the file */
 static char *
-footprint_name_to_resource_name (const char *footprint_name)
+footprint_name_to_resource_name (arena *arena, const content_string *footprint_name)
 {
   /* Translitterate '/' to '_' */
-  return g_strdelimit (g_strdup (footprint_name), "/", '_');
+  return g_strdelimit (arena_strndup (arena, footprint_name->str, footprint_name->length), "/", '_');
 }
 
-static void
-parse_library_resource_data (GsfInfile *library, model_map *map)
+/* If cache is given, every footprint is kept once decoded, and they are
+ * all added to it if the whole library converted.
+ */
+static bool
+parse_library_resource_data (const library_source *source, arena *arena, const model_map *map,
+                             guint64 models_fingerprint, library_cache_writer *cache,
+                             const conversion_options *options, GError **error)
 {
-  GsfInfile *root;
-  GsfInput *data;
   file_content *content;
-  char *parameters;
+  content_string parameters;
   uint32_t num_footprints;
+  GPtrArray *jobs;
+  GThreadPool *pool = NULL;
+  footprint_queue queue = {0};
+  GError *first_error = NULL;
+  int failures = 0;
   int i;
-  char *outname;
-  FILE *outfile;
-  int32_t origin_x, origin_y;
+  bool ok = true;
 
-  root = gsf_input_container (GSF_INPUT (library));
-
-  data = gsf_infile_child_by_name (library, "Data");
-  if (data == NULL) {
-    fprintf (stdout, "Error: Couldn't open Library/Data file\n");
-    return;
+  content = library_source_read (source, "Library/Data");
+  if (content == NULL) {
+    g_set_error (error, OPENALTIUM_ERROR, OPENALTIUM_ERROR_FORMAT,
+                 "Couldn't open Library/Data file");
+    return false;
   }
 
-  content = input_to_content (data);
-
-  parameters = content_get_length_dword_prefixed_string (content);
-  if (parameters == NULL) {
-    fprintf (stdout, "Error getting parameters\n");
-    exit (EXIT_FAILURE);
+  if (!content_get_length_dword_prefixed_string_view (content, &parameters)) {
+    g_set_error (error, OPENALTIUM_ERROR, OPENALTIUM_ERROR_FORMAT,
+                 "Error getting parameters");
+    free_content (content);
+    return false;
   }
-  printf ("Parameters: '%s'\n", parameters);
+  log_trace ("Parameters: '%.*s'\n", parameters.length, parameters.str);
 
   if (!content_get_uint32 (content, &num_footprints)) {
-    fprintf (stdout, "Error getting num_footprints\n");
-    exit (EXIT_FAILURE);
+    g_set_error (error, OPENALTIUM_ERROR, OPENALTIUM_ERROR_FORMAT,
+                 "Error getting num_footprints");
+    free_content (content);
+    return false;
   }
 
+  /* Footprints are independent of each other, so once their data has been
+   * read they can be decoded on a pool of threads.
+   */
+  if (options->library_jobs > 1) {
+    g_mutex_init (&queue.lock);
+    g_cond_init (&queue.done);
+    pool = g_thread_pool_new (write_footprint_job, &queue, options->library_jobs, TRUE, error);
+    if (pool == NULL) {
+      g_cond_clear (&queue.done);
+      g_mutex_clear (&queue.lock);
+      free_content (content);
+      return false;
+    }
+  }
+
+  jobs = g_ptr_array_new_with_free_func ((GDestroyNotify) footprint_job_clear);
+
   for (i = 0; i < num_footprints; i++) {
-    char *footprint_name;
-    char *resource_name;
+    content_string footprint_name;
+    footprint_job *job;
+
+    if (!content_get_length_multi_prefixed_string_view (content, &footprint_name)) {
+      g_set_error (error, OPENALTIUM_ERROR, OPENALTIUM_ERROR_FORMAT,
+                   "Error getting footprint name %i", i + 1);
+      ok = false;
+      break;
+    }
+    log_info ("Footprint %i: '%.*s'\n", i + 1, footprint_name.length, footprint_name.str);
 
-    footprint_name = content_get_length_multi_prefixed_string (content);
-    if (footprint_name == NULL) {
-      fprintf (stdout, "Error getting footprint name\n");
-      exit (EXIT_FAILURE);
+    job = arena_new_struct (arena, footprint_job);
+    job->resource_name = footprint_name_to_resource_name (arena, &footprint_name);
+    job->map = map;
+    job->options = options;
+    job->keep_footprint = (cache != NULL);
+    g_ptr_array_add (jobs, job);
+
+    if (!read_footprint_resource (source, job, &job->error))
+      continue;
+
+    /* Which record types are converted changes the output too */
+    if (job->content != NULL && (options->manifest != NULL || cache != NULL))
+      job->fingerprint = content_fingerprint (job->content,
+                                              models_fingerprint ^ options->record_types);
+
+    if (footprint_is_current (job)) {
+      log_info ("Footprint '%s' is unchanged, skipping\n", job->resource_name);
+      job->current = true;
+
+      /* The cache needs every footprint, so it is still decoded */
+      if (cache == NULL) {
+        free_content (job->content);
+        job->content = NULL;
+        continue;
+      }
     }
-    printf ("Footprint %i: '%s'\n", i + 1, footprint_name);
-    resource_name = footprint_name_to_resource_name (footprint_name);
-    origin_x = 0;
-    origin_y = 0;
-
-    outname = g_strdup_printf ("%s.fp", resource_name);
-    outfile = fopen (outname, "w");
-    if (outfile == NULL) {
-      fprintf (stdout, "Error opening output file %s\n", outname);
-      exit (EXIT_FAILURE);
+
+    /* A footprint which fails only costs that footprint, the rest of
+     * the library is still converted.
+     */
+    if (pool != NULL)
+      footprint_queue_push (pool, &queue, job, 2 * options->library_jobs);
+    else
+      write_footprint (job);
+  }
+
+  /* Wait for the queued footprints to be written */
+  if (pool != NULL) {
+    g_thread_pool_free (pool, FALSE, TRUE);
+    g_cond_clear (&queue.done);
+    g_mutex_clear (&queue.lock);
+  }
+
+  /* Report the footprints which failed, the first one through error */
+  for (i = 0; i < jobs->len; i++) {
+    footprint_job *job = g_ptr_array_index (jobs, i);
+
+    if (job->error == NULL)
+      continue;
+
+    failures++;
+    if (first_error == NULL) {
+      first_error = job->error;
+      job->error = NULL;
+    } else {
+      fprintf (stdout, "Error: %s\n", job->error->message);
     }
-    g_free (outname);
+  }
+
+  if (first_error != NULL) {
+    if (ok) {
+      g_propagate_prefixed_error (error, first_error, "%i of %u footprint(s) failed. ",
+                                  failures, jobs->len);
+      ok = false;
+    } else {
+      fprintf (stdout, "Error: %s\n", first_error->message);
+      g_error_free (first_error);
+    }
+  }
+
+  /* Only once every footprint has been seen can the rest be known to be gone */
+  if (ok && options->manifest != NULL)
+    conversion_manifest_prune (options->manifest);
 
-    fprintf (outfile, "Element[\"\" \"\" \"\" \"\" ");
-    fprint_coord (outfile, origin_x); fprintf (outfile, " ");
-    fprint_coord (outfile, origin_y); fprintf (outfile, " ");
-    fprintf (outfile, "0.0 0.0 0 100 \"\"]\n");
-    fprintf (outfile, "(\n");
-    parse_footprint_resource (outfile, root, resource_name, map);
-    fprintf (outfile, ")\n");
-    fclose (outfile);
-    g_free (footprint_name);
-    g_free (resource_name);
+  if (ok && cache != NULL) {
+    for (i = 0; i < jobs->len; i++) {
+      footprint_job *job = g_ptr_array_index (jobs, i);
+      library_cache_writer_add (cache, job->resource_name, job->fingerprint, job->fp);
+    }
   }
 
+  g_ptr_array_unref (jobs);
   free_content (content);
-  g_object_unref (data);
+
+  return ok;
 }
 
 /* Spit out the data from the 'Library' resource */
-static void
-parse_library_resource (GsfInfile *root)
+static bool
+parse_library_resource (const library_source *source, library_cache_writer *cache,
+                        const conversion_options *options, GError **error)
 {
-  GsfInfile *library;
-
+  GError *tmp_error = NULL;
   uint32_t record_count;
+  model_extractor *extractor;
   model_map *map;
+  arena *arena;
+  guint64 models_fingerprint = 0;
+  gint64 start;
+  bool ok;
+
+  if (!library_source_has (source, "Library")) {
+    g_set_error (error, OPENALTIUM_ERROR, OPENALTIUM_ERROR_FORMAT,
+                 "Couldn't open Library dir");
+    return false;
+  }
+
+  if (!parse_header (source, "Library", &record_count, error))
+    return false;
+
+  if (record_count != 1) {
+    g_set_error (error, OPENALTIUM_ERROR, OPENALTIUM_ERROR_FORMAT,
+                 "Expected 1 record in Library/Header, found %u", record_count);
+    return false;
+  }
 
-  library = GSF_INFILE (gsf_infile_child_by_name (root, "Library"));
-  if (library == NULL) {
-    fprintf (stdout, "Error: Couldn't open Library dir\n");
-    return;
+  /* Unless all the models are wanted, they are only extracted as the
+   * footprints being written look them up.
+   */
+  extractor = model_extractor_new (options->library_jobs, !options->all_models,
+                                   options->model_cache, error);
+  if (extractor == NULL)
+    return false;
+
+  /* Everything decoded at the library level lives until it is closed */
+  arena = arena_new ();
+
+  start = stats_begin ();
+  map = parse_library_models (source, arena, extractor, &models_fingerprint, options, &tmp_error);
+  stats_end (STATS_MODELS, start, 0);
+  if (tmp_error != NULL) {
+    g_propagate_error (error, tmp_error);
+    model_extractor_finish (extractor, NULL);
+    arena_free (arena);
+    return false;
   }
 
-  record_count = parse_header (library);
-  g_return_if_fail (record_count == 1);
+  if (map != NULL)
+    model_map_set_extractor (map, extractor);
 
-  map = parse_library_models (library);
+  ok = parse_library_resource_data (source, arena, map, models_fingerprint, cache,
+                                    options, error);
 
-  parse_library_resource_data (library, map);
+  if (!model_extractor_finish (extractor, ok ? error : NULL))
+    ok = false;
 
   model_map_free (map);
+  arena_free (arena);
+
+  return ok;
 }
 
-static void
-parse_root (GsfInfile *root)
+/* Write the footprints out of a cached decode of the library. Returns false
+ * with no error set if the cache turned out to be unusable, e.g. as models
+ * it references have since been removed, so nothing was written.
+ */
+static bool
+write_cached_footprints (const library_cache *cache, const conversion_options *options,
+                         GError **error)
 {
-  int children;
-  int i;
-//  char *name;
-
-  children = gsf_infile_num_children (root);
-  for (i = 0; i < children; i++) {
-    GsfInput *input = gsf_infile_child_by_index (root, i);
-//    char const *name = gsf_input_name (input);
-    GsfInfile *child = GSF_IS_INFILE (input) ? GSF_INFILE (input) : NULL;
-    gboolean is_dir = (child != NULL) &&
-                      gsf_infile_num_children (child) > 0;
-    if (is_dir) {
-//      printf ("Decending into dir '%s'\n", name);
-      parse_root (child);
-//      printf ("Done with dir '%s'\n", name);
-//    } else {
-//      printf ("Child file '%s'\n", name);
+  GPtrArray *footprints;
+  GError *first_error = NULL;
+  int failures = 0;
+  guint n_footprints;
+  guint i, j;
+
+  n_footprints = library_cache_n_footprints (cache);
+  footprints = g_ptr_array_new_full (n_footprints, (GDestroyNotify) footprint_free);
+
+  for (i = 0; i < n_footprints; i++) {
+    footprint *fp = library_cache_load_footprint (cache, i);
+
+    if (fp == NULL || library_cache_footprint_name (cache, i) == NULL) {
+      log_info ("Library cache is damaged, decoding the library again\n");
+      if (fp != NULL)
+        footprint_free (fp);
+      g_ptr_array_unref (footprints);
+      return false;
+    }
+
+    for (j = 0; j < fp->models.len; j++) {
+      char *model = conversion_output_path (options, fp->models.filename[j]);
+      bool missing = !g_file_test (model, G_FILE_TEST_EXISTS);
+
+      if (missing)
+        log_info ("Model '%s' is missing, decoding the library again\n", model);
+      g_free (model);
+
+      if (missing) {
+        footprint_free (fp);
+        g_ptr_array_unref (footprints);
+        return false;
+      }
+    }
+
+    g_ptr_array_add (footprints, fp);
+  }
+
+  for (i = 0; i < n_footprints; i++) {
+    const char *name = library_cache_footprint_name (cache, i);
+    guint64 fingerprint = library_cache_footprint_fingerprint (cache, i);
+    GError *tmp_error = NULL;
+    char *key;
+    bool current = false;
+
+    if (options->manifest != NULL) {
+      key = g_strconcat ("footprint/", name, NULL);
+      current = conversion_manifest_is_current (options->manifest, key, fingerprint);
+      g_free (key);
+    }
+
+    if (current) {
+      log_info ("Footprint '%s' is unchanged, skipping\n", name);
+      continue;
+    }
+
+    log_info ("Footprint %u: '%s' (cached)\n", i + 1, name);
+
+    if (emit_footprint (options, name, fingerprint, g_ptr_array_index (footprints, i), &tmp_error))
+      continue;
+
+    failures++;
+    if (first_error == NULL) {
+      first_error = tmp_error;
+    } else {
+      fprintf (stdout, "Error: %s\n", tmp_error->message);
+      g_error_free (tmp_error);
     }
   }
+
+  g_ptr_array_unref (footprints);
+
+  if (first_error != NULL) {
+    g_propagate_prefixed_error (error, first_error, "%i of %u footprint(s) failed. ",
+                                failures, n_footprints);
+    return false;
+  }
+
+  if (options->manifest != NULL)
+    conversion_manifest_prune (options->manifest);
+
+  return true;
 }
 
-void
-parse_pcblib_file (char *filename)
+/* Convert a PcbLib file, writing the footprints and models into the
+ * options' output directory. Safe to call from several threads at once.
+ *
+ * With a decode cache, a library unchanged since it was last decoded is
+ * converted straight from the cache, without opening it at all. Raw dumps
+ * and extracting every model need the library itself, so skip the cache.
+ */
+bool
+parse_pcblib_file (const char *filename, const conversion_options *options, GError **error)
 {
-  GError *error = NULL;
-  GsfInput *input;
-  GsfInfile *root;
+  GError *cache_error = NULL;
+  library_source source;
+  gint64 start;
+  library_cache_writer *cache_writer = NULL;
+  char *cache_path = NULL;
+  bool ok;
+
+  if (options->decode_cache_dir != NULL &&
+      options->dump_raw_dir == NULL && !options->all_models) {
+    library_cache *cache;
+
+    cache_path = library_cache_path (options->decode_cache_dir, filename);
+    cache = library_cache_open (cache_path, filename, options->record_types);
+
+    if (cache != NULL) {
+      log_info ("Converting from library cache '%s'\n", cache_path);
+      ok = write_cached_footprints (cache, options, &cache_error);
+      library_cache_close (cache);
+
+      if (ok || cache_error != NULL) {
+        if (cache_error != NULL)
+          g_propagate_error (error, cache_error);
+        g_free (cache_path);
+        return ok;
+      }
+    }
 
-  input = gsf_input_stdio_new (filename, &error);
-  if (!check_gerror (error)) return;
+    cache_writer = library_cache_writer_new ();
+  }
 
-  /* TODO: Check magic header? */
+  start = stats_begin ();
+  ok = library_source_open_file (&source, filename, error);
+  stats_end (STATS_OPEN, start, 0);
 
-  root = gsf_infile_msole_new (input, &error);
-  g_object_unref (input);
-  if (!check_gerror (error)) return;
+  if (ok)
+    ok = parse_library_resource (&source, cache_writer, options, error);
+
+  library_source_close (&source);
+
+  /* Failing to save the cache only costs the next run some time */
+  if (ok && cache_writer != NULL &&
+      !library_cache_writer_save (cache_writer, cache_path, filename,
+                                  options->record_types, &cache_error)) {
+    log_info ("Couldn't save library cache: %s\n", cache_error->message);
+    g_error_free (cache_error);
+  }
+
+  library_cache_writer_free (cache_writer);
+  g_free (cache_path);
+
+  return ok;
+}
+
+/* As parse_pcblib_file, for a library already held in memory,
+ * e.g. one unpacked from an IntLib.
+ */
+bool
+parse_pcblib_bytes (GBytes *bytes, const conversion_options *options, GError **error)
+{
+  library_source source;
+  gint64 start;
+  bool ok;
+
+  start = stats_begin ();
+  ok = library_source_open_bytes (&source, bytes, error);
+  stats_end (STATS_OPEN, start, 0);
+
+  /* NB: There is no file to check a decode cache against */
+  if (ok)
+    ok = parse_library_resource (&source, NULL, options, error);
 
-  parse_root (root);
-  parse_library_resource (root);
+  library_source_close (&source);
 
-  g_object_unref (root);
+  return ok;
 }
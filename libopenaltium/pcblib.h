@@ -18,4 +18,6 @@
  */
 
 
-void parse_pcblib_file (char *filename);
+bool parse_pcblib_file (const char *filename, const conversion_options *options, GError **error);
+bool parse_pcblib_bytes (GBytes *bytes, const conversion_options *options, GError **error);
+bool pcblib_parse_record_types (const char *list, guint32 *mask, GError **error);
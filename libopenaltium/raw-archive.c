@@ -0,0 +1,173 @@
+/*
+ *  openaltium is a set of tools for opening Altium (TM) library files
+ *  Copyright (C) 2016  Peter Clifton <Peter.Clifton@clifton-electronics.co.uk>
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 2.1 of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this library; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <errno.h>
+#include <stdio.h>
+#include <string.h>
+#include <glib.h>
+#include <glib/gstdio.h>
+
+#include "openaltium-error.h"
+#include "raw-archive.h"
+
+
+#define TAR_BLOCK_SIZE 512
+#define TAR_NAME_SIZE 100
+#define RAW_ARCHIVE_BUFFER_SIZE (256 * 1024)
+
+/* POSIX ustar header, padded out to TAR_BLOCK_SIZE */
+typedef struct {
+  char name[TAR_NAME_SIZE];
+  char mode[8];
+  char uid[8];
+  char gid[8];
+  char size[12];
+  char mtime[12];
+  char chksum[8];
+  char typeflag;
+  char linkname[100];
+  char magic[6];
+  char version[2];
+  char uname[32];
+  char gname[32];
+  char devmajor[8];
+  char devminor[8];
+  char prefix[155];
+  char pad[12];
+} tar_header;
+
+struct raw_archive {
+  GMutex lock;          /* Footprints may be dumped from several threads */
+  FILE *file;
+  char *filename;
+  char *buffer;
+  uint32_t mtime;
+  bool write_failed;
+};
+
+
+raw_archive *
+raw_archive_open (const char *filename, GError **error)
+{
+  raw_archive *archive;
+  FILE *file;
+
+  file = g_fopen (filename, "wb");
+  if (file == NULL) {
+    int saved_errno = errno;
+    g_set_error (error, OPENALTIUM_ERROR, OPENALTIUM_ERROR_OUTPUT,
+                 "Error opening raw dump archive %s: %s", filename, g_strerror (saved_errno));
+    return NULL;
+  }
+
+  archive = g_slice_new0 (raw_archive);
+  g_mutex_init (&archive->lock);
+  archive->file = file;
+  archive->filename = g_strdup (filename);
+  archive->mtime = g_get_real_time () / G_USEC_PER_SEC;
+
+  /* Lots of small members, so let them accumulate before hitting the disk */
+  archive->buffer = g_malloc (RAW_ARCHIVE_BUFFER_SIZE);
+  setvbuf (file, archive->buffer, _IOFBF, RAW_ARCHIVE_BUFFER_SIZE);
+
+  return archive;
+}
+
+static void
+write_padded (raw_archive *archive, const char *data, gsize length)
+{
+  static const char zeros[TAR_BLOCK_SIZE] = {0};
+  gsize padding = (TAR_BLOCK_SIZE - length % TAR_BLOCK_SIZE) % TAR_BLOCK_SIZE;
+
+  if (fwrite (data, 1, length, archive->file) != length ||
+      fwrite (zeros, 1, padding, archive->file) != padding)
+    archive->write_failed = true;
+}
+
+static void
+write_header (raw_archive *archive, const char *name, char typeflag, gsize length)
+{
+  tar_header header;
+  const unsigned char *bytes = (const unsigned char *)&header;
+  unsigned int checksum = 0;
+  int i;
+
+  memset (&header, 0, sizeof (header));
+  strncpy (header.name, name, sizeof (header.name));
+  g_snprintf (header.mode, sizeof (header.mode), "%07o", 0644);
+  g_snprintf (header.uid, sizeof (header.uid), "%07o", 0);
+  g_snprintf (header.gid, sizeof (header.gid), "%07o", 0);
+  g_snprintf (header.size, sizeof (header.size), "%011lo", (unsigned long)length);
+  g_snprintf (header.mtime, sizeof (header.mtime), "%011lo", (unsigned long)archive->mtime);
+  header.typeflag = typeflag;
+  memcpy (header.magic, "ustar", 6);
+  memcpy (header.version, "00", 2);
+
+  /* The checksum is calculated with its own field filled with spaces */
+  memset (header.chksum, ' ', sizeof (header.chksum));
+  for (i = 0; i < sizeof (header); i++)
+    checksum += bytes[i];
+  g_snprintf (header.chksum, sizeof (header.chksum), "%06o", checksum);
+  header.chksum[7] = ' ';
+
+  write_padded (archive, (const char *)&header, sizeof (header));
+}
+
+/* Append a member to the archive. Write errors are reported when closing. */
+void
+raw_archive_add (raw_archive *archive, const char *name, const char *data, gsize length)
+{
+  gsize name_length = strlen (name);
+
+  g_mutex_lock (&archive->lock);
+
+  /* Names too long for the header go in a GNU long name member first */
+  if (name_length >= TAR_NAME_SIZE) {
+    write_header (archive, "././@LongLink", 'L', name_length + 1);
+    write_padded (archive, name, name_length + 1);
+  }
+
+  write_header (archive, name, '0', length);
+  write_padded (archive, data, length);
+
+  g_mutex_unlock (&archive->lock);
+}
+
+bool
+raw_archive_close (raw_archive *archive, GError **error)
+{
+  static const char end_of_archive[2 * TAR_BLOCK_SIZE] = {0};
+  bool ok;
+
+  write_padded (archive, end_of_archive, sizeof (end_of_archive));
+  ok = (fclose (archive->file) == 0) && !archive->write_failed;
+
+  if (!ok)
+    g_set_error (error, OPENALTIUM_ERROR, OPENALTIUM_ERROR_OUTPUT,
+                 "Error writing raw dump archive %s", archive->filename);
+
+  g_mutex_clear (&archive->lock);
+  g_free (archive->buffer);
+  g_free (archive->filename);
+  g_slice_free (raw_archive, archive);
+
+  return ok;
+}
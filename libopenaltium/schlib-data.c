@@ -26,12 +26,18 @@
 #include <string.h>
 
 #include "content-parser.h"
+#include "arena.h"
 #include "parameters.h"
 #include "models.h"
+#include "output-writer.h"
+#include "schlib-data.h"
+#include "openaltium-error.h"
+#include "logging.h"
+#include "stats.h"
 
 
 static int
-decode_binary_record (FILE *file, file_content *content, int part)
+decode_binary_record (output_writer **files, int partcount, file_content *content)
 {
   uint32_t record_length;
   uint8_t type;
@@ -41,63 +47,64 @@ decode_binary_record (FILE *file, file_content *content, int part)
   uint8_t angle;
   int16_t w1, w2, w3, w4, w5;
   uint8_t string_length;
-  char *pin_notes;
-  char *pin_label;
-  char *pin_number;
-  char *string3;
-  char *string4;
-  char *string5;
+  content_string pin_notes = {"", 0};
+  content_string pin_label = {"", 0};
+  content_string pin_number = {"", 0};
+  content_string string3 = {"", 0};
+  content_string string4 = {"", 0};
+  content_string string5 = {"", 0};
   int text_size = 10;
 
   double x, y;
   double x1, y1;
   double x2, y2;
   int color_index = 1; /* PIN COLOR - GSCHEM DOESN'T SUPPORT ARBITRARY COLOURS */
+  int part;
 
-  printf ("Binary record (pin?)\n");
+  log_trace ("Binary record (pin?)\n");
 
   content_get_uint32 (content, &record_length);
 
   type = record_length >> 24;
   record_length &= 0x00FFFFFF;
 
-  printf ("Binary record type %i, length %i\n", type, record_length);
+  log_trace ("Binary record type %i, length %i\n", type, record_length);
 
   content_get_byte (content, &b1);
-  printf ("  BYTE %i\n", b1);
+  log_trace ("  BYTE %i\n", b1);
 
   content_get_uint32 (content, &dw1);
-  printf ("  DWORD %i\n", dw1);
+  log_trace ("  DWORD %i\n", dw1);
 
   content_get_uint32 (content, &owner_part);
-  printf ("  DWORD %i (owner part)\n", owner_part);
+  log_trace ("  DWORD %i (owner part)\n", owner_part);
 
 //  content_get_uint32 (content, &dw3);
-//  printf ("  DWORD %i\n", dw3);
+//  log_trace ("  DWORD %i\n", dw3);
 
   content_get_byte (content, &b1);
-  printf ("  BYTE %i\n", b1);
+  log_trace ("  BYTE %i\n", b1);
   content_get_byte (content, &b1);
-  printf ("  BYTE %i\n", b1);
+  log_trace ("  BYTE %i\n", b1);
   content_get_byte (content, &b1);
-  printf ("  BYTE %i\n", b1);
+  log_trace ("  BYTE %i\n", b1);
 
   content_get_byte (content, &string_length);
-  pin_notes = content_get_n_chars (content, string_length);
-  printf ("  STRING '%s'\n", pin_notes);
+  content_get_n_chars_view (content, string_length, &pin_notes);
+  log_trace ("  STRING '%.*s'\n", pin_notes.length, pin_notes.str);
 
   content_get_byte (content, &b2);
-  printf ("  BYTE %i\n", b2); /* ONLY SEEN 1 */
+  log_trace ("  BYTE %i\n", b2); /* ONLY SEEN 1 */
 
 #if 1
   content_get_byte (content, &b3);
-  printf ("  BYTE %i\n", b3); /* SEEN 4 and 7 */
+  log_trace ("  BYTE %i\n", b3); /* SEEN 4 and 7 */
 
   content_get_byte (content, &b4);
-  printf ("  BYTE %i (could this be pin rotation?)\n", b4); /* SEEN 0x20 0x22 0x28 0x2A 0x30 0x31 0x32 0x33 0x38 0x3A */
+  log_trace ("  BYTE %i (could this be pin rotation?)\n", b4); /* SEEN 0x20 0x22 0x28 0x2A 0x30 0x31 0x32 0x33 0x38 0x3A */
 #else
   content_get_int16 (content, &w1);
-  printf ("  WORD %i\n", w1);
+  log_trace ("  WORD %i\n", w1);
 #endif
 
   content_get_int16 (content, &w1);
@@ -105,31 +112,31 @@ decode_binary_record (FILE *file, file_content *content, int part)
   content_get_int16 (content, &w3);
   content_get_int16 (content, &w4);
   content_get_int16 (content, &w5);
-  printf ("  WORDS %i, %i, %i, %i, %i\n", w1, w2, w3, w4, w5);
+  log_trace ("  WORDS %i, %i, %i, %i, %i\n", w1, w2, w3, w4, w5);
 
   content_get_byte (content, &string_length);
-  pin_label = content_get_n_chars (content, string_length);
-  printf ("  STRING '%s'\n", pin_label);
+  content_get_n_chars_view (content, string_length, &pin_label);
+  log_trace ("  STRING '%.*s'\n", pin_label.length, pin_label.str);
 
   content_get_byte (content, &string_length);
-  pin_number = content_get_n_chars (content, string_length);
-  printf ("  STRING '%s'\n", pin_number);
+  content_get_n_chars_view (content, string_length, &pin_number);
+  log_trace ("  STRING '%.*s'\n", pin_number.length, pin_number.str);
 
   content_get_byte (content, &string_length);
-  string3 = content_get_n_chars (content, string_length);
-  printf ("  STRING '%s'\n", string3);
+  content_get_n_chars_view (content, string_length, &string3);
+  log_trace ("  STRING '%.*s'\n", string3.length, string3.str);
 
   content_get_byte (content, &string_length);
-  string4 = content_get_n_chars (content, string_length);
-  printf ("  STRING '%s'\n", string4);
+  content_get_n_chars_view (content, string_length, &string4);
+  log_trace ("  STRING '%.*s'\n", string4.length, string4.str);
 
   content_get_byte (content, &string_length);
-  printf ("string_length is %i\n", string_length);
-  string5 = content_get_n_chars (content, string_length);
-  printf ("  STRING '%s'\n", string5);
+  log_trace ("string_length is %i\n", string_length);
+  content_get_n_chars_view (content, string_length, &string5);
+  log_trace ("  STRING '%.*s'\n", string5.length, string5.str);
 
 //  content_get_byte (content, &b5);
-//  printf ("  BYTE %i\n", b5);
+//  log_trace ("  BYTE %i\n", b5);
 
   /* Angle looks like:
    * b4 & 0x3 == 0: right
@@ -176,77 +183,78 @@ decode_binary_record (FILE *file, file_content *content, int part)
       break;
   }
 
-  if (owner_part >= 1 && part != owner_part) {
-    printf ("Skipping binary record which does not apply to our part\n");
-    return 1;
-  }
-
-  fprintf (file, "P %i %i %i %i %i %i %i # Original orientation %#x\n",
-           (int)x1, (int)y1,
-           (int)x2, (int)y2,
-           color_index,
-           0 /* NORMAL PIN */,
-           0 /* WHICH END */,
-           b4);
+  if (owner_part >= 1 && owner_part > partcount)
+    log_trace ("Skipping binary record which does not apply to any of our parts\n");
 
-  fprintf (file, "{\n");
+  /* Emit into every part this record belongs to */
+  for (part = 1; part <= partcount; part++) {
+    output_writer *file = files[part - 1];
 
-  x = x1 + 50;
-  y = y1 + 50;
-  fprintf (file, "T %i %i %i %i %i %i %i %i %i\n",
-           (int)x, (int)y,
-           3 /* GRAPHIC COLOR INDEX */,
-           text_size,
-           1 /* VISIBLE */,
-           1 /* SHOW NAME ONLY */,
-           0 /* ANGLE */,
-           0 /* ALIGNMENT */,
-           1);
-  fprintf (file, "pinlabel=%s\n", pin_label);
-
-  x = x1 - 50;
-  y = y1 + 50;
-  fprintf (file, "T %i %i %i %i %i %i %i %i %i\n",
-           (int)x, (int)y,
-           5 /* ATTRIBUTE COLOR INDEX */,
-           text_size,
-           1 /* VISIBLE */,
-           1 /* SHOW NAME ONLY */,
-           0 /* ANGLE */,
-           6 /* ALIGNMENT */,
-           1);
-  fprintf (file, "pinnumber=%s\n", pin_number);
+    if (owner_part >= 1 && part != owner_part)
+      continue;
 
-  fprintf (file, "}\n");
+    output_printf (file, "P %i %i %i %i %i %i %i # Original orientation %#x\n",
+             (int)x1, (int)y1,
+             (int)x2, (int)y2,
+             color_index,
+             0 /* NORMAL PIN */,
+             0 /* WHICH END */,
+             b4);
+
+    output_puts (file, "{\n");
+
+    x = x1 + 50;
+    y = y1 + 50;
+    output_printf (file, "T %i %i %i %i %i %i %i %i %i\n",
+             (int)x, (int)y,
+             3 /* GRAPHIC COLOR INDEX */,
+             text_size,
+             1 /* VISIBLE */,
+             1 /* SHOW NAME ONLY */,
+             0 /* ANGLE */,
+             0 /* ALIGNMENT */,
+             1);
+    output_printf (file, "pinlabel=%.*s\n", pin_label.length, pin_label.str);
+
+    x = x1 - 50;
+    y = y1 + 50;
+    output_printf (file, "T %i %i %i %i %i %i %i %i %i\n",
+             (int)x, (int)y,
+             5 /* ATTRIBUTE COLOR INDEX */,
+             text_size,
+             1 /* VISIBLE */,
+             1 /* SHOW NAME ONLY */,
+             0 /* ANGLE */,
+             6 /* ALIGNMENT */,
+             1);
+    output_printf (file, "pinnumber=%.*s\n", pin_number.length, pin_number.str);
+
+    output_puts (file, "}\n");
+  }
 
-  g_free (pin_notes);
-  g_free (pin_label);
-  g_free (pin_number);
 
   return 1;
 }
 
 static int
-decode_record_1 (FILE *file, parameter_list *params)
+decode_record_1 (output_writer *file, parameter_list *params)
 {
-  char *libreference;
-  char *description;
+  const char *libreference;
+  const char *description;
 
-  printf ("Record 1\n");
+  log_trace ("Record 1\n");
 
-  libreference = parameter_list_get_string (params, "LIBREFERENCE");
-  fprintf (file, "#LIBREFERENCE=%s\n", libreference);
-  g_free (libreference);
+  libreference = parameter_list_peek_string (params, "LIBREFERENCE");
+  output_printf (file, "#LIBREFERENCE=%s\n", libreference);
 
-  description = parameter_list_get_string (params, "%UTF8%COMPONENTDESCRIPTION");
-  fprintf (file, "#DESCRIPTION=%s\n", description);
-  g_free (description);
+  description = parameter_list_peek_string (params, "%UTF8%COMPONENTDESCRIPTION");
+  output_printf (file, "#DESCRIPTION=%s\n", description);
 
   return 1;
 }
 
 static int
-decode_record_3 (FILE *file, parameter_list *params)
+decode_record_3 (output_writer *file, parameter_list *params)
 {
   double x;
   double y;
@@ -257,7 +265,7 @@ decode_record_3 (FILE *file, parameter_list *params)
   int size = 10; /* PLACEHOLDER - NEED TO CROSS-REF FONT SETUP IN HEADERS?? */
   bool hidden;
 
-  printf ("Record 3 - symbol?\n"); /* XXX: Need to implement something! */
+  log_trace ("Record 3 - symbol?\n"); /* XXX: Need to implement something! */
 
   x = parameter_list_get_double (params, "LOCATION.X") * 20. + parameter_list_get_double (params, "LOCATION.X_FRAC") * 20. / 100000.;
   y = parameter_list_get_double (params, "LOCATION.Y") * 20. + parameter_list_get_double (params, "LOCATION.Y_FRAC") * 20. / 100000.;
@@ -267,7 +275,7 @@ decode_record_3 (FILE *file, parameter_list *params)
 
   hidden = false;
 
-  fprintf (file, "T %i %i %i %i %i %i %i %i %i\n",
+  output_printf (file, "T %i %i %i %i %i %i %i %i %i\n",
            (int)x, (int)y,
            color_index,
            size,
@@ -276,15 +284,15 @@ decode_record_3 (FILE *file, parameter_list *params)
            0 /* ANGLE */,
            0 /* ALIGNMENT */,
            1);
-  fprintf (file, "*%i*\n", symbol);
+  output_printf (file, "*%i*\n", symbol);
 
   return 1;
 }
 
 static int
-decode_record_4 (FILE *file, parameter_list *params)
+decode_record_4 (output_writer *file, parameter_list *params)
 {
-  char *text;
+  const char *text;
   double x;
   double y;
   int color_index = 9; /* TEXT COLOR - GSCHEM DOESN'T SUPPORT ARBITRARY COLOURS */
@@ -293,16 +301,16 @@ decode_record_4 (FILE *file, parameter_list *params)
 //  int justification;
   int num_lines;
 
-  printf ("Record 4 - label / attribute?\n");
+  log_trace ("Record 4 - label / attribute?\n");
 
   x = parameter_list_get_double (params, "LOCATION.X") * 20. + parameter_list_get_double (params, "LOCATION.X_FRAC") * 20. / 100000.;
   y = parameter_list_get_double (params, "LOCATION.Y") * 20. + parameter_list_get_double (params, "LOCATION.Y_FRAC") * 20. / 100000.;
-  text = parameter_list_get_string (params, "%UTF8%TEXT");
+  text = parameter_list_peek_string (params, "%UTF8%TEXT");
   hidden = false;
 //  justification = parameter_list_get_int (params, "JUSTIFICATION"); /* XXX: NEED TO MAP THIS TO GSCHEM POSITIONS */
   num_lines = 1; /* XXX: NEED TO COUNT NEWLINES IN THE STRING? */
 
-  fprintf (file, "T %i %i %i %i %i %i %i %i %i\n",
+  output_printf (file, "T %i %i %i %i %i %i %i %i %i\n",
            (int)x, (int)y,
            color_index,
            size,
@@ -311,15 +319,13 @@ decode_record_4 (FILE *file, parameter_list *params)
            0 /* ANGLE */,
            0 /* ALIGNMENT */,
            num_lines);
-  fprintf (file, "%s\n", text);
-
-  g_free (text);
+  output_printf (file, "%s\n", text);
 
   return 1;
 }
 
 static int
-decode_record_5 (FILE *file, parameter_list *params)
+decode_record_5 (output_writer *file, parameter_list *params)
 {
   int locationcount;
   int i;
@@ -331,13 +337,13 @@ decode_record_5 (FILE *file, parameter_list *params)
   double dashspace = 0.; /* XXX */
 
 
-  printf ("Record 5 - bezier-curve / path?\n"); /* Bezier curve according to kicad2altium */
+  log_trace ("Record 5 - bezier-curve / path?\n"); /* Bezier curve according to kicad2altium */
 
   locationcount = parameter_list_get_int (params, "LOCATIONCOUNT");
   linewidth = parameter_list_get_double (params, "LINEWIDTH") * 20.;
   if (linewidth <= 0) linewidth = 1;
 
-  fprintf (file, "H %i %i %i %i %i %i %i %i %i %i %i %i %i # FROM RECORD=5\n",
+  output_printf (file, "H %i %i %i %i %i %i %i %i %i %i %i %i %i # FROM RECORD=5\n",
            color_index,
            linewidth,
            capstyle,
@@ -354,31 +360,27 @@ decode_record_5 (FILE *file, parameter_list *params)
 //           locationcount + 1 /* NUM LINES */);
 
   for (i = 1; i <= locationcount; i++) {
-    char *fieldname1;
-    char *fieldname2;
+    char fieldname1[32];
+    char fieldname2[32];
     double x, y;
 
-    fieldname1 = g_strdup_printf ("X%i", i);
-    fieldname2 = g_strdup_printf ("X_FRAC%i", i);
+    g_snprintf (fieldname1, sizeof (fieldname1), "X%i", i);
+    g_snprintf (fieldname2, sizeof (fieldname2), "X_FRAC%i", i);
     x = parameter_list_get_double (params, fieldname1) * 20. + parameter_list_get_double (params, fieldname2) * 20. / 100000.;
-    g_free (fieldname1);
-    g_free (fieldname2);
-    fieldname1 = g_strdup_printf ("Y%i", i);
-    fieldname2 = g_strdup_printf ("Y_FRAC%i", i);
+    g_snprintf (fieldname1, sizeof (fieldname1), "Y%i", i);
+    g_snprintf (fieldname2, sizeof (fieldname2), "Y_FRAC%i", i);
     y = parameter_list_get_double (params, fieldname1) * 20. + parameter_list_get_double (params, fieldname2) * 20. / 100000.;
-    g_free (fieldname1);
-    g_free (fieldname2);
 
-    fprintf (file, "%c (%i, %i)\n", (i == 1) ? 'M' : 'T', (int)x, (int)y);
+    output_printf (file, "%c (%i, %i)\n", (i == 1) ? 'M' : 'T', (int)x, (int)y);
   }
 
-//  fprintf (file, "z\n");
+//  output_puts (file, "z\n");
 
   return 1;
 }
 
 static int
-decode_record_6 (FILE *file, parameter_list *params)
+decode_record_6 (output_writer *file, parameter_list *params)
 {
   int color_index = 3; /* GRAPHIC COLOR - GSCHEM DOESN'T SUPPORT ARBITRARY COLOURS */
   int linewidth;
@@ -389,13 +391,13 @@ decode_record_6 (FILE *file, parameter_list *params)
   int locationcount;
   int i;
 
-  printf ("Record 6 - poly line\n");
+  log_trace ("Record 6 - poly line\n");
 
   locationcount = parameter_list_get_int (params, "LOCATIONCOUNT");
   linewidth = parameter_list_get_double (params, "LINEWIDTH") * 20.;
   if (linewidth <= 0) linewidth = 1;
 
-  fprintf (file, "H %i %i %i %i %i %i %i %i %i %i %i %i %i\n",
+  output_printf (file, "H %i %i %i %i %i %i %i %i %i %i %i %i %i\n",
            color_index,
            linewidth,
            capstyle,
@@ -411,29 +413,25 @@ decode_record_6 (FILE *file, parameter_list *params)
            locationcount /* NUM LINES */);
 
   for (i = 1; i <= locationcount; i++) {
-    char *fieldname1;
-    char *fieldname2;
+    char fieldname1[32];
+    char fieldname2[32];
     double x, y;
 
-    fieldname1 = g_strdup_printf ("X%i", i);
-    fieldname2 = g_strdup_printf ("X_FRAC%i", i);
+    g_snprintf (fieldname1, sizeof (fieldname1), "X%i", i);
+    g_snprintf (fieldname2, sizeof (fieldname2), "X_FRAC%i", i);
     x = parameter_list_get_double (params, fieldname1) * 20. + parameter_list_get_double (params, fieldname2) * 20. / 100000.;
-    g_free (fieldname1);
-    g_free (fieldname2);
-    fieldname1 = g_strdup_printf ("Y%i", i);
-    fieldname2 = g_strdup_printf ("Y_FRAC%i", i);
+    g_snprintf (fieldname1, sizeof (fieldname1), "Y%i", i);
+    g_snprintf (fieldname2, sizeof (fieldname2), "Y_FRAC%i", i);
     y = parameter_list_get_double (params, fieldname1) * 20. + parameter_list_get_double (params, fieldname2) * 20. / 100000.;
-    g_free (fieldname1);
-    g_free (fieldname2);
 
-    fprintf (file, "%c (%i, %i)\n", (i == 1) ? 'M' : 'L', (int)x, (int)y);
+    output_printf (file, "%c (%i, %i)\n", (i == 1) ? 'M' : 'L', (int)x, (int)y);
   }
 
   return 1;
 }
 
 static int
-decode_record_7 (FILE *file, parameter_list *params)
+decode_record_7 (output_writer *file, parameter_list *params)
 {
   int locationcount;
   int i;
@@ -445,14 +443,14 @@ decode_record_7 (FILE *file, parameter_list *params)
   double dashspace = 0.; /* XXX */
   bool is_solid;
 
-  printf ("Record 7 - polygon\n");
+  log_trace ("Record 7 - polygon\n");
 
   locationcount = parameter_list_get_int (params, "LOCATIONCOUNT");
   linewidth = parameter_list_get_double (params, "LINEWIDTH") * 20.;
   if (linewidth <= 0) linewidth = 1;
   is_solid = parameter_list_get_bool (params, "ISSOLID");
 
-  fprintf (file, "H %i %i %i %i %i %i %i %i %i %i %i %i %i\n",
+  output_printf (file, "H %i %i %i %i %i %i %i %i %i %i %i %i %i\n",
            color_index,
            linewidth,
            capstyle,
@@ -468,32 +466,28 @@ decode_record_7 (FILE *file, parameter_list *params)
            locationcount + 1 /* NUM LINES */);
 
   for (i = 1; i <= locationcount; i++) {
-    char *fieldname1;
-    char *fieldname2;
+    char fieldname1[32];
+    char fieldname2[32];
     double x, y;
 
-    fieldname1 = g_strdup_printf ("X%i", i);
-    fieldname2 = g_strdup_printf ("X_FRAC%i", i);
+    g_snprintf (fieldname1, sizeof (fieldname1), "X%i", i);
+    g_snprintf (fieldname2, sizeof (fieldname2), "X_FRAC%i", i);
     x = parameter_list_get_double (params, fieldname1) * 20. + parameter_list_get_double (params, fieldname2) * 20. / 100000.;
-    g_free (fieldname1);
-    g_free (fieldname2);
-    fieldname1 = g_strdup_printf ("Y%i", i);
-    fieldname2 = g_strdup_printf ("Y_FRAC%i", i);
+    g_snprintf (fieldname1, sizeof (fieldname1), "Y%i", i);
+    g_snprintf (fieldname2, sizeof (fieldname2), "Y_FRAC%i", i);
     y = parameter_list_get_double (params, fieldname1) * 20. + parameter_list_get_double (params, fieldname2) * 20. / 100000.;
-    g_free (fieldname1);
-    g_free (fieldname2);
 
-    fprintf (file, "%c (%i, %i)\n", (i == 1) ? 'M' : 'L', (int)x, (int)y);
+    output_printf (file, "%c (%i, %i)\n", (i == 1) ? 'M' : 'L', (int)x, (int)y);
   }
 
-  fprintf (file, "z\n");
+  output_puts (file, "z\n");
 
 
   return 1;
 }
 
 static int
-decode_record_8 (FILE *file, parameter_list *params)
+decode_record_8 (output_writer *file, parameter_list *params)
 {
   double x, y;
   double radius;
@@ -506,7 +500,7 @@ decode_record_8 (FILE *file, parameter_list *params)
   double dashspace = 0.; /* XXX */
   bool is_solid;
 
-  printf ("Record 8 - ellipse\n");
+  log_trace ("Record 8 - ellipse\n");
 
   x = parameter_list_get_double (params, "LOCATION.X") * 20. + parameter_list_get_double (params, "LOCATION.X_FRAC") * 20. / 100000.;
   y = parameter_list_get_double (params, "LOCATION.Y") * 20. + parameter_list_get_double (params, "LOCATION.Y_FRAC") * 20. / 100000.;
@@ -517,7 +511,7 @@ decode_record_8 (FILE *file, parameter_list *params)
   is_solid = parameter_list_get_bool (params, "ISSOLID");
 
 #if 0
-  fprintf (file, "V %i %i %i %i %i %i %i %i %i %i %i %i %i %i %i\n",
+  output_printf (file, "V %i %i %i %i %i %i %i %i %i %i %i %i %i %i %i\n",
            (int)x, (int)y,
            (int)radius,
            color_index,
@@ -534,7 +528,7 @@ decode_record_8 (FILE *file, parameter_list *params)
            0 /* PITCH 2 */);
 #endif
 
-  fprintf (file, "H %i %i %i %i %i %i %i %i %i %i %i %i %i # FROM RECORD 8\n",
+  output_printf (file, "H %i %i %i %i %i %i %i %i %i %i %i %i %i # FROM RECORD 8\n",
            color_index,
            linewidth,
            capstyle,
@@ -549,17 +543,17 @@ decode_record_8 (FILE *file, parameter_list *params)
            0 /* PITCH 2 */,
            2 /* NUM LINES */);
 
-  fprintf (file, "M (%i, %i) A (%i %i 0 1 1 %i %i)\n", (int)(x + radius), (int)(y),
+  output_printf (file, "M (%i, %i) A (%i %i 0 1 1 %i %i)\n", (int)(x + radius), (int)(y),
                                                        (int)(radius), (int)(secondaryradius),
                                                        (int)(x - radius), (int)(y));
-  fprintf (file, "A (%i %i 0 1 1 %i %i) z\n", (int)(radius), (int)(secondaryradius),
+  output_printf (file, "A (%i %i 0 1 1 %i %i) z\n", (int)(radius), (int)(secondaryradius),
                                               (int)(x + radius), (int)(y));
 
   return 1;
 }
 
 static int
-decode_record_10 (FILE *file, parameter_list *params)
+decode_record_10 (output_writer *file, parameter_list *params)
 {
   double x1, y1;
   double x2, y2;
@@ -572,7 +566,7 @@ decode_record_10 (FILE *file, parameter_list *params)
   double dashlength = 0.; /* XXX */
   double dashspace = 0.; /* XXX */
 
-  printf ("Record 10 - rounded rectangle?\n");
+  log_trace ("Record 10 - rounded rectangle?\n");
 
   x1 = parameter_list_get_double (params, "LOCATION.X") * 20. + parameter_list_get_double (params, "LOCATION.X_FRAC") * 20. / 100000.;
   y1 = parameter_list_get_double (params, "LOCATION.Y") * 20. + parameter_list_get_double (params, "LOCATION.Y_FRAC") * 20. / 100000.;
@@ -583,7 +577,7 @@ decode_record_10 (FILE *file, parameter_list *params)
   linewidth = parameter_list_get_double (params, "LINEWIDTH") * 20.; /* XXX: NOT SEEN IN THE ONE I ENOUNTERED.. IS IT FILLED? */
   if (linewidth <= 0) linewidth = 1;
 
-  fprintf (file, "H %i %i %i %i %i %i %i %i %i %i %i %i %i\n",
+  output_printf (file, "H %i %i %i %i %i %i %i %i %i %i %i %i %i\n",
            color_index,
            linewidth,
            capstyle,
@@ -598,19 +592,19 @@ decode_record_10 (FILE *file, parameter_list *params)
            0 /* PITCH 2 */,
            5 /* NUM LINES */);
 
-  fprintf (file, "M (%i, %i) A (%i %i 0 0 1 %i %i)\n", (int)(x1                ), (int)(y1 + corneryradius),
+  output_printf (file, "M (%i, %i) A (%i %i 0 0 1 %i %i)\n", (int)(x1                ), (int)(y1 + corneryradius),
                                                        (int)(     cornerxradius), (int)(     corneryradius),
                                                        (int)(x1 + cornerxradius), (int)(y1                ));
-  fprintf (file, "L (%i, %i)\n", (int)x2, (int)y1);
-  fprintf (file, "L (%i, %i)\n", (int)x2, (int)y2);
-  fprintf (file, "L (%i, %i)\n", (int)x1, (int)y2);
-  fprintf (file, "z\n");
+  output_printf (file, "L (%i, %i)\n", (int)x2, (int)y1);
+  output_printf (file, "L (%i, %i)\n", (int)x2, (int)y2);
+  output_printf (file, "L (%i, %i)\n", (int)x1, (int)y2);
+  output_puts (file, "z\n");
 
   return 1;
 }
 
 static int
-decode_record_11 (FILE *file, parameter_list *params)
+decode_record_11 (output_writer *file, parameter_list *params)
 {
   double x, y;
   double x1, y1;
@@ -627,7 +621,7 @@ decode_record_11 (FILE *file, parameter_list *params)
   double endangle;
   double sweepangle;
 
-  printf ("Record 11 - elliptical arc\n");
+  log_trace ("Record 11 - elliptical arc\n");
 
   x = parameter_list_get_double (params, "LOCATION.X") * 20. + parameter_list_get_double (params, "LOCATION.X_FRAC") * 20. / 100000.;
   y = parameter_list_get_double (params, "LOCATION.Y") * 20. + parameter_list_get_double (params, "LOCATION.Y_FRAC") * 20. / 100000.;
@@ -639,7 +633,7 @@ decode_record_11 (FILE *file, parameter_list *params)
   linewidth = parameter_list_get_double (params, "LINEWIDTH") * 20.;
   if (linewidth <= 0) linewidth = 1;
 
-  fprintf (file, "H %i %i %i %i %i %i %i %i %i %i %i %i %i\n",
+  output_printf (file, "H %i %i %i %i %i %i %i %i %i %i %i %i %i\n",
            color_index,
            linewidth,
            capstyle,
@@ -660,14 +654,14 @@ decode_record_11 (FILE *file, parameter_list *params)
   x2 = x + radius * cos (endangle * M_PI / 180.);
   y2 = y + secondaryradius * sin (endangle * M_PI / 180.);
 
-  fprintf (file, "M (%i, %i) A (%i %i 0 0 1 %i %i)\n", (int)(x1), (int)(y1),
+  output_printf (file, "M (%i, %i) A (%i %i 0 0 1 %i %i)\n", (int)(x1), (int)(y1),
                                                        (int)(radius), (int)(secondaryradius),
                                                        (int)(x2), (int)(y2));
   return 1;
 }
 
 static int
-decode_record_12 (FILE *file, parameter_list *params)
+decode_record_12 (output_writer *file, parameter_list *params)
 {
   double x, y;
   double radius;
@@ -681,7 +675,7 @@ decode_record_12 (FILE *file, parameter_list *params)
   double endangle;
   double sweepangle;
 
-  printf ("Record 12 - arc\n");
+  log_trace ("Record 12 - arc\n");
 
   x = parameter_list_get_double (params, "LOCATION.X") * 20. + parameter_list_get_double (params, "LOCATION.X_FRAC") * 20. / 100000.;
   y = parameter_list_get_double (params, "LOCATION.Y") * 20. + parameter_list_get_double (params, "LOCATION.Y_FRAC") * 20. / 100000.;
@@ -692,7 +686,7 @@ decode_record_12 (FILE *file, parameter_list *params)
   linewidth = parameter_list_get_double (params, "LINEWIDTH") * 20.;
   if (linewidth <= 0) linewidth = 1;
 
-  fprintf (file, "A %i %i %i %i %i %i %i %i %i %i %i\n",
+  output_printf (file, "A %i %i %i %i %i %i %i %i %i %i %i\n",
            (int)x, (int)y,
            (int)radius,
            (int)startangle,
@@ -708,7 +702,7 @@ decode_record_12 (FILE *file, parameter_list *params)
 }
 
 static int
-decode_record_13 (FILE *file, parameter_list *params)
+decode_record_13 (output_writer *file, parameter_list *params)
 {
   double x1, y1;
   double x2, y2;
@@ -720,7 +714,7 @@ decode_record_13 (FILE *file, parameter_list *params)
   double dashspace = 0.; /* XXX */
 
 
-  printf ("Record 13 - line\n");
+  log_trace ("Record 13 - line\n");
 
   x1 = parameter_list_get_double (params, "LOCATION.X") * 20. + parameter_list_get_double (params, "LOCATION.X_FRAC") * 20. / 100000.;
   y1 = parameter_list_get_double (params, "LOCATION.Y") * 20. + parameter_list_get_double (params, "LOCATION.Y_FRAC") * 20. / 100000.;
@@ -729,7 +723,7 @@ decode_record_13 (FILE *file, parameter_list *params)
   linewidth = parameter_list_get_double (params, "LINEWIDTH") * 20.;
   if (linewidth <= 0) linewidth = 1;
 
-  fprintf (file, "L %i %i %i %i %i %i %i %i %i %i\n",
+  output_printf (file, "L %i %i %i %i %i %i %i %i %i %i\n",
            (int)x1, (int)y1,
            (int)x2, (int)y2,
            color_index,
@@ -743,7 +737,7 @@ decode_record_13 (FILE *file, parameter_list *params)
 }
 
 static int
-decode_record_14 (FILE *file, parameter_list *params)
+decode_record_14 (output_writer *file, parameter_list *params)
 {
   double x1, y1;
   double x2, y2;
@@ -758,7 +752,7 @@ decode_record_14 (FILE *file, parameter_list *params)
   int areacolor; /* XXX: NOT SUPPORTED */
   bool transparent; /* XXX: NOT SUPPORTED */
 
-  printf ("Record 14 - rectangle\n");
+  log_trace ("Record 14 - rectangle\n");
 
   x1 = parameter_list_get_double (params, "LOCATION.X") * 20. + parameter_list_get_double (params, "LOCATION.X_FRAC") * 20. / 100000.;
   y1 = parameter_list_get_double (params, "LOCATION.Y") * 20. + parameter_list_get_double (params, "LOCATION.Y_FRAC") * 20. / 100000.;
@@ -771,7 +765,7 @@ decode_record_14 (FILE *file, parameter_list *params)
   areacolor = parameter_list_get_int (params, "AREACOLOR");
   transparent = parameter_list_get_bool (params, "TRANSPARENT");
 
-  fprintf (file, "B %i %i %i %i %i %i %i %i %i %i %i %i %i %i %i %i\n",
+  output_printf (file, "B %i %i %i %i %i %i %i %i %i %i %i %i %i %i %i %i\n",
            (int)x1, (int)y1,
            (int)(x2 - x1), (int)(y2 - y1),
            color_index,
@@ -791,7 +785,7 @@ decode_record_14 (FILE *file, parameter_list *params)
 }
 
 static int
-decode_record_15 (FILE *file, parameter_list *params)
+decode_record_15 (output_writer *file, parameter_list *params)
 {
   double x1, y1;
   double x2, y2;
@@ -803,7 +797,7 @@ decode_record_15 (FILE *file, parameter_list *params)
   double dashspace = 0.; /* XXX */
 
 
-  printf ("Record 15 - sheet symbol (kicad2altium) / line?\n"); /* Kicad2altium has this as a sheet symbol */
+  log_trace ("Record 15 - sheet symbol (kicad2altium) / line?\n"); /* Kicad2altium has this as a sheet symbol */
 
   x1 = parameter_list_get_double (params, "LOCATION.X") * 20. + parameter_list_get_double (params, "LOCATION.X_FRAC") * 20. / 100000.;
   y1 = parameter_list_get_double (params, "LOCATION.Y") * 20. + parameter_list_get_double (params, "LOCATION.Y_FRAC") * 20. / 100000.;
@@ -812,7 +806,7 @@ decode_record_15 (FILE *file, parameter_list *params)
   linewidth = parameter_list_get_double (params, "LINEWIDTH") * 20.;
   if (linewidth <= 0) linewidth = 1;
 
-  fprintf (file, "L %i %i %i %i %i %i %i %i %i %i\n",
+  output_printf (file, "L %i %i %i %i %i %i %i %i %i %i\n",
            (int)x1, (int)y1,
            (int)x2, (int)y2,
            color_index,
@@ -826,10 +820,10 @@ decode_record_15 (FILE *file, parameter_list *params)
 }
 
 static int
-decode_record_34 (FILE *file, parameter_list *params)
+decode_record_34 (output_writer *file, parameter_list *params)
 {
-  char *name;
-  char *text;
+  const char *name;
+  const char *text;
   double x;
   double y;
   int color_index = 9; /* TEXT COLOR - GSCHEM DOESN'T SUPPORT ARBITRARY COLOURS */
@@ -838,17 +832,17 @@ decode_record_34 (FILE *file, parameter_list *params)
 //  int justification;
   int num_lines;
 
-  printf ("Record 34 - designator / attribute?\n"); /* Designator according to altium2kicad */
+  log_trace ("Record 34 - designator / attribute?\n"); /* Designator according to altium2kicad */
 
   x = parameter_list_get_double (params, "LOCATION.X") * 20. + parameter_list_get_double (params, "LOCATION.X_FRAC") * 20. / 100000.;
   y = parameter_list_get_double (params, "LOCATION.Y") * 20. + parameter_list_get_double (params, "LOCATION.Y_FRAC") * 20. / 100000.;
-  name = parameter_list_get_string (params, "NAME");
-  text = parameter_list_get_string (params, "TEXT");
+  name = parameter_list_peek_string (params, "NAME");
+  text = parameter_list_peek_string (params, "TEXT");
   hidden = parameter_list_get_bool (params, "ISHIDDEN");
 //  justification = parameter_list_get_int (params, "JUSTIFICATION"); /* XXX: NEED TO MAP THIS TO GSCHEM POSITIONS */
   num_lines = 1; /* XXX: NEED TO COUNT NEWLINES IN THE STRING? */
 
-  fprintf (file, "T %i %i %i %i %i %i %i %i %i\n",
+  output_printf (file, "T %i %i %i %i %i %i %i %i %i\n",
            (int)x, (int)y,
            color_index,
            size,
@@ -857,19 +851,16 @@ decode_record_34 (FILE *file, parameter_list *params)
            0 /* ANGLE */,
            0 /* ALIGNMENT */,
            num_lines);
-  fprintf (file, "%s=%s\n", name, text);
-
-  g_free (name);
-  g_free (text);
+  output_printf (file, "%s=%s\n", name, text);
 
   return 1;
 }
 
 static int
-decode_record_41 (FILE *file, parameter_list *params)
+decode_record_41 (output_writer *file, parameter_list *params)
 {
-  char *name;
-  char *text;
+  const char *name;
+  const char *text;
   double x;
   double y;
   int color_index = 9; /* TEXT COLOR - GSCHEM DOESN'T SUPPORT ARBITRARY COLOURS */
@@ -878,17 +869,17 @@ decode_record_41 (FILE *file, parameter_list *params)
 //  int justification;
   int num_lines;
 
-  printf ("Record 41 - parameter / attribute?\n"); /* Parameter according to altium2kicad */
+  log_trace ("Record 41 - parameter / attribute?\n"); /* Parameter according to altium2kicad */
 
   x = parameter_list_get_double (params, "LOCATION.X") * 20. + parameter_list_get_double (params, "LOCATION.X_FRAC") * 20. / 100000.;
   y = parameter_list_get_double (params, "LOCATION.Y") * 20. + parameter_list_get_double (params, "LOCATION.Y_FRAC") * 20. / 100000.;
-  name = parameter_list_get_string (params, "NAME");
-  text = parameter_list_get_string (params, "TEXT");
+  name = parameter_list_peek_string (params, "NAME");
+  text = parameter_list_peek_string (params, "TEXT");
   hidden = parameter_list_get_bool (params, "ISHIDDEN");
 //  justification = parameter_list_get_int (params, "JUSTIFICATION"); /* XXX: NEED TO MAP THIS TO GSCHEM POSITIONS */
   num_lines = 1; /* XXX: NEED TO COUNT NEWLINES IN THE STRING? */
 
-  fprintf (file, "T %i %i %i %i %i %i %i %i %i\n",
+  output_printf (file, "T %i %i %i %i %i %i %i %i %i\n",
            (int)x, (int)y,
            color_index,
            size,
@@ -897,36 +888,33 @@ decode_record_41 (FILE *file, parameter_list *params)
            0 /* ANGLE */,
            0 /* ALIGNMENT */,
            num_lines);
-  fprintf (file, "%s=%s\n", name, text);
-
-  g_free (name);
-  g_free (text);
+  output_printf (file, "%s=%s\n", name, text);
 
   return 1;
 }
 
 static int
-decode_record_44 (FILE *file, parameter_list *params)
+decode_record_44 (output_writer *file, parameter_list *params)
 {
-  printf ("Record 44 - unknown - blank?\n");
+  log_trace ("Record 44 - unknown - blank?\n");
   return 1;
 }
 
 static int
-decode_record_45 (FILE *file, parameter_list *params)
+decode_record_45 (output_writer *file, parameter_list *params)
 {
-  char *footprint;
+  const char *footprint;
   double x;
   double y;
   int color_index = 9; /* TEXT COLOR - GSCHEM DOESN'T SUPPORT ARBITRARY COLOURS */
   int size = 10; /* PLACEHOLDER - NEED TO CROSS-REF FONT SETUP IN HEADERS?? */
   int num_lines;
 
-  printf ("Record 45 - model?\n");
+  log_trace ("Record 45 - model?\n");
 
   x = parameter_list_get_double (params, "LOCATION.X") * 20. + parameter_list_get_double (params, "LOCATION.X_FRAC") * 20. / 100000.;
   y = parameter_list_get_double (params, "LOCATION.Y") * 20. + parameter_list_get_double (params, "LOCATION.Y_FRAC") * 20. / 100000.;
-  footprint = parameter_list_get_string (params, "MODELNAME"); /* XXX: ASSUMING THIS MATCHES THE PCB MODEL!!! */
+  footprint = parameter_list_peek_string (params, "MODELNAME"); /* XXX: ASSUMING THIS MATCHES THE PCB MODEL!!! */
 
   /* XXX: CHECK MODELDATAFILEKIND0=PCBLIB */
   /* XXX: CHECK ISCURRENT=T */
@@ -936,7 +924,7 @@ decode_record_45 (FILE *file, parameter_list *params)
 //  justification = parameter_list_get_int (params, "JUSTIFICATION"); /* XXX: NEED TO MAP THIS TO GSCHEM POSITIONS */
   num_lines = 1; /* XXX: NEED TO COUNT NEWLINES IN THE STRING? */
 
-  fprintf (file, "T %i %i %i %i %i %i %i %i %i\n",
+  output_printf (file, "T %i %i %i %i %i %i %i %i %i\n",
            (int)x, (int)y,
            color_index,
            size,
@@ -945,358 +933,205 @@ decode_record_45 (FILE *file, parameter_list *params)
            0 /* ANGLE */,
            0 /* ALIGNMENT */,
            num_lines);
-  fprintf (file, "footprint=%s\n", footprint);
-
-  g_free (footprint);
+  output_printf (file, "footprint=%s\n", footprint);
 
   return 1;
 }
 
 static int
-decode_record_46 (FILE *file, parameter_list *params)
+decode_record_46 (output_writer *file, parameter_list *params)
 {
-  printf ("Record 46 - unknown - blank?\n");
+  log_trace ("Record 46 - unknown - blank?\n");
   return 1;
 }
 
 static int
-decode_record_47 (FILE *file, parameter_list *params)
+decode_record_47 (output_writer *file, parameter_list *params)
 {
-  printf ("Record 47 - unknown - blank?\n");
+  log_trace ("Record 47 - unknown - blank?\n");
   return 1;
 }
 
 static int
-decode_record_48 (FILE *file, parameter_list *params)
+decode_record_48 (output_writer *file, parameter_list *params)
 {
-  printf ("Record 48 - unknown - blank?\n");
+  log_trace ("Record 48 - unknown - blank?\n");
   return 1;
 }
 
-void
-decode_schlib_data (FILE *file, file_content *content, int part)
+typedef int (*record_decoder) (output_writer *file, parameter_list *params);
+
+static record_decoder
+record_decoder_for_type (int record_type)
+{
+  switch (record_type) {
+    case 1: return decode_record_1; /* Schematic component according to altium2kicad */
+ /* case 2: Pin according to altium2kicad - but so far I've only encountered binary pin records */
+    case 3: return decode_record_3;
+    case 4: return decode_record_4;
+    case 5: return decode_record_5;
+    case 6: return decode_record_6;
+    case 7: return decode_record_7;
+    case 8: return decode_record_8;
+    case 10: return decode_record_10;
+    case 11: return decode_record_11;
+    case 12: return decode_record_12;
+    case 13: return decode_record_13;
+    case 14: return decode_record_14;
+    case 15: return decode_record_15;
+ /* case 17: Power object according to altium2kicad */
+ /* case 22: Possible ERC? altium2kicad */
+ /* case 25: Net label according to altium2kicad */
+ /* case 27: Wire according to altium2kicad */
+ /* case 28: Text frame according to altium2kicad */
+ /* case 29: Junction according to altium2kicad */
+ /* case 30: Image according to altium2kicad */
+ /* case 31: Sheet according to altium2kicad */
+ /* case 32: Sheet name according to altium2kicad */
+ /* case 33: Sheet symbol according to altium2kicad */
+    case 34: return decode_record_34;
+    case 41: return decode_record_41;
+ /* case 43: Possible comment? altium2kicad */
+    case 44: return decode_record_44;
+    case 45: return decode_record_45;
+    case 46: return decode_record_46;
+    case 47: return decode_record_47;
+    case 48: return decode_record_48;
+    default: return NULL;
+  }
+}
+
+/* What one symbol's records cost, for --stats */
+typedef struct {
+  stats_records records;
+  guint64 parameter_lists;
+  guint64 parameter_bytes;
+  gint64 parameter_time;
+} symbol_stats;
+
+static void
+count_record (symbol_stats *stats, int record_type, uint32_t length)
+{
+  if (record_type < 0 || record_type >= STATS_RECORD_TYPES)
+    return;
+
+  stats->records.count[record_type]++;
+  stats->records.bytes[record_type] += length;
+}
+
+static bool
+decode_records (arena *arena, output_writer **files, int partcount, file_content *content,
+                symbol_stats *stats, GError **error)
 {
   int section_no = 0;
-  int record_type;
+  int record_type = -1;
   int owner_part;
+  int part;
+  uint32_t begin_cursor = 0;
 
-  printf ("Decoding data stream\n");
+  log_trace ("Decoding data stream\n");
 
   while (content->cursor < content->length) {
 
     uint32_t peek_length;
-    char *parameter_string;
+    content_string parameter_string;
     parameter_list *parameter_list;
+    record_decoder decoder;
+    gint64 start;
+
+    begin_cursor = content->cursor;
+    record_type = -1;
 
-    content_get_uint32 (content, &peek_length);
+    if (!content_get_uint32 (content, &peek_length))
+      goto error;
     content->cursor -= 4; /* Put the cursor back to the start of the DWORD string length */
 
     if (peek_length & 0x01000000) /* Binary field? */ {
       peek_length &=  0x00FFFFFF;
 
-      if (!decode_binary_record (file, content, part))
+      if (!decode_binary_record (files, partcount, content))
         goto error;
 
-//      printf ("Skipping %i bytes of binary field\n", peek_length);
+      count_record (stats, 0, content->cursor - begin_cursor);
+
+//      log_trace ("Skipping %i bytes of binary field\n", peek_length);
 
       section_no ++;
       continue;
     }
 
-    parameter_string = content_get_length_dword_prefixed_string (content);
-    if (parameter_string == NULL)
+    if (!content_get_length_dword_prefixed_string_view (content, &parameter_string))
       goto error;
 
-    printf ("  Index %i: string: %s\n", section_no - 1, parameter_string); /* NB: THE FIRST INDEX IS -1! */
+    log_trace ("  Index %i: string: %.*s\n", section_no - 1, /* NB: THE FIRST INDEX IS -1! */
+               parameter_string.length, parameter_string.str);
 
-    parameter_list = parameter_list_new_from_string (parameter_string);
+    start = stats_begin ();
+    parameter_list = parameter_list_new_in_arena (arena, parameter_string.str, parameter_string.length);
+    stats->parameter_time += stats_elapsed (start);
+    stats->parameter_lists++;
+    stats->parameter_bytes += parameter_string.length;
 
     record_type = parameter_list_get_int (parameter_list, "RECORD");
     owner_part = parameter_list_get_int (parameter_list, "OWNERPARTID");
+    count_record (stats, record_type, content->cursor - begin_cursor);
 
-    if (owner_part >= 1 && part != owner_part) {
-      printf ("Skipping record which does not apply to our part\n");
-      g_free (parameter_string);
-      parameter_list_free (parameter_list);
+    if (owner_part > partcount) {
+      log_trace ("Skipping record which does not apply to any of our parts\n");
       section_no ++;
       continue;
     }
 
-    switch (record_type) {
-      case 1:
-        if (!decode_record_1 (file, parameter_list)) {
-          g_free (parameter_string);
-          goto error;
-        }
-        break;
-
-#if 0
-      case 1: /* Schematic component according to altium2kicad */
-        if (!decode_record_1 (file, parameter_list)) {
-          g_free (parameter_string);
-          goto error;
-        }
-        break;
-#endif
-
-#if 0
-      case 2: /* Pin according to altium2kicad - but so far I've only encountered binary pin records */
-        if (!decode_record_2 (file, parameter_list)) {
-          g_free (parameter_string);
-          goto error;
-        }
-        break;
-#endif
-
-      case 3:
-        if (!decode_record_3 (file, parameter_list)) {
-          g_free (parameter_string);
-          goto error;
-        }
-        break;
-
-      case 4:
-        if (!decode_record_4 (file, parameter_list)) {
-          g_free (parameter_string);
-          goto error;
-        }
-        break;
-
-      case 5:
-        if (!decode_record_5 (file, parameter_list)) {
-          g_free (parameter_string);
-          goto error;
-        }
-        break;
-
-      case 6:
-        if (!decode_record_6 (file, parameter_list)) {
-          g_free (parameter_string);
-          goto error;
-        }
-        break;
-
-      case 7:
-        if (!decode_record_7 (file, parameter_list)) {
-          g_free (parameter_string);
-          goto error;
-        }
-        break;
-
-      case 8:
-        if (!decode_record_8 (file, parameter_list)) {
-          g_free (parameter_string);
-          goto error;
-        }
-        break;
-
-      case 10:
-        if (!decode_record_10 (file, parameter_list)) {
-          g_free (parameter_string);
-          goto error;
-        }
-        break;
-
-      case 11:
-        if (!decode_record_11 (file, parameter_list)) {
-          g_free (parameter_string);
-          goto error;
-        }
-        break;
-
-      case 12:
-        if (!decode_record_12 (file, parameter_list)) {
-          g_free (parameter_string);
-          goto error;
-        }
-        break;
-
-      case 13:
-        if (!decode_record_13 (file, parameter_list)) {
-          g_free (parameter_string);
-          goto error;
-        }
-        break;
-
-      case 14:
-        if (!decode_record_14 (file, parameter_list)) {
-          g_free (parameter_string);
-          goto error;
-        }
-        break;
-
-      case 15:
-        if (!decode_record_15 (file, parameter_list)) {
-          g_free (parameter_string);
-          goto error;
-        }
-        break;
-
-#if 0
-      case 17: /* Power object according to altium2kicad */
-        if (!decode_record_17 (file, parameter_list)) {
-          g_free (parameter_string);
-          goto error;
-        }
-        break;
-#endif
-
-#if 0
-      case 22: /* Possible ERC? altium2kicad */
-        if (!decode_record_43 (file, parameter_list)) {
-          g_free (parameter_string);
-          goto error;
-        }
-        break;
-#endif
-
-#if 0
-      case 25: /* Net label according to altium2kicad */
-        if (!decode_record_25 (file, parameter_list)) {
-          g_free (parameter_string);
-          goto error;
-        }
-        break;
-#endif
-
-#if 0
-      case 27: /* Wire according to altium2kicad */
-        if (!decode_record_27 (file, parameter_list)) {
-          g_free (parameter_string);
-          goto error;
-        }
-        break;
-#endif
-
-#if 0
-      case 28: /* Text frame according to altium2kicad */
-        if (!decode_record_28 (file, parameter_list)) {
-          g_free (parameter_string);
-          goto error;
-        }
-        break;
-#endif
-
-#if 0
-      case 29: /* Junction according to altium2kicad */
-        if (!decode_record_29 (file, parameter_list)) {
-          g_free (parameter_string);
-          goto error;
-        }
-        break;
-#endif
-
-#if 0
-      case 30: /* Image according to altium2kicad */
-        if (!decode_record_30 (file, parameter_list)) {
-          g_free (parameter_string);
-          goto error;
-        }
-        break;
-#endif
-
-#if 0
-      case 31: /* Sheet according to altium2kicad */
-        if (!decode_record_31 (file, parameter_list)) {
-          g_free (parameter_string);
-          goto error;
-        }
-        break;
-#endif
-
-#if 0
-      case 32: /* Sheet name according to altium2kicad */
-        if (!decode_record_32 (file, parameter_list)) {
-          g_free (parameter_string);
-          goto error;
-        }
-        break;
-#endif
-
-#if 0
-      case 33: /* Sheet symbol according to altium2kicad */
-        if (!decode_record_33 (file, parameter_list)) {
-          g_free (parameter_string);
-          goto error;
-        }
-        break;
-#endif
-
-      case 34:
-        if (!decode_record_34 (file, parameter_list)) {
-          g_free (parameter_string);
-          goto error;
-        }
-        break;
-
-      case 41:
-        if (!decode_record_41 (file, parameter_list)) {
-          g_free (parameter_string);
-          goto error;
-        }
-        break;
+    decoder = record_decoder_for_type (record_type);
+    if (decoder == NULL) {
+      log_trace ("Unknown record type %i - content:\n%.*s\n", record_type,
+                 parameter_string.length, parameter_string.str);
+      g_set_error (error, OPENALTIUM_ERROR, OPENALTIUM_ERROR_UNSUPPORTED,
+                   "Unknown record type %i at position 0x%x", record_type, begin_cursor);
+      return false;
+    }
 
-#if 0
-      case 43: /* Possible comment? altium2kicad */
-        if (!decode_record_43 (file, parameter_list)) {
-          g_free (parameter_string);
-          goto error;
-        }
-        break;
-#endif
+    for (part = 1; part <= partcount; part++) {
+      if (owner_part >= 1 && part != owner_part)
+        continue;
 
-      case 44:
-        if (!decode_record_44 (file, parameter_list)) {
-          g_free (parameter_string);
-          goto error;
-        }
-        break;
-
-      case 45:
-        if (!decode_record_45 (file, parameter_list)) {
-          g_free (parameter_string);
-          goto error;
-        }
-        break;
-
-      case 46:
-        if (!decode_record_46 (file, parameter_list)) {
-          g_free (parameter_string);
-          goto error;
-        }
-        break;
-
-      case 47:
-        if (!decode_record_47 (file, parameter_list)) {
-          g_free (parameter_string);
-          goto error;
-        }
-        break;
-
-      case 48:
-        if (!decode_record_48 (file, parameter_list)) {
-          g_free (parameter_string);
-          goto error;
-        }
-        break;
-
-      default:
-        printf ("Unknown record type %i - content:\n%s\n", record_type, parameter_string);
-        g_free (parameter_string);
+      if (!decoder (files[part - 1], parameter_list))
         goto error;
     }
 
-    g_free (parameter_string);
-
-    parameter_list_free (parameter_list);
-
     section_no ++;
   }
 
-  return;
+  return true;
 
 error:
-  printf ("Oops\n");
-  exit (-1);
-  return;
+  if (record_type < 0)
+    g_set_error (error, OPENALTIUM_ERROR, OPENALTIUM_ERROR_FORMAT,
+                 "Couldn't decode record %i at position 0x%x", section_no, begin_cursor);
+  else
+    g_set_error (error, OPENALTIUM_ERROR, OPENALTIUM_ERROR_FORMAT,
+                 "Couldn't decode record %i (type %i) at position 0x%x",
+                 section_no, record_type, begin_cursor);
+  return false;
+}
+
+/* Decodes the records of a symbol in one pass, emitting each record into
+ * files[part - 1] for every part it belongs to. Records with no owner part
+ * are common to all parts. Returns false, with error set, at the first
+ * record which can't be decoded.
+ */
+bool
+decode_schlib_data (arena *arena, output_writer **files, int partcount, file_content *content, GError **error)
+{
+  symbol_stats stats = {{{0}}};
+  bool ok;
+
+  ok = decode_records (arena, files, partcount, content, &stats, error);
+
+  if (stats_enabled ()) {
+    stats_add (STATS_PARAMETERS, stats.parameter_lists, stats.parameter_time, stats.parameter_bytes);
+    stats_add_records (STATS_SCHLIB, &stats.records);
+  }
+
+  return ok;
 }
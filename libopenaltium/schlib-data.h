@@ -18,4 +18,4 @@
  */
 
 
-void decode_schlib_data (FILE *file, file_content *content, int part);
+bool decode_schlib_data (arena *arena, output_writer **files, int partcount, file_content *content, GError **error);
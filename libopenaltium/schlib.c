@@ -24,17 +24,27 @@
 #include <string.h>
 #include <getopt.h>
 #include <glib.h>
+#include <glib/gstdio.h>
 #include <gio/gio.h>
 #include <gsf/gsf.h>
 #include <gsf/gsf-input-stdio.h>
+#include <gsf/gsf-input-memory.h>
 #include <gsf/gsf-infile.h>
 #include <gsf/gsf-infile-msole.h>
 
 #include "content-parser.h"
+#include "cfb-reader.h"
+#include "arena.h"
 #include "parameters.h"
 #include "models.h"
+#include "options.h"
+#include "manifest.h"
+#include "openaltium-error.h"
+#include "schlib.h"
+#include "output-writer.h"
 #include "schlib-data.h"
-#include "schlib-data.h"
+#include "logging.h"
+#include "stats.h"
 
 
 #if 0
@@ -48,16 +58,6 @@ fprint_coord (FILE *file, int32_t coord)
 #endif
 
 
-static int
-check_gerror (GError *error) {
-  if (error != NULL) {
-    fprintf (stdout, "Error: %s\n", error->message);
-    g_error_free (error);
-    return 0;
-  }
-  return 1;
-}
-
 static file_content *
 input_to_content (GsfInput *input)
 {
@@ -73,145 +73,200 @@ input_to_content (GsfInput *input)
     g_free (content);
     return NULL;
   }
+  /* The buffer belongs to the input, so keep that alive as long as the content */
+  content->bytes = g_bytes_new_with_free_func (content->data, content->length,
+                                               (GDestroyNotify) g_object_unref,
+                                               g_object_ref (input));
   return content;
 }
 
 static void
 free_content (file_content *content)
 {
+  if (content->bytes != NULL)
+    g_bytes_unref (content->bytes);
   g_free (content);
 }
 
-static void
-parse_symbol_resource (FILE *file, GsfInfile *root, const char *sectionkey, int part)
+/* Read a stream from a storage, directly from the mapped file when possible */
+static file_content *
+child_to_content (GsfInfile *dir, const char *name)
+{
+  GsfInput *input;
+  file_content *content;
+  gint64 start = stats_begin ();
+
+  content = cfb_content_for_child (dir, name);
+  if (content == NULL) {
+    input = gsf_infile_child_by_name (dir, name);
+    if (input == NULL)
+      return NULL;
+
+    content = input_to_content (input);
+    g_object_unref (input);
+  }
+
+  if (content != NULL)
+    stats_end (STATS_READ, start, content->length);
+
+  return content;
+}
+
+/* Returns NULL if the symbol's data couldn't be read */
+static file_content *
+read_symbol_resource (GsfInfile *root, const char *sectionkey,
+                      const conversion_options *options)
 {
   GsfInfile *symbol;
-  GsfInput *data;
   file_content *content;
   char *outfile;
 
   symbol = GSF_INFILE (gsf_infile_child_by_name (root, sectionkey));
   if (symbol == NULL) {
     fprintf (stdout, "Error: Couldn't open symbol resource '%s' file\n", sectionkey);
-    return;
+    return NULL;
   }
 
-  data = gsf_infile_child_by_name (symbol, "Data");
-  if (data == NULL) {
+  content = child_to_content (symbol, "Data");
+  if (content == NULL) {
     fprintf (stdout, "Error: Couldn't open 'Data' file\n");
-    return;
+    g_object_unref (symbol);
+    return NULL;
   }
 
-  content = input_to_content (data);
-
   /* DEBUG */
   outfile = g_strdup_printf ("%s.raw", sectionkey);
-  g_file_set_contents (outfile, content->data, content->length, NULL);
+  conversion_dump_raw (options, outfile, content->data, content->length);
   g_free (outfile);
 
-  decode_schlib_data (file, content, part);
-  free_content (content);
-  g_object_unref (data);
   g_object_unref (symbol);
+
+  return content;
 }
 
 /* Convert an Altium symbol name to the name of its resource in the file */
 static char *
-libref_to_resource_name (parameter_list *sectionkeys, const char *libref)
+libref_to_resource_name (arena *arena, GHashTable *sectionkeys, const char *libref)
 {
-  int keycount;
-  int i;
-  char *fieldname;
-  char *value;
-  char *key = NULL;
-
-  if (sectionkeys != NULL) {
+  const char *key = NULL;
 
-    keycount = parameter_list_get_int (sectionkeys, "KEYCOUNT");
-
-    for (i = 0; i < keycount; i++) {
-      fieldname = g_strdup_printf ("LIBREF%i", i);
-      value = parameter_list_get_string (sectionkeys, fieldname);
-      g_free (fieldname);
-
-      if (strcmp (libref, value) == 0) { /* Found a match */
-        fieldname = g_strdup_printf ("SECTIONKEY%i", i);
-        key = parameter_list_get_string (sectionkeys, fieldname);
-        g_free (fieldname);
-        break;
-      }
-    }
-  }
+  if (sectionkeys != NULL)
+    key = g_hash_table_lookup (sectionkeys, libref);
 
   if (key == NULL)
-    key = strdup (libref);
+    key = libref;
 
   /* Translitterate '/' to '_' */
-  return g_strdelimit (key, "/", '_');
+  return g_strdelimit (arena_strdup (arena, key), "/", '_');
 }
 
 static parameter_list *
-parse_parameter_list (GsfInfile *root, const char *name)
+parse_parameter_list (GsfInfile *root, arena *arena, const char *name, GError **error)
 {
-  GsfInput *data;
   file_content *content;
-  char *parameter_string;
+  content_string parameter_string;
   parameter_list *parameter_list;
+  gint64 start;
 
-  data = gsf_infile_child_by_name (root, name);
-  if (data == NULL) {
-    fprintf (stdout, "Error: Couldn't open %s file\n", name);
+  content = child_to_content (root, name);
+  if (content == NULL) {
+    g_set_error (error, OPENALTIUM_ERROR, OPENALTIUM_ERROR_FORMAT,
+                 "Couldn't open %s file", name);
     return NULL;
   }
 
-  content = input_to_content (data);
-
-  parameter_string = content_get_length_dword_prefixed_string (content);
-  if (parameter_string == NULL) {
-    fprintf (stdout, "Error reading %s\n", name);
-    exit (EXIT_FAILURE);
+  if (!content_get_length_dword_prefixed_string_view (content, &parameter_string)) {
+    g_set_error (error, OPENALTIUM_ERROR, OPENALTIUM_ERROR_FORMAT,
+                 "Error reading %s", name);
+    free_content (content);
+    return NULL;
   }
 
-  parameter_list = parameter_list_new_from_string (parameter_string);
-  g_free (parameter_string);
+  /* The list takes its own copy, so the stream can go */
+  start = stats_begin ();
+  parameter_list = parameter_list_new_in_arena (arena, parameter_string.str, parameter_string.length);
+  stats_end (STATS_PARAMETERS, start, parameter_string.length);
 
   free_content (content);
-  g_object_unref (data);
 
   return parameter_list;
 }
 
-static parameter_list *
-parse_sectionkeys (GsfInfile *root)
+/* Index the SectionKeys LIBREF<n> -> SECTIONKEY<n> pairs, so each
+ * component's resource can be found without scanning all the keys.
+ * NB: The strings in the index belong to arena.
+ */
+static GHashTable *
+parse_sectionkeys (GsfInfile *root, arena *arena, GError **error)
 {
   GsfInput *data;
   char *name = "SectionKeys";
+  parameter_list *sectionkeys;
+  GHashTable *index;
+  int keycount;
+  int i;
 
   data = gsf_infile_child_by_name (root, name);
   if (data == NULL) {
-    printf ("No SectionKeys file!\n");
+    log_info ("No SectionKeys file!\n");
     return NULL;
   }
 
   g_object_unref (data);
 
-  return parse_parameter_list (root, name);
+  sectionkeys = parse_parameter_list (root, arena, name, error);
+  if (sectionkeys == NULL)
+    return NULL;
+
+  index = g_hash_table_new (g_str_hash, g_str_equal);
+  keycount = parameter_list_get_int (sectionkeys, "KEYCOUNT");
+
+  for (i = 0; i < keycount; i++) {
+    char fieldname[32];
+    const char *libref;
+
+    g_snprintf (fieldname, sizeof (fieldname), "LIBREF%i", i);
+    libref = parameter_list_peek_string (sectionkeys, fieldname);
+
+    /* The first matching key wins */
+    if (g_hash_table_contains (index, libref))
+      continue;
+
+    g_snprintf (fieldname, sizeof (fieldname), "SECTIONKEY%i", i);
+    g_hash_table_insert (index, (char *)libref,
+                         (char *)parameter_list_peek_string (sectionkeys, fieldname));
+  }
+
+  return index;
 }
 
 /* Spit out the data from the 'Library' resource */
-static void
-parse_fileheader (GsfInfile *root)
+static bool
+parse_fileheader (GsfInfile *root, const conversion_options *options, GError **error)
 {
 //  GsfInput *data;
 //  file_content *content;
 //  char *parameter_string;
   parameter_list *fileheader_parameter_list;
-  parameter_list *sectionkeys_parameter_list;
+  GHashTable *sectionkeys;
+  arena *arena;
   int compcount;
   int i_comp;
   int i_part;
-
-  fileheader_parameter_list = parse_parameter_list (root, "FileHeader");
+  GError *tmp_error = NULL;
+  GError *first_error = NULL;
+  int failures = 0;
+  bool complete = true;         /* Every symbol's stream could be read */
+  bool ok = true;
+
+  /* Everything decoded from the library lives until it is closed */
+  arena = arena_new ();
+
+  fileheader_parameter_list = parse_parameter_list (root, arena, "FileHeader", error);
+  if (fileheader_parameter_list == NULL) {
+    arena_free (arena);
+    return false;
+  }
 
 #if 0
   data = gsf_infile_child_by_name (root, "FileHeader");
@@ -235,90 +290,237 @@ parse_fileheader (GsfInfile *root)
   g_object_unref (data);
 #endif
 
-  sectionkeys_parameter_list = parse_sectionkeys (root);
+  sectionkeys = parse_sectionkeys (root, arena, &tmp_error);
+  if (tmp_error != NULL) {
+    g_propagate_error (error, tmp_error);
+    arena_free (arena);
+    return false;
+  }
 
   compcount = parameter_list_get_int (fileheader_parameter_list, "COMPCOUNT");
 
   /* Iterate over components */
-  for (i_comp = 0; i_comp < compcount; i_comp++) {
+  for (i_comp = 0; ok && i_comp < compcount; i_comp++) {
 
-    char *fieldname;
-    char *libref;
-    char *description;
+    char fieldname[64];
+    const char *libref;
+    const char *description;
     char *resource_name;
+    char *resource_name_no_spaces;
+    output_writer **outfiles;
+    char **outnames;
+    char *manifest_key;
+    file_content *content;
+    guint64 fingerprint = 0;
+    GError *symbol_error = NULL;
+    gint64 start;
+    bool unchanged = false;
     int partcount;
 
-    fieldname = g_strdup_printf ("LIBREF%i", i_comp);
-    libref = parameter_list_get_string (fileheader_parameter_list, fieldname);
-    g_free (fieldname);
+    g_snprintf (fieldname, sizeof (fieldname), "LIBREF%i", i_comp);
+    libref = parameter_list_peek_string (fileheader_parameter_list, fieldname);
 
-    fieldname = g_strdup_printf ("%%UTF8%%COMPDESCR%i", i_comp);
-    description = parameter_list_get_string (fileheader_parameter_list, fieldname);
-    g_free (fieldname);
+    g_snprintf (fieldname, sizeof (fieldname), "%%UTF8%%COMPDESCR%i", i_comp);
+    description = parameter_list_peek_string (fileheader_parameter_list, fieldname);
 
-    fieldname = g_strdup_printf ("PARTCOUNT%i", i_comp);
+    g_snprintf (fieldname, sizeof (fieldname), "PARTCOUNT%i", i_comp);
     partcount = parameter_list_get_int (fileheader_parameter_list, fieldname);
     partcount --; /* For some reasnon, partcount appears to always be +1 from the number of actual symbol parts */
-    g_free (fieldname);
 
-    resource_name = libref_to_resource_name (sectionkeys_parameter_list, libref);
+    resource_name = libref_to_resource_name (arena, sectionkeys, libref);
 
-    if (resource_name == NULL) {
-      fprintf (stderr, "CANNOT FIND RESOURCE NAME FOR LIBREF '%s'\n", libref);
-      g_free (libref);
+    log_info ("Symbol libref '%s', Decription '%s', Partcount %i, resource name '%s'\n",
+            libref, description, partcount, resource_name);
+
+    if (partcount < 1)
       continue;
+
+    content = read_symbol_resource (root, resource_name, options);
+    if (content == NULL)
+      complete = false;
+
+    resource_name_no_spaces = g_strdelimit (arena_strdup (arena, resource_name), " ", '_');
+    outnames = arena_new_array (arena, char *, partcount + 1);
+    for (i_part = 1; i_part <= partcount; i_part++)
+      outnames[i_part - 1] = arena_strdup_printf (arena, "%s-%i.sym", resource_name_no_spaces, i_part);
+
+    /* The number of parts decides which files are written, so is part of
+     * what makes a symbol's conversion the same as last time.
+     */
+    manifest_key = g_strconcat ("symbol/", resource_name, NULL);
+    if (options->manifest != NULL && content != NULL) {
+      fingerprint = content_fingerprint (content, partcount);
+      unchanged = conversion_manifest_is_current (options->manifest, manifest_key, fingerprint);
     }
 
-    printf ("Symbol libref '%s', Decription '%s', Partcount %i, resource name '%s'\n",
-            libref, description, partcount, resource_name);
+    if (unchanged) {
+      log_info ("Symbol '%s' is unchanged, skipping\n", libref);
+    } else {
+      /* All the parts are written from a single pass over the symbol's records */
+      outfiles = g_new0 (output_writer *, partcount);
+
+      for (i_part = 1; i_part <= partcount; i_part++) {
+        outfiles[i_part - 1] = conversion_open_writer (options, outnames[i_part - 1], error);
+        if (outfiles[i_part - 1] == NULL) {
+          ok = false;
+          break;
+        }
 
-    for (i_part = 1; i_part <= partcount; i_part++) {
-      char *resource_name_no_spaces;
-      char *outname;
-      FILE *outfile;
-      resource_name_no_spaces = g_strdelimit (g_strdup (resource_name), " ", '_');
-      outname = g_strdup_printf ("%s-%i.sym", resource_name_no_spaces, i_part);
-      outfile = fopen (outname, "w");
-      if (outfile == NULL) {
-        fprintf (stdout, "Error opening output file %s\n", outname);
-        exit (EXIT_FAILURE);
+        output_puts (outfiles[i_part - 1], "v 20121203 2\n");
       }
-      g_free (outname);
 
-      fprintf (outfile, "v 20121203 2\n");
-      parse_symbol_resource (outfile, root, resource_name, i_part);
-      fclose (outfile);
+      if (ok && content != NULL) {
+        start = stats_begin ();
+        decode_schlib_data (arena, outfiles, partcount, content, &symbol_error);
+        stats_end (STATS_SYMBOLS, start, content->length);
+      }
 
+      /* The parts are buffered as they are decoded, closing writes them */
+      start = stats_begin ();
+      for (i_part = 1; i_part <= partcount; i_part++)
+        if (outfiles[i_part - 1] != NULL &&
+            !output_writer_close (outfiles[i_part - 1], ok ? error : NULL))
+          ok = false;
+      stats_end (STATS_OUTPUT, start, 0);
+
+      g_free (outfiles);
+
+      /* A symbol which fails to decode only costs that symbol, don't
+       * leave its half written parts lying around.
+       */
+      if (symbol_error != NULL) {
+        for (i_part = 1; i_part <= partcount; i_part++) {
+          char *path = conversion_output_path (options, outnames[i_part - 1]);
+          g_unlink (path);
+          g_free (path);
+        }
+
+        g_prefix_error (&symbol_error, "Symbol '%s': ", libref);
+        failures++;
+        if (first_error == NULL) {
+          first_error = symbol_error;
+        } else {
+          fprintf (stdout, "Error: %s\n", symbol_error->message);
+          g_error_free (symbol_error);
+        }
+      } else if (ok && content != NULL && options->manifest != NULL) {
+        conversion_manifest_record (options->manifest, manifest_key, fingerprint, outnames);
+      }
+    }
+
+    if (content != NULL)
+      free_content (content);
+    g_free (manifest_key);
+  }
+
+  /* Only once every symbol has been seen can the rest be known to be gone */
+  if (ok && complete && first_error == NULL && options->manifest != NULL)
+    conversion_manifest_prune (options->manifest);
+
+  if (first_error != NULL) {
+    if (ok) {
+      g_propagate_prefixed_error (error, first_error, "%i of %i symbol(s) failed. ",
+                                  failures, compcount);
+      ok = false;
+    } else {
+      fprintf (stdout, "Error: %s\n", first_error->message);
+      g_error_free (first_error);
     }
-    g_free (resource_name);
-    g_free (libref);
   }
 
-  parameter_list_free (sectionkeys_parameter_list);
-  parameter_list_free (fileheader_parameter_list);
+  if (sectionkeys != NULL)
+    g_hash_table_unref (sectionkeys);
+  arena_free (arena);
 
 
 //  free_content (content);
 //  g_object_unref (data);
+
+  return ok;
 }
 
-void
-parse_schlib_file (char *filename)
+/* Convert a SchLib file, writing the symbols into the options' output
+ * directory. Safe to call from several threads at once.
+ */
+bool
+parse_schlib_file (const char *filename, const conversion_options *options, GError **error)
 {
-  GError *error = NULL;
+  GError *mmap_error = NULL;
   GsfInput *input;
   GsfInfile *root;
+  cfb_file *cfb = NULL;
+  gint64 start;
+  bool ok;
 
-  input = gsf_input_stdio_new (filename, &error);
-  if (!check_gerror (error)) return;
+  start = stats_begin ();
+  input = gsf_input_stdio_new (filename, error);
+  if (input == NULL)
+    return false;
 
   /* TODO: Check magic header? */
 
-  root = gsf_infile_msole_new (input, &error);
+  root = gsf_infile_msole_new (input, error);
   g_object_unref (input);
-  if (!check_gerror (error)) return;
+  if (root == NULL)
+    return false;
+
+  if (options->use_mmap) {
+    cfb = cfb_file_open (filename, &mmap_error);
+    if (check_gerror (mmap_error))
+      cfb_file_attach (cfb, root);
+    else
+      log_info ("Falling back to reading streams through libgsf\n");
+  }
+  stats_end (STATS_OPEN, start, 0);
 
-  parse_fileheader (root);
+  ok = parse_fileheader (root, options, error);
 
   g_object_unref (root);
+
+  return ok;
+}
+
+/* As parse_schlib_file, for a library already held in memory,
+ * e.g. one unpacked from an IntLib.
+ */
+bool
+parse_schlib_bytes (GBytes *bytes, const conversion_options *options, GError **error)
+{
+  GError *cfb_error = NULL;
+  GsfInput *input;
+  GsfInfile *root;
+  cfb_file *cfb = NULL;
+  gint64 start;
+  gsize length;
+  const guint8 *data;
+  bool ok;
+
+  /* NB: The memory input doesn't own the buffer, we hold it until done */
+  g_bytes_ref (bytes);
+  data = g_bytes_get_data (bytes, &length);
+  start = stats_begin ();
+  input = gsf_input_memory_new (data, length, FALSE);
+
+  root = gsf_infile_msole_new (input, error);
+  g_object_unref (input);
+  if (root == NULL) {
+    g_bytes_unref (bytes);
+    return false;
+  }
+
+  if (options->use_mmap) {
+    cfb = cfb_file_new_from_bytes (bytes, &cfb_error);
+    if (check_gerror (cfb_error))
+      cfb_file_attach (cfb, root);
+    else
+      log_info ("Falling back to reading streams through libgsf\n");
+  }
+  stats_end (STATS_OPEN, start, 0);
+
+  ok = parse_fileheader (root, options, error);
+
+  g_object_unref (root);
+  g_bytes_unref (bytes);
+
+  return ok;
 }
@@ -18,4 +18,5 @@
  */
 
 
-void parse_schlib_file (char *filename);
+bool parse_schlib_file (const char *filename, const conversion_options *options, GError **error);
+bool parse_schlib_bytes (GBytes *bytes, const conversion_options *options, GError **error);
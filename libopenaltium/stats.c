@@ -0,0 +1,226 @@
+/*
+ *  openaltium is a set of tools for opening Altium (TM) library files
+ *  Copyright (C) 2016  Peter Clifton <Peter.Clifton@clifton-electronics.co.uk>
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 2.1 of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this library; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <glib.h>
+
+#include "content-parser.h"
+#include "arena.h"
+#include "parameters.h"
+#include "models.h"
+#include "output-writer.h"
+#include "footprint.h"
+#include "pcblib-data.h"
+#include "stats.h"
+
+
+typedef struct {
+  guint64 calls;
+  gint64 usec;
+  guint64 bytes;
+} phase_total;
+
+static const char *phase_names[STATS_N_PHASES] = {
+  [STATS_OPEN]       = "open",
+  [STATS_READ]       = "read",
+  [STATS_MODELS]     = "models",
+  [STATS_INFLATE]    = "inflate",
+  [STATS_PARAMETERS] = "parameters",
+  [STATS_FOOTPRINTS] = "footprints",
+  [STATS_SYMBOLS]    = "symbols",
+  [STATS_OUTPUT]     = "output",
+};
+
+/* NB: Only set while parsing the command line, before any threads start */
+bool openaltium_stats_enabled = false;
+static gint64 stats_start_time;
+
+/* Scopes end on any thread, so the totals are only touched under the lock */
+static GMutex stats_lock;
+static phase_total phase_totals[STATS_N_PHASES];
+static stats_records record_totals[STATS_N_LIBRARIES];
+
+void
+stats_enable (void)
+{
+  openaltium_stats_enabled = true;
+  stats_start_time = g_get_monotonic_time ();
+}
+
+void
+stats_add (stats_phase phase, guint64 calls, gint64 usec, guint64 bytes)
+{
+  g_mutex_lock (&stats_lock);
+  phase_totals[phase].calls += calls;
+  phase_totals[phase].usec += usec;
+  phase_totals[phase].bytes += bytes;
+  g_mutex_unlock (&stats_lock);
+}
+
+void
+stats_add_records (stats_library library, const stats_records *records)
+{
+  stats_records *total = &record_totals[library];
+  int type;
+
+  g_mutex_lock (&stats_lock);
+  for (type = 0; type < STATS_RECORD_TYPES; type++) {
+    total->count[type] += records->count[type];
+    total->bytes[type] += records->bytes[type];
+  }
+  g_mutex_unlock (&stats_lock);
+}
+
+/* Returns NULL for types with no name, which are shown by number */
+static const char *
+record_type_name (stats_library library, int type)
+{
+  if (library == STATS_PCBLIB)
+    return pcblib_record_type_name (type);
+
+  return (type == 0) ? "binary" : NULL;
+}
+
+static void
+print_records (FILE *file, stats_library library, const char *title)
+{
+  const stats_records *records = &record_totals[library];
+  int type;
+
+  fprintf (file, "%s records:\n", title);
+  fprintf (file, "  %-12s %12s %14s\n", "type", "count", "bytes");
+
+  for (type = 0; type < STATS_RECORD_TYPES; type++) {
+    const char *name = record_type_name (library, type);
+    char number[16];
+
+    if (records->count[type] == 0)
+      continue;
+
+    if (name == NULL) {
+      g_snprintf (number, sizeof (number), "%i", type);
+      name = number;
+    }
+
+    fprintf (file, "  %-12s %12" G_GUINT64_FORMAT " %14" G_GUINT64_FORMAT "\n",
+             name, records->count[type], records->bytes[type]);
+  }
+}
+
+/* Print a summary of the phases and records, once the conversion is done */
+void
+stats_print (FILE *file)
+{
+  int phase;
+
+  g_mutex_lock (&stats_lock);
+
+  fprintf (file, "Phase times, summed over threads (phases nest):\n");
+  fprintf (file, "  %-12s %12s %10s %12s %10s\n", "phase", "calls", "seconds", "MB", "MB/s");
+
+  for (phase = 0; phase < STATS_N_PHASES; phase++) {
+    const phase_total *total = &phase_totals[phase];
+    double seconds = total->usec / 1e6;
+
+    fprintf (file, "  %-12s %12" G_GUINT64_FORMAT " %10.3f", phase_names[phase],
+             total->calls, seconds);
+    if (total->bytes > 0 && seconds > 0)
+      fprintf (file, " %12.3f %10.1f\n", total->bytes / 1e6, total->bytes / 1e6 / seconds);
+    else if (total->bytes > 0)
+      fprintf (file, " %12.3f %10s\n", total->bytes / 1e6, "-");
+    else
+      fprintf (file, " %12s %10s\n", "-", "-");
+  }
+
+  fprintf (file, "Wall time: %.3f s\n", (g_get_monotonic_time () - stats_start_time) / 1e6);
+
+  print_records (file, STATS_PCBLIB, "PcbLib");
+  print_records (file, STATS_SCHLIB, "SchLib");
+
+  g_mutex_unlock (&stats_lock);
+}
+
+static void
+append_json_records (GString *json, stats_library library, const char *key)
+{
+  const stats_records *records = &record_totals[library];
+  bool first = true;
+  int type;
+
+  g_string_append_printf (json, "  \"%s\": [", key);
+
+  for (type = 0; type < STATS_RECORD_TYPES; type++) {
+    const char *name = record_type_name (library, type);
+
+    if (records->count[type] == 0)
+      continue;
+
+    g_string_append_printf (json, "%s\n    {\"type\": %i", first ? "" : ",", type);
+    if (name != NULL)
+      g_string_append_printf (json, ", \"name\": \"%s\"", name);
+    g_string_append_printf (json, ", \"count\": %" G_GUINT64_FORMAT
+                            ", \"bytes\": %" G_GUINT64_FORMAT "}",
+                            records->count[type], records->bytes[type]);
+    first = false;
+  }
+
+  g_string_append (json, first ? "]" : "\n  ]");
+}
+
+/* Write the same summary as stats_print (), as JSON */
+bool
+stats_write_json (const char *filename, GError **error)
+{
+  GString *json;
+  bool ok;
+  int phase;
+
+  json = g_string_new ("{\n");
+
+  g_mutex_lock (&stats_lock);
+
+  g_string_append_printf (json, "  \"wall_seconds\": %.6f,\n",
+                          (g_get_monotonic_time () - stats_start_time) / 1e6);
+
+  g_string_append (json, "  \"phases\": [\n");
+  for (phase = 0; phase < STATS_N_PHASES; phase++) {
+    const phase_total *total = &phase_totals[phase];
+
+    g_string_append_printf (json,
+                            "    {\"name\": \"%s\", \"calls\": %" G_GUINT64_FORMAT
+                            ", \"seconds\": %.6f, \"bytes\": %" G_GUINT64_FORMAT "}%s\n",
+                            phase_names[phase], total->calls, total->usec / 1e6, total->bytes,
+                            (phase + 1 < STATS_N_PHASES) ? "," : "");
+  }
+  g_string_append (json, "  ],\n");
+
+  append_json_records (json, STATS_PCBLIB, "pcblib_records");
+  g_string_append (json, ",\n");
+  append_json_records (json, STATS_SCHLIB, "schlib_records");
+  g_string_append (json, "\n}\n");
+
+  g_mutex_unlock (&stats_lock);
+
+  ok = g_file_set_contents (filename, json->str, json->len, error);
+  g_string_free (json, TRUE);
+
+  return ok;
+}
@@ -0,0 +1,76 @@
+/*
+ *  openaltium is a set of tools for opening Altium (TM) library files
+ *  Copyright (C) 2016  Peter Clifton <Peter.Clifton@clifton-electronics.co.uk>
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 2.1 of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this library; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+
+/* Where a conversion spends its time, for read_data --stats.
+ *
+ * Phases are timed with the monotonic clock around the calls doing the
+ * work, and summed over every library and thread. Phases nest, e.g. the
+ * models phase includes the streams it reads and parameters it parses.
+ * When stats weren't asked for, each scope costs one test.
+ */
+
+typedef enum {
+  STATS_OPEN,           /* Opening compound files and indexing their directories */
+  STATS_READ,           /* Reading streams */
+  STATS_MODELS,         /* Reading the model records and streams */
+  STATS_INFLATE,        /* Inflating embedded models */
+  STATS_PARAMETERS,     /* Parsing parameter lists */
+  STATS_FOOTPRINTS,     /* Decoding footprint records */
+  STATS_SYMBOLS,        /* Decoding symbol records */
+  STATS_OUTPUT,         /* Writing converted files */
+  STATS_N_PHASES
+} stats_phase;
+
+typedef enum {
+  STATS_PCBLIB,
+  STATS_SCHLIB,
+  STATS_N_LIBRARIES
+} stats_library;
+
+/* Covers both PcbLib record types and SchLib RECORD= numbers. SchLib
+ * binary records, which have no number, are counted as type 0.
+ */
+#define STATS_RECORD_TYPES 64
+
+/* Records seen by one decoder call, added to the totals in one go */
+typedef struct {
+  guint64 count[STATS_RECORD_TYPES];
+  guint64 bytes[STATS_RECORD_TYPES];
+} stats_records;
+
+extern bool openaltium_stats_enabled;
+
+void stats_enable (void);
+void stats_add (stats_phase phase, guint64 calls, gint64 usec, guint64 bytes);
+void stats_add_records (stats_library library, const stats_records *records);
+void stats_print (FILE *file);
+bool stats_write_json (const char *filename, GError **error);
+
+#define stats_enabled() (openaltium_stats_enabled)
+
+/* Start a scope, and the time since it was started */
+#define stats_begin() (stats_enabled () ? g_get_monotonic_time () : 0)
+#define stats_elapsed(start) (stats_enabled () ? g_get_monotonic_time () - (start) : 0)
+
+#define stats_end(phase, start, bytes) \
+  G_STMT_START { \
+    if (stats_enabled ()) \
+      stats_add ((phase), 1, g_get_monotonic_time () - (start), (bytes)); \
+  } G_STMT_END
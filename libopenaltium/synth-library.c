@@ -0,0 +1,527 @@
+/*
+ *  openaltium is a set of tools for opening Altium (TM) library files
+ *  Copyright (C) 2016  Peter Clifton <Peter.Clifton@clifton-electronics.co.uk>
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 2.1 of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this library; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdarg.h>
+#include <string.h>
+#include <glib.h>
+#include <gio/gio.h>
+
+#include "content-parser.h"
+#include "arena.h"
+#include "parameters.h"
+#include "models.h"
+#include "output-writer.h"
+#include "footprint.h"
+#include "pcblib-data.h"
+#include "synth-library.h"
+
+
+/* Everything is little endian, as in the files */
+
+static void
+append_uint8 (GByteArray *data, uint8_t value)
+{
+  g_byte_array_append (data, &value, 1);
+}
+
+static void
+append_uint16 (GByteArray *data, uint16_t value)
+{
+  append_uint8 (data, value);
+  append_uint8 (data, value >> 8);
+}
+
+void
+synth_append_uint32 (GByteArray *data, uint32_t value)
+{
+  append_uint16 (data, value);
+  append_uint16 (data, value >> 16);
+}
+
+static void
+append_double (GByteArray *data, double value)
+{
+  uint64_t bits;
+
+  memcpy (&bits, &value, sizeof (bits));
+  synth_append_uint32 (data, bits);
+  synth_append_uint32 (data, bits >> 32);
+}
+
+static void
+append_zeros (GByteArray *data, guint n)
+{
+  guint i;
+
+  for (i = 0; i < n; i++)
+    append_uint8 (data, 0);
+}
+
+/* The run of 0xFFFF words most PcbLib records have after the layer */
+static void
+append_ffff (GByteArray *data)
+{
+  int i;
+
+  for (i = 0; i < 5; i++)
+    append_uint16 (data, 0xFFFF);
+}
+
+/* A string with both a block length and a byte length in front */
+void
+synth_append_multi_prefixed_string (GByteArray *data, const char *string)
+{
+  gsize length = strlen (string);
+
+  synth_append_uint32 (data, 1 + length);
+  append_uint8 (data, length);
+  g_byte_array_append (data, (const guint8 *) string, length);
+}
+
+/* A NUL terminated string with its length in front, as parameter lists are */
+void
+synth_append_dword_prefixed_string (GByteArray *data, const char *string)
+{
+  gsize length = strlen (string) + 1;
+
+  synth_append_uint32 (data, length);
+  g_byte_array_append (data, (const guint8 *) string, length);
+}
+
+
+/* PcbLib footprint records. Coordinates are in 1/10000 mil. */
+
+static void
+append_arc_record (GByteArray *data, guint index)
+{
+  append_uint8 (data, 1);
+  synth_append_uint32 (data, 48);
+  append_uint8 (data, 33);              /* Top overlay */
+  append_uint16 (data, 0);
+  append_ffff (data);
+  synth_append_uint32 (data, 10000 * index);
+  synth_append_uint32 (data, -20000);
+  synth_append_uint32 (data, 50000);
+  append_double (data, 0.);
+  append_double (data, 270.);
+  synth_append_uint32 (data, 1000);
+  append_uint16 (data, 0);
+  append_uint8 (data, 0);
+}
+
+static void
+append_pad_record (GByteArray *data, guint index)
+{
+  char name[16];
+  int i;
+
+  g_snprintf (name, sizeof (name), "%u", index + 1);
+
+  append_uint8 (data, 2);
+  synth_append_multi_prefixed_string (data, name);
+  synth_append_uint32 (data, 1);
+  append_uint8 (data, 0);
+  synth_append_multi_prefixed_string (data, "|&|0");
+  synth_append_uint32 (data, 1);
+  append_uint8 (data, 0);
+
+  /* NB: The decoder reads the last 4 bytes of the geometry from the pad
+   * stack's length, which is 0 here as there is no pad stack.
+   */
+  synth_append_uint32 (data, 106);
+  append_uint8 (data, 74);              /* Multilayer, so a pin */
+  append_uint16 (data, 0);
+  append_ffff (data);
+  synth_append_uint32 (data, 1000000 * (index / 2));  /* Position, in two rows */
+  synth_append_uint32 (data, 3000000 * (index % 2));
+  synth_append_uint32 (data, 600000);         /* Sizes, clearances, mask and drill */
+  synth_append_uint32 (data, 600000);
+  synth_append_uint32 (data, 700000);
+  synth_append_uint32 (data, 700000);
+  synth_append_uint32 (data, 650000);
+  synth_append_uint32 (data, 650000);
+  synth_append_uint32 (data, 350000);
+  for (i = 0; i < 3; i++)
+    append_uint8 (data, (index == 0) ? 2 : 1);  /* Pin 1 square, the rest round */
+  append_double (data, 0.);
+  append_zeros (data, 93 - 47);
+
+  synth_append_uint32 (data, 0);              /* No pad stack */
+}
+
+static void
+append_via_record (GByteArray *data, guint index)
+{
+  append_uint8 (data, 3);
+  synth_append_uint32 (data, 74);
+  append_uint8 (data, 1);               /* Top layer */
+  append_uint16 (data, 0);
+  append_ffff (data);
+  synth_append_uint32 (data, 500000 * index);
+  synth_append_uint32 (data, -1000000);
+  synth_append_uint32 (data, 300000);
+  synth_append_uint32 (data, 300000);
+  append_zeros (data, 3);
+  synth_append_uint32 (data, 0);
+  append_uint16 (data, 0);
+  append_zeros (data, 7 * 4);
+  append_zeros (data, 2 * 4);
+}
+
+static void
+append_track_record (GByteArray *data, guint index)
+{
+  append_uint8 (data, 4);
+  synth_append_uint32 (data, 36);
+  append_uint8 (data, 33);
+  append_uint16 (data, 0);
+  append_ffff (data);
+  synth_append_uint32 (data, 10000 * index);
+  synth_append_uint32 (data, 0);
+  synth_append_uint32 (data, 10000 * index + 50000);
+  synth_append_uint32 (data, 50000);
+  synth_append_uint32 (data, 1000);
+  append_zeros (data, 3);
+}
+
+static void
+append_text_record (GByteArray *data, guint index)
+{
+  append_uint8 (data, 5);
+  synth_append_uint32 (data, 43);
+  append_uint8 (data, 33);
+  append_uint16 (data, 0);
+  append_ffff (data);
+  synth_append_uint32 (data, 10000 * index);
+  synth_append_uint32 (data, -100000);
+  synth_append_uint32 (data, 60000);
+  append_uint16 (data, 0);
+  append_double (data, 90. * (index % 4));
+  synth_append_uint32 (data, 0);
+  synth_append_uint32 (data, 0);
+  synth_append_multi_prefixed_string (data, (index == 0) ? ".Designator" : ".Comment");
+}
+
+static void
+append_fill_record (GByteArray *data, guint index)
+{
+  append_uint8 (data, 6);
+  synth_append_uint32 (data, 38);
+  append_uint8 (data, 37);              /* Top solder */
+  append_uint16 (data, 0);
+  append_ffff (data);
+  synth_append_uint32 (data, 10000 * index);
+  synth_append_uint32 (data, 0);
+  synth_append_uint32 (data, 10000 * index + 50000);
+  synth_append_uint32 (data, 50000);
+  synth_append_uint32 (data, 0);
+  synth_append_uint32 (data, 0);
+  append_uint8 (data, 0);
+}
+
+/* Regions and bodies share a layout: a parameter list, then an outline */
+static void
+append_outline_record (GByteArray *data, uint8_t type, uint8_t layer,
+                       const char *parameters, guint index, guint n_vertices)
+{
+  guint i;
+
+  append_uint8 (data, type);
+  synth_append_uint32 (data, 26 + strlen (parameters) + 1 + 16 * n_vertices);
+  append_uint8 (data, layer);
+  append_uint16 (data, 0);
+  append_ffff (data);
+  synth_append_uint32 (data, 0);
+  append_uint8 (data, 0);
+  synth_append_dword_prefixed_string (data, parameters);
+  synth_append_uint32 (data, n_vertices);
+  for (i = 0; i < n_vertices; i++) {
+    append_double (data, 10000. * index + 5000. * (i & 3));
+    append_double (data, 5000. * (i >> 1));
+  }
+}
+
+static void
+append_region_record (GByteArray *data, guint index)
+{
+  append_outline_record (data, 11, 69,
+                         "|V7_LAYER=MECHANICAL13|NAME= |KIND=0|SUBPOLYINDEX=-1|UNIONINDEX=0",
+                         index, 8);
+}
+
+/* A body which places the model model_id, or an unembedded one if NULL */
+static void
+append_body_record (GByteArray *data, guint index, const char *model_id)
+{
+  char *parameters;
+
+  parameters = g_strdup_printf ("|V7_LAYER=MECHANICAL13|NAME= |KIND=0|SUBPOLYINDEX=-1"
+                                "|UNIONINDEX=0|BODYPROJECTION=0|BODYCOLOR3D=8421504"
+                                "|BODYOPACITY3D=1.000|MODELID=%s|MODEL.EMBED=%s"
+                                "|MODEL.2D.X=%u|MODEL.2D.Y=0|MODEL.2D.ROTATION=0.000"
+                                "|MODEL.3D.ROTX=0.000|MODEL.3D.ROTY=0.000|MODEL.3D.ROTZ=0.000"
+                                "|MODEL.3D.DZ=0|MODEL.SNAPCOUNT=0|MODEL.MODELTYPE=1",
+                                (model_id != NULL) ? model_id : "",
+                                (model_id != NULL) ? "TRUE" : "FALSE",
+                                10 * index);
+  append_outline_record (data, 12, 69, parameters, index, 4);
+  g_free (parameters);
+}
+
+/* Whether synth_pcblib_record can make records of type */
+bool
+synth_pcblib_can_generate (int type)
+{
+  switch (type) {
+    case 1: case 2: case 3: case 4: case 5: case 6: case 11: case 12:
+      return true;
+    default:
+      return false;
+  }
+}
+
+/* Append the index'th record of type to a footprint's data stream. Body
+ * records place the model model_id, which may be NULL for none.
+ */
+void
+synth_pcblib_record (GByteArray *data, int type, guint index, const char *model_id)
+{
+  switch (type) {
+    case 1:  append_arc_record (data, index); break;
+    case 2:  append_pad_record (data, index); break;
+    case 3:  append_via_record (data, index); break;
+    case 4:  append_track_record (data, index); break;
+    case 5:  append_text_record (data, index); break;
+    case 6:  append_fill_record (data, index); break;
+    case 11: append_region_record (data, index); break;
+    case 12: append_body_record (data, index, model_id); break;
+    default: g_return_if_reached ();
+  }
+}
+
+/* Append a footprint's whole data stream, the records grouped by type.
+ * Returns the number of records, which goes in the footprint's Header.
+ */
+guint
+synth_pcblib_footprint (GByteArray *data, const char *name,
+                        const synth_record_mix *mix, const char *model_id)
+{
+  guint n_records = 0;
+  guint i;
+  int type;
+
+  synth_append_multi_prefixed_string (data, name);
+
+  for (type = 0; type <= PCBLIB_RECORD_TYPE_MAX; type++) {
+    for (i = 0; i < mix->counts[type]; i++)
+      synth_pcblib_record (data, type, i, model_id);
+    n_records += mix->counts[type];
+  }
+
+  return n_records;
+}
+
+
+/* Embedded models */
+
+char *
+synth_model_id (guint index)
+{
+  return g_strdup_printf ("{5F1C0000-0000-4000-8000-%012X}", index);
+}
+
+/* The index'th model's record in the library's Models/Data stream */
+char *
+synth_model_parameters (guint index)
+{
+  char *id;
+  char *parameters;
+
+  id = synth_model_id (index);
+  parameters = g_strdup_printf ("|EMBED=TRUE|MODELSOURCE=Undefined|ID=%s"
+                                "|ROTX=0.000|ROTY=0.000|ROTZ=%i.000|DZ=0|CHECKSUM=%u"
+                                "|NAME=synth-%u.step",
+                                id, 90 * (index % 4), index, index);
+  g_free (id);
+
+  return parameters;
+}
+
+/* A STEP file of about size bytes, deflated as models are stored */
+GBytes *
+synth_step_model (guint index, gsize size, GError **error)
+{
+  GZlibCompressor *comp;
+  GOutputStream *memory_os;
+  GOutputStream *comp_os;
+  GString *step;
+  GBytes *bytes = NULL;
+  gsize bytes_written;
+  guint point;
+
+  step = g_string_new ("ISO-10303-21;\nHEADER;\n");
+  g_string_append_printf (step, "FILE_NAME('synth-%u.step','',(''),(''),'','','');\n", index);
+  g_string_append (step, "FILE_SCHEMA(('AUTOMOTIVE_DESIGN'));\nENDSEC;\nDATA;\n");
+  for (point = 1; step->len < size; point++)
+    g_string_append_printf (step, "#%u=CARTESIAN_POINT('',(%u.,%u.,%u.));\n",
+                            point, point % 97, (point * 7) % 89, index % 83);
+  g_string_append (step, "ENDSEC;\nEND-ISO-10303-21;\n");
+
+  memory_os = g_memory_output_stream_new_resizable ();
+  comp = g_zlib_compressor_new (G_ZLIB_COMPRESSOR_FORMAT_ZLIB, -1);
+  comp_os = g_converter_output_stream_new (memory_os, G_CONVERTER (comp));
+
+  if (g_output_stream_write_all (comp_os, step->str, step->len, &bytes_written, NULL, error) &&
+      g_output_stream_close (comp_os, NULL, error))
+    bytes = g_memory_output_stream_steal_as_bytes (G_MEMORY_OUTPUT_STREAM (memory_os));
+
+  g_object_unref (comp_os);
+  g_object_unref (comp);
+  g_object_unref (memory_os);
+  g_string_free (step, TRUE);
+
+  return bytes;
+}
+
+
+/* SchLib symbols. Coordinates are in 1/100 inch, as the files have them. */
+
+/* A pin, as the binary record SchLibs store them in */
+void
+synth_schlib_binary_pin (GByteArray *data, int owner_part, guint index)
+{
+  char label[16];
+  char number[16];
+  GByteArray *record;
+
+  g_snprintf (label, sizeof (label), "IO%u", index);
+  g_snprintf (number, sizeof (number), "%u", index + 1);
+
+  record = g_byte_array_new ();
+  append_uint8 (record, 2);
+  synth_append_uint32 (record, 0);
+  synth_append_uint32 (record, owner_part);
+  append_zeros (record, 3);
+  append_uint8 (record, 0);             /* No notes */
+  append_uint8 (record, 1);
+  append_uint8 (record, 4);
+  append_uint8 (record, 0x22);          /* Pointing left */
+  append_uint16 (record, 20);           /* Length */
+  append_uint16 (record, -40);          /* Position */
+  append_uint16 (record, -10 * (int) index);
+  append_uint16 (record, 0);
+  append_uint16 (record, 0);
+  append_uint8 (record, strlen (label));
+  g_byte_array_append (record, (const guint8 *) label, strlen (label));
+  append_uint8 (record, strlen (number));
+  g_byte_array_append (record, (const guint8 *) number, strlen (number));
+  append_zeros (record, 3);
+
+  synth_append_uint32 (data, 0x01000000 | record->len);
+  g_byte_array_append (data, record->data, record->len);
+  g_byte_array_unref (record);
+}
+
+static void
+append_record (GByteArray *data, guint *n_records, const char *format, ...) G_GNUC_PRINTF (3, 4);
+
+static void
+append_record (GByteArray *data, guint *n_records, const char *format, ...)
+{
+  va_list args;
+  char *parameters;
+
+  va_start (args, format);
+  parameters = g_strdup_vprintf (format, args);
+  va_end (args);
+
+  synth_append_dword_prefixed_string (data, parameters);
+  g_free (parameters);
+  (*n_records)++;
+}
+
+/* Append a symbol's whole Data stream: a box with pins down its left side
+ * in each part, and a designator shared by them all. Returns the number
+ * of records.
+ */
+guint
+synth_schlib_symbol (GByteArray *data, const char *libref,
+                     int partcount, guint pins_per_part)
+{
+  guint n_records = 0;
+  guint pin = 0;
+  guint i;
+  int part;
+
+  append_record (data, &n_records,
+                 "|RECORD=1|LIBREFERENCE=%s|%%UTF8%%COMPONENTDESCRIPTION=Synthetic symbol"
+                 "|PARTCOUNT=%i|DISPLAYMODECOUNT=1|INDEXINSHEET=-1|OWNERPARTID=-1"
+                 "|CURRENTPARTID=1|AREACOLOR=11599871|COLOR=128|PARTIDLOCKED=T",
+                 libref, partcount + 1);
+
+  for (part = 1; part <= partcount; part++) {
+    append_record (data, &n_records,
+                   "|RECORD=14|OWNERPARTID=%i|LOCATION.X=-40|LOCATION.Y=%i"
+                   "|CORNER.X=40|CORNER.Y=10|LINEWIDTH=1|COLOR=128"
+                   "|AREACOLOR=11599871|ISSOLID=T",
+                   part, -10 * (int) pins_per_part);
+
+    for (i = 0; i < pins_per_part; i++, n_records++)
+      synth_schlib_binary_pin (data, part, pin++);
+
+    append_record (data, &n_records,
+                   "|RECORD=6|OWNERPARTID=%i|LINEWIDTH=1|COLOR=16711680|LOCATIONCOUNT=3"
+                   "|X1=10|Y1=0|X2=30|Y2=-10|X3=10|Y3=-20",
+                   part);
+  }
+
+  append_record (data, &n_records,
+                 "|RECORD=34|OWNERPARTID=-1|LOCATION.X=-40|LOCATION.Y=20|COLOR=8388608"
+                 "|FONTID=1|TEXT=U?|NAME=Designator|READONLYSTATE=1");
+
+  return n_records;
+}
+
+/* The library's FileHeader parameter list, for the NULL terminated librefs */
+char *
+synth_schlib_fileheader (char **librefs, int partcount)
+{
+  GString *header;
+  int i;
+
+  header = g_string_new ("|HEADER=Protel for Windows - Schematic Library Editor Binary File Version 5.0"
+                         "|WEIGHT=0|MINORVERSION=2|FONTIDCOUNT=1|SIZE1=10|FONTNAME1=Times New Roman"
+                         "|USEMBCS=T|ISBOC=T|SHEETSTYLE=9|SYSTEMFONT=1|BORDERON=T|SHEETNUMBERSPACESIZE=12"
+                         "|AREACOLOR=16317695|SNAPGRIDON=T|SNAPGRIDSIZE=10|VISIBLEGRIDON=T"
+                         "|VISIBLEGRIDSIZE=10|CUSTOMX=18000|CUSTOMY=18000|USECUSTOMSHEET=T"
+                         "|REFERENCEZONESON=T|DISPLAY_UNIT=0");
+
+  for (i = 0; librefs[i] != NULL; i++);
+  g_string_append_printf (header, "|COMPCOUNT=%i", i);
+
+  /* NB: The part count is stored one more than the number of parts */
+  for (i = 0; librefs[i] != NULL; i++)
+    g_string_append_printf (header, "|LIBREF%i=%s|%%UTF8%%COMPDESCR%i=Synthetic symbol"
+                            "|PARTCOUNT%i=%i",
+                            i, librefs[i], i, i, partcount + 1);
+
+  return g_string_free (header, FALSE);
+}
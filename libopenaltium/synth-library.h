@@ -0,0 +1,47 @@
+/*
+ *  openaltium is a set of tools for opening Altium (TM) library files
+ *  Copyright (C) 2016  Peter Clifton <Peter.Clifton@clifton-electronics.co.uk>
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 2.1 of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this library; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+
+/* Synthetic library streams, laid out the way decode_pcblib_data and
+ * decode_schlib_data expect. Only the fields the decoders read vary, the
+ * rest are fixed at values seen in real libraries.
+ */
+
+/* How many records of each type go in a footprint */
+typedef struct {
+  guint counts[PCBLIB_RECORD_TYPE_MAX + 1];
+} synth_record_mix;
+
+void synth_append_uint32 (GByteArray *data, uint32_t value);
+void synth_append_multi_prefixed_string (GByteArray *data, const char *string);
+void synth_append_dword_prefixed_string (GByteArray *data, const char *string);
+
+bool synth_pcblib_can_generate (int type);
+void synth_pcblib_record (GByteArray *data, int type, guint index, const char *model_id);
+guint synth_pcblib_footprint (GByteArray *data, const char *name,
+                              const synth_record_mix *mix, const char *model_id);
+
+char *synth_model_id (guint index);
+char *synth_model_parameters (guint index);
+GBytes *synth_step_model (guint index, gsize size, GError **error);
+
+void synth_schlib_binary_pin (GByteArray *data, int owner_part, guint index);
+guint synth_schlib_symbol (GByteArray *data, const char *libref,
+                           int partcount, guint pins_per_part);
+char *synth_schlib_fileheader (char **librefs, int partcount);